@@ -17,4 +17,8 @@
  */
 
 #include "visx/uasf.h"
-
+#include "visx/uasf/tablefile.h"
+#include "visx/uasf/resultcache.h"
+#include "visx/uasf/statistics.h"
+#include "visx/uasf/fit.h"
+#include "visx/uasf/quantiles.h"
@@ -20,4 +20,22 @@
 #error Not compiled using C++!
 #endif
 
+#include "visx/hash.hpp"
+#include "visx/mappedfile.hpp"
+#include "visx/memory.hpp"
+#include "visx/orderindex.hpp"
+#include "visx/smallvector.hpp"
+#include "visx/spscqueue.hpp"
+#include "visx/threadpool.hpp"
 #include "visx/uasf.hpp"
+#include "visx/uasf/tablefile.hpp"
+#include "visx/uasf/journal.hpp"
+#include "visx/uasf/ingest.hpp"
+#include "visx/uasf/resultcache.hpp"
+#include "visx/uasf/persistent.hpp"
+#include "visx/uasf/sweep.hpp"
+#include "visx/uasf/async.hpp"
+#include "visx/uasf/decimation.hpp"
+#include "visx/uasf/statistics.hpp"
+#include "visx/uasf/fit.hpp"
+#include "visx/uasf/quantiles.hpp"
@@ -0,0 +1,108 @@
+/* include/jp/visx/daemon.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_DAEMON_HPP
+#define JP_VISX_DAEMON_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#ifdef _WIN32
+#error The daemon uses Unix domain sockets, which are not supported on Windows.
+#endif
+
+#include "uasf.hpp"
+#include <string>
+#include <vector>
+
+namespace jp {
+	namespace visx {
+		/* The protocol of visx-daemon. Every message is a frame:
+		 *		u32 size - the size of the rest of the frame,
+		 *		u32 id   - chosen by the client, and copied into the response,
+		 * followed by a request or a response. The numbers are in the byte order of
+		 * the host, as the daemon only serves clients on the same host.
+		 *
+		 * A request continues with u8 kind and u8 flags, then:
+		 *		DAEMON_TABLE: u32 count, i8 types[count], f64 values[count] and f64
+		 *			uncertainties[count]. The rows are computed like the rows of an
+		 *			UncertaintyTable (see uasf::evaluateRows), so the rows of a table
+		 *			(with its first row) can be sent as they are.
+		 *		DAEMON_EXPRESSION: the text of an expression (see uasf::parseExpression).
+		 * A response continues with u8 status, f64 value and f64 uncertainty. If the
+		 * request had the flag DAEMON_ALL_ROWS, it then has u32 count and the value
+		 * and uncertainty after every row.
+		 */
+		enum {
+			DAEMON_TABLE = 1,
+			DAEMON_EXPRESSION = 2,
+			DAEMON_ALL_ROWS = 0x1,
+			DAEMON_OK = 0,
+			DAEMON_INVALID = 1,
+			// Larger frames are refused.
+			DAEMON_MAX_FRAME = 64 << 20
+		};
+		// The socket used when $XDG_RUNTIME_DIR is not set.
+		extern const char *const daemon_default_socket;
+		// This function returns the socket of the daemon when no path is given:
+		// visx-daemon.sock in $XDG_RUNTIME_DIR, which only its user may enter, or
+		// daemon_default_socket if it is not set.
+		std::string getDefaultDaemonSocket(void);
+
+		/* The DaemonClient sends requests to a visx-daemon and waits for their
+		 * responses. A client may only be used by one thread at a time.
+		 */
+		class DaemonClient {
+		public:
+			DaemonClient(void);
+			DaemonClient(DaemonClient &&other);
+			DaemonClient &operator=(DaemonClient &&other);
+			DaemonClient(const DaemonClient &) = delete;
+			DaemonClient &operator=(const DaemonClient &) = delete;
+			~DaemonClient(void);
+			// This method connects to the daemon listening at path (or at
+			// getDefaultDaemonSocket if it is NULL). It returns false on failure.
+			bool connect(const char *path = nullptr);
+			// This method closes the connection. It does nothing if there is none.
+			void close(void);
+			// This method returns whether the client is connected.
+			bool isConnected(void) const;
+			// These methods compute rows on the daemon. If rows_dest is not NULL, it
+			// gets the result after every row. They return false if the daemon could
+			// not be reached (in which case the connection is closed) or refused the
+			// rows.
+			bool evaluate(const uasf::UncertaintyTable &table, uasf::UncertaintyPair *result_dest, std::vector<uasf::UncertaintyPair> *rows_dest = nullptr);
+			bool evaluate(const uasf::UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count, uasf::UncertaintyPair *result_dest, std::vector<uasf::UncertaintyPair> *rows_dest = nullptr);
+			// This method computes an expression on the daemon. It returns false in
+			// the same cases as evaluate.
+			bool evaluateExpression(const char *expression, uasf::UncertaintyPair *result_dest);
+		private:
+			// This method sends the request in request_ (after its header) and reads
+			// the response.
+			bool exchange(u8 kind, u8 flags, uasf::UncertaintyPair *result_dest, std::vector<uasf::UncertaintyPair> *rows_dest);
+			int fd_;
+			u32 next_id_;
+			std::vector<char> request_,
+							  response_;
+		}; // class DaemonClient
+	} // namespace visx
+} // namespace jp
+
+#endif
@@ -28,6 +28,8 @@
 #include <wx/wx.h>
 #endif
 
+#include "tablepanel.hpp"
+
 #define JP_VISX_GUI_ABOUTSTR "VisX is a program which serves to help calculate and demonstrate various data and values in the field of physics.\n\n\
 This program uses wxWidgets to display content to the screen. wxWidgets' modified LGPL license does not require distribution of its sources.\nMore information about this project can be found at https://github.com/ljtpetersen/visx.\n\n\
 Copyright (C) 2021 James Petersen\n\n\
@@ -54,11 +56,16 @@ namespace jp {
 #ifndef __APPLE__
 				static wxMenu *menu_file;
 #endif
+				static wxMenu *menu_table;
 				static wxMenu *menu_help;
 				static wxMenuBar *menubar;
+				static TablePanel *table_panel;
 				MainFrame(void);
 				void onExit(wxCommandEvent &event);
 				void onAbout(wxCommandEvent &event);
+				void onOpenTable(wxCommandEvent &event);
+				void onAddRow(wxCommandEvent &event);
+				void onRemoveRow(wxCommandEvent &event);
 				void onSizeChange(wxSizeEvent &event);
 
 			private:
@@ -70,7 +77,10 @@ namespace jp {
 #ifdef __APPLE__
 				ID_ABOUT,
 #endif
-				ID_MODULE_SELECTOR
+				ID_MODULE_SELECTOR,
+				ID_OPEN_TABLE,
+				ID_ADD_ROW,
+				ID_REMOVE_ROW
 			};
 		} // namespace gui
 	} // namespace visx
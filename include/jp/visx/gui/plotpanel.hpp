@@ -0,0 +1,61 @@
+/* include/jp/visx/gui/plotpanel.hpp
+ *
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef JP_VISX_GUI_PLOTPANEL_HPP
+#define JP_VISX_GUI_PLOTPANEL_HPP
+
+#include <jp/visx.hpp>
+#include <wx/wxprec.h>
+
+#ifndef WX_PRECOMP
+#include <wx/wx.h>
+#endif
+
+#include <vector>
+
+namespace jp {
+	namespace visx {
+		namespace gui {
+			/* The PlotPanel plots the result after every row of a table, with the band
+			 * of its uncertainty. Every column of pixels shows the lowest and highest
+			 * result of its rows, which come from a ResultDecimation of the table, so
+			 * drawing takes about the same time whatever the number of rows. The panel
+			 * observes the table, and only updates the nodes of the changed rows.
+			 */
+			class PlotPanel : public wxPanel {
+			public:
+				// The table must live longer than the panel.
+				PlotPanel(wxWindow *parent, uasf::UncertaintyTable *table);
+				~PlotPanel(void);
+				void onPaint(wxPaintEvent &event);
+				void onSizeChange(wxSizeEvent &event);
+			private:
+				uasf::UncertaintyTable *table_;
+				uasf::ResultDecimation decimation_;
+				// The extents of the columns of pixels, kept between paints.
+				std::vector<uasf::ResultExtent> columns_;
+				u64 observer_;
+
+				DECLARE_EVENT_TABLE();
+			};
+		} // namespace gui
+	} // namespace visx
+} // namespace jp
+
+#endif
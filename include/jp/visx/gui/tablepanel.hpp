@@ -0,0 +1,114 @@
+/* include/jp/visx/gui/tablepanel.hpp
+ *
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef JP_VISX_GUI_TABLEPANEL_HPP
+#define JP_VISX_GUI_TABLEPANEL_HPP
+
+#include <jp/visx.hpp>
+#include <wx/wxprec.h>
+
+#ifndef WX_PRECOMP
+#include <wx/wx.h>
+#endif
+
+#include <wx/grid.h>
+
+#include "plotpanel.hpp"
+
+namespace jp {
+	namespace visx {
+		namespace gui {
+			/* The TableGridModel shows an UncertaintyTable in a wxGrid without copying
+			 * it. The grid only asks for the cells it draws, so only the visible rows
+			 * are formatted, when they are drawn. The result column shows the result
+			 * after every row, simplified to its significant figures, or "..." while
+			 * the row is not computed yet.
+			 */
+			class TableGridModel : public wxGridTableBase {
+			public:
+				enum {
+					COLUMN_OPERATION,
+					COLUMN_VALUE,
+					COLUMN_UNCERTAINTY,
+					COLUMN_RESULT,
+					COLUMN_COUNT
+				};
+				TableGridModel(uasf::UncertaintyTable *table);
+				virtual int GetNumberRows(void);
+				virtual int GetNumberCols(void);
+				virtual bool IsEmptyCell(int row, int col);
+				virtual wxString GetValue(int row, int col);
+				// This method changes the row from the text of an edited cell. The
+				// operation of the first (starting) row and the result column can not
+				// be changed.
+				virtual void SetValue(int row, int col, const wxString &value);
+				virtual wxString GetColLabelValue(int col);
+				virtual wxString GetRowLabelValue(int row);
+			private:
+				uasf::UncertaintyTable *table_;
+			};
+
+			/* The TablePanel holds an UncertaintyTable, the grid which shows it, and a
+			 * plot of its results under the grid.
+			 * The table is always in a batch, so an edit only remembers the lowest
+			 * changed row. The rows are computed when the program is idle, in slices of
+			 * idle_slice_rows until idle_budget_ms milliseconds have passed in the idle
+			 * event, so the grid can be scrolled and edited while a large table is
+			 * computed. When every row is computed, the batch is ended
+			 * (which reports the change to the observers of the table) and a new one
+			 * begins.
+			 */
+			class TablePanel : public wxPanel {
+			public:
+				// The number of rows computed at once, and the time after which an idle
+				// event stops computing them.
+				static const size_t idle_slice_rows = 1024;
+				static const long idle_budget_ms = 8;
+				TablePanel(wxWindow *parent);
+				~TablePanel(void);
+				// This method adds a row after the row of the cursor.
+				void addRow(void);
+				// This method removes the row of the cursor (unless it is the starting
+				// row).
+				void removeRow(void);
+				// This method replaces the table with a table file. It returns false if
+				// the file could not be read.
+				bool openTable(const wxString &path);
+				uasf::UncertaintyTable &getTable(void);
+				void onIdle(wxIdleEvent &event);
+			private:
+				// This method shows the result of the table, or that it is being computed.
+				void updateStatus(void);
+				// This method tells the grid that rows were added (count > 0) or removed
+				// (count < 0) at row.
+				void notifyRows(size_t row, long count);
+				uasf::UncertaintyTable table_;
+				TableGridModel *model_;
+				wxGrid *grid_;
+				PlotPanel *plot_;
+				wxStaticText *status_;
+				u64 observer_;
+
+				DECLARE_EVENT_TABLE();
+			};
+		} // namespace gui
+	} // namespace visx
+} // namespace jp
+
+#endif
@@ -0,0 +1,59 @@
+/* include/jp/visx/hash.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_HASH_HPP
+#define JP_VISX_HASH_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../def.h"
+
+namespace jp {
+	namespace visx {
+		/* The XxHash64 class computes the 64-bit xxHash (XXH64) of data which is
+		 * given in pieces. The bytes are read in the byte order of the host, so the
+		 * hashes are only meant to be compared within one process.
+		 */
+		class XxHash64 {
+		public:
+			XxHash64(u64 seed = 0);
+			// This method starts a new hash with the specified seed.
+			void reset(u64 seed = 0);
+			// This method adds bytes to the hash.
+			void update(const void *data, size_t size);
+			// This method returns the hash of the bytes added so far. More bytes may
+			// be added after it is called.
+			u64 digest(void) const;
+		private:
+			u64 accumulators_[4],
+				seed_,
+				total_size_;
+			// The bytes which do not fill a stripe of 32 bytes yet.
+			u8 buffer_[32];
+			size_t buffer_size_;
+		}; // class XxHash64
+
+		// This function returns the 64-bit xxHash of size bytes of data.
+		u64 xxHash64(const void *data, size_t size, u64 seed = 0);
+	} // namespace visx
+} // namespace jp
+
+#endif
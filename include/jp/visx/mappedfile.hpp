@@ -0,0 +1,75 @@
+/* include/jp/visx/mappedfile.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_MAPPEDFILE_HPP
+#define JP_VISX_MAPPEDFILE_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../def.h"
+
+namespace jp {
+	namespace visx {
+		/* The MappedFile maps a whole file into memory for reading. The pages are
+		 * loaded when they are first read, and are shared with every other process
+		 * which maps or reads the same file.
+		 */
+		class MappedFile {
+		public:
+			MappedFile(void);
+			MappedFile(MappedFile &&other);
+			MappedFile &operator=(MappedFile &&other);
+			MappedFile(const MappedFile &) = delete;
+			MappedFile &operator=(const MappedFile &) = delete;
+			~MappedFile(void);
+			// This method maps the file at path. If another file is mapped, it is
+			// unmapped first. It returns false if the file could not be mapped.
+			// Empty files can not be mapped.
+			bool open(const char *path);
+			// This method unmaps the file. It does nothing if no file is mapped.
+			void close(void);
+			// This method returns whether a file is mapped.
+			bool isOpen(void) const;
+			// This method returns the start of the mapping, or NULL if no file is
+			// mapped.
+			const void *getData(void) const;
+			// This method returns the size of the mapping.
+			size_t getSize(void) const;
+		private:
+			void *data_;
+			size_t size_;
+#ifdef _WIN32
+			void *file_handle_,
+				 *mapping_handle_;
+#endif
+		}; // class MappedFile
+
+		// This function writes the data of the file at path which the system still
+		// holds in memory to the disk. It returns false if it could not.
+		bool syncFile(const char *path);
+		// This function moves the file at from to to, replacing the file at to if
+		// there is one, in a single step: a crash leaves either file whole. Both
+		// paths must be in the same directory.
+		bool replaceFile(const char *from, const char *to);
+	} // namespace visx
+} // namespace jp
+
+#endif
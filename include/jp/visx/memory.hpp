@@ -0,0 +1,134 @@
+/* include/jp/visx/memory.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef JP_VISX_MEMORY_HPP
+#define JP_VISX_MEMORY_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../def.h"
+#include <stddef.h>
+#include <type_traits>
+#include <vector>
+
+namespace jp {
+	namespace visx {
+		/* The MemoryResource class is the source of the memory of the containers
+		 * which take one (in the manner of std::pmr::memory_resource, which is not
+		 * available in C++14). The containers hold a pointer to it, so it must live
+		 * longer than they do.
+		 */
+		class MemoryResource {
+		public:
+			virtual ~MemoryResource(void) {}
+			// This method returns size bytes aligned to alignment (a power of two).
+			virtual void *allocate(size_t size, size_t alignment) = 0;
+			// This method gives back memory returned by allocate with the same size
+			// and alignment.
+			virtual void deallocate(void *p, size_t size, size_t alignment) = 0;
+		}; // class MemoryResource
+
+		// This function returns the resource which uses operator new and operator
+		// delete. It is used when no resource is specified.
+		MemoryResource *getDefaultResource(void);
+
+		/* The MonotonicArena hands out memory from large blocks by moving a pointer,
+		 * and never gives back single allocations: deallocate does nothing. Its
+		 * memory is given back all at once with reset (which keeps the blocks for
+		 * the next allocations) or release. It may not be used by several threads
+		 * at once.
+		 */
+		class MonotonicArena : public MemoryResource {
+		public:
+			// This constructor sets the size of the blocks. Allocations which do not
+			// fit in a block get a block of their own.
+			MonotonicArena(size_t block_size = 64 * 1024);
+			MonotonicArena(const MonotonicArena &) = delete;
+			MonotonicArena &operator=(const MonotonicArena &) = delete;
+			~MonotonicArena(void);
+			void *allocate(size_t size, size_t alignment) override;
+			void deallocate(void *p, size_t size, size_t alignment) override;
+			// This method makes every block free again, without giving them back.
+			// The memory handed out before must no longer be used.
+			void reset(void);
+			// This method gives back every block.
+			void release(void);
+			// This method returns the number of bytes in the blocks.
+			size_t getReservedBytes(void) const;
+		private:
+			struct Block {
+				u8 *data;
+				size_t size;
+			};
+			std::vector<Block> blocks_;
+			// The block which is being filled, and the bytes used in it.
+			size_t current_,
+				   used_,
+				   block_size_;
+		}; // class MonotonicArena
+
+		/* The ResourceAllocator is an allocator for the standard containers which
+		 * takes its memory from a MemoryResource. Like std::pmr::polymorphic_allocator,
+		 * it is not given to copies of a container (they use the default resource),
+		 * and it is not moved or swapped with the container.
+		 */
+		template <typename T>
+		class ResourceAllocator {
+		public:
+			typedef T value_type;
+			typedef std::false_type propagate_on_container_copy_assignment;
+			typedef std::false_type propagate_on_container_move_assignment;
+			typedef std::false_type propagate_on_container_swap;
+			typedef std::false_type is_always_equal;
+
+			ResourceAllocator(MemoryResource *resource = nullptr) : resource_(resource ? resource : getDefaultResource()) {}
+			template <typename U>
+			ResourceAllocator(const ResourceAllocator<U> &other) : resource_(other.getResource()) {}
+			T *allocate(size_t n) {
+				return (T *)resource_->allocate(n * sizeof(T), alignof(T));
+			}
+			void deallocate(T *p, size_t n) {
+				resource_->deallocate(p, n * sizeof(T), alignof(T));
+			}
+			ResourceAllocator select_on_container_copy_construction(void) const {
+				return ResourceAllocator();
+			}
+			MemoryResource *getResource(void) const {
+				return resource_;
+			}
+		private:
+			MemoryResource *resource_;
+		}; // class ResourceAllocator
+
+		template <typename T, typename U>
+		bool operator==(const ResourceAllocator<T> &a, const ResourceAllocator<U> &b) {
+			return a.getResource() == b.getResource();
+		}
+
+		template <typename T, typename U>
+		bool operator!=(const ResourceAllocator<T> &a, const ResourceAllocator<U> &b) {
+			return a.getResource() != b.getResource();
+		}
+	} // namespace visx
+} // namespace jp
+
+#endif
@@ -0,0 +1,99 @@
+/* include/jp/visx/orderindex.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef JP_VISX_ORDERINDEX_HPP
+#define JP_VISX_ORDERINDEX_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../def.h"
+#include <stddef.h>
+#include <vector>
+
+namespace jp {
+	namespace visx {
+		/* The OrderIndex keeps a handle for every item of a sequence (for example the
+		 * rows of a table) which stays the same when items are inserted, removed or
+		 * swapped before it. The items are the nodes of a treap ordered by position,
+		 * where every node knows the size of its subtree, so a handle is found from
+		 * its position and a position from its handle in O(log n). The handle leads
+		 * to its node in O(1). Handles are never zero, and the handle of a removed
+		 * item is not given to another item until 2^32 items were removed from the
+		 * same slot, so it is reported as invalid instead. Nodes are kept in vectors
+		 * and refer to each other by index, so copying an index copies the handles.
+		 */
+		class OrderIndex {
+		public:
+			// The handle which is never valid.
+			static const u64 invalid_handle = 0;
+			OrderIndex(void);
+			// This method returns the number of items.
+			size_t count(void) const;
+			// This method inserts an item at position (at the end if position is past
+			// it) and returns its handle.
+			u64 insert(size_t position);
+			// This method removes the item at position, if it exists.
+			void erase(size_t position);
+			// This method exchanges the handles of the items at the two positions.
+			void swap(size_t position1, size_t position2);
+			// This method removes every item and inserts count new items. It takes
+			// O(count) time.
+			void reset(size_t count);
+			// This method returns the handle of the item at position, or
+			// invalid_handle if there is none.
+			u64 getHandle(size_t position) const;
+			// This method returns the position of the item with the handle, or
+			// SIZE_MAX if the item was removed or the handle is not valid.
+			size_t find(u64 handle) const;
+		private:
+			// Index 0 of nodes_ is the empty tree, and index 0 of slots_ is unused.
+			struct Node {
+				u32 left,
+					right,
+					parent,
+					size,
+					priority,
+					slot;
+			};
+			struct Slot {
+				u32 node,
+					generation;
+			};
+			u32 newNode(void);
+			void freeNode(u32 node);
+			u32 nodeAt(size_t position) const;
+			void update(u32 node);
+			// These methods split the tree into its first count nodes and the rest,
+			// and join two trees.
+			void split(u32 tree, size_t count, u32 *left_dest, u32 *right_dest);
+			u32 merge(u32 left, u32 right);
+			std::vector<Node> nodes_;
+			std::vector<Slot> slots_;
+			std::vector<u32> free_nodes_,
+							 free_slots_;
+			u32 root_,
+				random_;
+		}; // class OrderIndex
+	} // namespace visx
+} // namespace jp
+
+#endif
@@ -0,0 +1,246 @@
+/* include/jp/visx/smallvector.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef JP_VISX_SMALLVECTOR_HPP
+#define JP_VISX_SMALLVECTOR_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../def.h"
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace jp {
+	namespace visx {
+		/* The SmallVector is a vector which keeps its first N elements inside the
+		 * object, and only allocates (from its allocator) when it grows past them.
+		 * Creating, copying and destroying a short SmallVector does not allocate.
+		 * It has the part of the interface of std::vector which the library uses,
+		 * and its iterators are pointers. Like std::vector, any change to its size
+		 * may invalidate them.
+		 */
+		template <typename T, size_t N, typename Allocator = std::allocator<T>>
+		class SmallVector {
+			typedef std::allocator_traits<Allocator> Traits;
+		public:
+			typedef T value_type;
+			typedef Allocator allocator_type;
+			typedef T *iterator;
+			typedef const T *const_iterator;
+
+			explicit SmallVector(const Allocator &allocator = Allocator()) : data_(this->inlineData()), size_(0), capacity_(N), allocator_(allocator) {}
+			SmallVector(const SmallVector &other) : SmallVector(Traits::select_on_container_copy_construction(other.allocator_)) {
+				this->assign(other.begin(), other.end());
+			}
+			SmallVector(SmallVector &&other) : SmallVector(other.allocator_) {
+				this->take(std::move(other));
+			}
+			~SmallVector(void) {
+				this->clear();
+				this->freeData();
+			}
+			SmallVector &operator=(const SmallVector &other) {
+				if (this != &other) this->assign(other.begin(), other.end());
+				return *this;
+			}
+			SmallVector &operator=(SmallVector &&other) {
+				if (this != &other) {
+					this->clear();
+					this->take(std::move(other));
+				}
+				return *this;
+			}
+
+			size_t size(void) const {
+				return size_;
+			}
+			bool empty(void) const {
+				return !size_;
+			}
+			size_t capacity(void) const {
+				return capacity_;
+			}
+			// This method returns whether the elements are inside the object.
+			bool isInline(void) const {
+				return data_ == this->inlineData();
+			}
+			Allocator get_allocator(void) const {
+				return allocator_;
+			}
+			T *data(void) {
+				return data_;
+			}
+			const T *data(void) const {
+				return data_;
+			}
+			iterator begin(void) {
+				return data_;
+			}
+			iterator end(void) {
+				return data_ + size_;
+			}
+			const_iterator begin(void) const {
+				return data_;
+			}
+			const_iterator end(void) const {
+				return data_ + size_;
+			}
+			T &operator[](size_t i) {
+				return data_[i];
+			}
+			const T &operator[](size_t i) const {
+				return data_[i];
+			}
+			T &front(void) {
+				return data_[0];
+			}
+			const T &front(void) const {
+				return data_[0];
+			}
+			T &back(void) {
+				return data_[size_ - 1];
+			}
+			const T &back(void) const {
+				return data_[size_ - 1];
+			}
+
+			// This method makes sure the vector can hold capacity elements without
+			// allocating again.
+			void reserve(size_t capacity) {
+				if (capacity <= capacity_) return;
+				T *data = Traits::allocate(allocator_, capacity);
+				for (size_t i = 0; i < size_; ++i) {
+					new (data + i) T(std::move(data_[i]));
+					data_[i].~T();
+				}
+				this->freeData();
+				data_ = data;
+				capacity_ = capacity;
+			}
+			void clear(void) {
+				for (size_t i = 0; i < size_; ++i) {
+					data_[i].~T();
+				}
+				size_ = 0;
+			}
+			template <typename... Args>
+			void emplace_back(Args &&...args) {
+				if (size_ == capacity_) {
+					// The arguments may refer to an element, so the new element is made
+					// before the elements are moved.
+					T element(std::forward<Args>(args)...);
+					this->reserve(this->grownCapacity(size_ + 1));
+					new (data_ + size_) T(std::move(element));
+				} else {
+					new (data_ + size_) T(std::forward<Args>(args)...);
+				}
+				++size_;
+			}
+			void push_back(const T &value) {
+				this->emplace_back(value);
+			}
+			void push_back(T &&value) {
+				this->emplace_back(std::move(value));
+			}
+			iterator insert(const_iterator position, const T &value) {
+				return this->insert(position, T(value));
+			}
+			iterator insert(const_iterator position, T &&value) {
+				size_t i = position - data_;
+				if (i == size_) {
+					this->emplace_back(std::move(value));
+					return data_ + i;
+				}
+				T element(std::move(value));
+				if (size_ == capacity_) this->reserve(this->grownCapacity(size_ + 1));
+				// Shift the elements after the position up by one.
+				new (data_ + size_) T(std::move(data_[size_ - 1]));
+				for (size_t j = size_ - 1; j > i; --j) {
+					data_[j] = std::move(data_[j - 1]);
+				}
+				data_[i] = std::move(element);
+				++size_;
+				return data_ + i;
+			}
+			iterator erase(const_iterator position) {
+				size_t i = position - data_;
+				for (size_t j = i; j + 1 < size_; ++j) {
+					data_[j] = std::move(data_[j + 1]);
+				}
+				data_[--size_].~T();
+				return data_ + i;
+			}
+			template <typename Iterator>
+			void assign(Iterator first, Iterator last) {
+				this->clear();
+				this->reserve(std::distance(first, last));
+				for ( ; first != last; ++first) {
+					new (data_ + size_) T(*first);
+					++size_;
+				}
+			}
+		private:
+			T *inlineData(void) {
+				return reinterpret_cast<T *>(&inline_);
+			}
+			const T *inlineData(void) const {
+				return reinterpret_cast<const T *>(&inline_);
+			}
+			size_t grownCapacity(size_t needed) const {
+				return needed > 2 * capacity_ ? needed : 2 * capacity_;
+			}
+			// This method gives back the allocated elements (which must be destroyed
+			// already) and goes back to the inline ones.
+			void freeData(void) {
+				if (!this->isInline()) Traits::deallocate(allocator_, data_, capacity_);
+				data_ = this->inlineData();
+				capacity_ = N;
+			}
+			// This method takes the elements of other (this vector must be empty).
+			// The allocation is taken over if both vectors use the same allocator.
+			void take(SmallVector &&other) {
+				if (!other.isInline() && allocator_ == other.allocator_) {
+					this->freeData();
+					data_ = other.data_;
+					size_ = other.size_;
+					capacity_ = other.capacity_;
+					other.data_ = other.inlineData();
+					other.size_ = 0;
+					other.capacity_ = N;
+					return;
+				}
+				this->assign(std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+				other.clear();
+			}
+			T *data_;
+			size_t size_,
+				   capacity_;
+			Allocator allocator_;
+			typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type inline_;
+		}; // class SmallVector
+	} // namespace visx
+} // namespace jp
+
+#endif
@@ -0,0 +1,162 @@
+/* include/jp/visx/spscqueue.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_SPSCQUEUE_HPP
+#define JP_VISX_SPSCQUEUE_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../def.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace jp {
+	namespace visx {
+		/* The SpscQueue passes values from exactly one producer thread to exactly one
+		 * consumer thread without locks. It is a ring of fixed capacity: push waits
+		 * while the ring is full and pop waits while it is empty. A side which waits
+		 * spins and yields for a while, and then sleeps until the other side changes
+		 * the queue, so an idle queue does not keep a processor busy. The producer
+		 * closes the queue after its last value, and pop then fails once the queue is
+		 * drained.
+		 */
+		template <typename T>
+		class SpscQueue {
+		public:
+			// The capacity is rounded up to a power of two.
+			SpscQueue(size_t capacity) : head_(0), tail_(0), closed_(false), sleepers_(0) {
+				size_t size = 2;
+				while (size < capacity) size <<= 1;
+				slots_.resize(size);
+				mask_ = size - 1;
+			}
+			SpscQueue(const SpscQueue &) = delete;
+			SpscQueue &operator=(const SpscQueue &) = delete;
+
+			// This method adds a value to the end of the queue. It returns false if the
+			// queue is full. It may only be called by the producer.
+			bool tryPush(T &&value) {
+				if (!this->put(std::move(value))) return false;
+				this->wake();
+				return true;
+			}
+			// This method removes the value at the front of the queue. It returns false
+			// if the queue is empty. It may only be called by the consumer.
+			bool tryPop(T *value_dest) {
+				if (!this->take(value_dest)) return false;
+				this->wake();
+				return true;
+			}
+			// This method waits until the value can be added.
+			void push(T &&value) {
+				this->wait([this, &value](void) {
+					return this->put(std::move(value));
+				});
+				this->wake();
+			}
+			// This method waits until a value can be removed. It returns false if the
+			// queue was closed and every value was removed.
+			bool pop(T *value_dest) {
+				bool popped = false;
+				this->wait([this, value_dest, &popped](void) {
+					if ((popped = this->take(value_dest))) return true;
+					if (!closed_.load(std::memory_order_acquire)) return false;
+					// The values pushed before the queue was closed are visible now.
+					popped = this->take(value_dest);
+					return true;
+				});
+				if (popped) this->wake();
+				return popped;
+			}
+			// This method tells the consumer that no more values will be pushed. It
+			// may only be called by the producer.
+			void close(void) {
+				closed_.store(true, std::memory_order_release);
+				this->wake();
+			}
+		private:
+			// The number of times a side tries again before it yields, and then before
+			// it sleeps.
+			static const u32 spin_count = 64,
+							 yield_count = 16;
+
+			bool put(T &&value) {
+				size_t tail = tail_.load(std::memory_order_relaxed);
+				if (tail - head_.load(std::memory_order_acquire) > mask_) return false;
+				slots_[tail & mask_] = std::move(value);
+				tail_.store(tail + 1, std::memory_order_release);
+				return true;
+			}
+
+			bool take(T *value_dest) {
+				size_t head = head_.load(std::memory_order_relaxed);
+				if (head == tail_.load(std::memory_order_acquire)) return false;
+				*value_dest = std::move(slots_[head & mask_]);
+				head_.store(head + 1, std::memory_order_release);
+				return true;
+			}
+
+			// This method waits until ready returns true. Before sleeping, the side
+			// counts itself in sleepers_ and checks once more. The fences of wait and
+			// wake make sure that either this check sees the change of the other side,
+			// or the other side sees the sleeper and wakes it.
+			template <typename Ready>
+			void wait(Ready ready) {
+				for (u32 spins = 0; spins < spin_count + yield_count; ++spins) {
+					if (ready()) return;
+					if (spins >= spin_count) std::this_thread::yield();
+				}
+				std::unique_lock<std::mutex> lock(mutex_);
+				sleepers_.fetch_add(1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				while (!ready()) wakeup_.wait(lock);
+				sleepers_.fetch_sub(1, std::memory_order_relaxed);
+			}
+
+			// This method wakes the other side if it sleeps, after this side changed the
+			// queue.
+			void wake(void) {
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (!sleepers_.load(std::memory_order_relaxed)) return;
+				std::lock_guard<std::mutex> lock(mutex_);
+				wakeup_.notify_all();
+			}
+
+			std::vector<T> slots_;
+			size_t mask_;
+			// The head is written by the consumer and the tail by the producer. They are
+			// kept on separate cache lines so the two threads do not share one.
+			alignas(64) std::atomic<size_t> head_;
+			alignas(64) std::atomic<size_t> tail_;
+			// The state of the sides which wait, on a line of its own.
+			alignas(64) std::atomic<bool> closed_;
+			std::atomic<u32> sleepers_;
+			std::mutex mutex_;
+			std::condition_variable wakeup_;
+		}; // class SpscQueue
+	} // namespace visx
+} // namespace jp
+
+#endif
@@ -0,0 +1,72 @@
+/* include/jp/visx/threadpool.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_THREADPOOL_HPP
+#define JP_VISX_THREADPOOL_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../def.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jp {
+	namespace visx {
+		/* The ThreadPool runs tasks on a fixed set of worker threads. It is shared by
+		 * the parts of the library which split their work between threads.
+		 */
+		class ThreadPool {
+		public:
+			// This constructor starts the specified number of workers. If threads is
+			// zero, one worker is started per hardware thread.
+			ThreadPool(size_t threads = 0);
+			ThreadPool(const ThreadPool &) = delete;
+			ThreadPool &operator=(const ThreadPool &) = delete;
+			// The destructor finishes the queued tasks and stops the workers.
+			~ThreadPool(void);
+			// This method returns the number of workers.
+			size_t getThreadCount(void) const;
+			// This method queues a task. It returns immediately.
+			void submit(std::function<void(void)> task);
+			// This method splits [0, count) into ranges of at most grain elements and
+			// calls fn(begin, end) for every range, on the workers and on the calling
+			// thread. It returns when every range is done. It may be called from a task.
+			void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &fn);
+			// This method returns the pool used when no pool is specified. It is
+			// started on the first call.
+			static ThreadPool &global(void);
+		private:
+			// This method is run by every worker.
+			void work(void);
+			std::vector<std::thread> threads_;
+			std::deque<std::function<void(void)>> tasks_;
+			std::mutex mutex_;
+			std::condition_variable condition_;
+			bool stopping_;
+		}; // class ThreadPool
+	} // namespace visx
+} // namespace jp
+
+#endif
@@ -24,26 +24,14 @@ extern "C" {
 #endif
 
 #include "../def.h"
-
-typedef enum {
-	JP_VISX_UASF_UOPERATION_NUL = -1,
-	JP_VISX_UASF_UOPERATION_ADD,
-	JP_VISX_UASF_UOPERATION_SUB,
-	JP_VISX_UASF_UOPERATION_SUBO,
-	JP_VISX_UASF_UOPERATION_MUL,
-	JP_VISX_UASF_UOPERATION_DIV,
-	JP_VISX_UASF_UOPERATION_DIVO,
-	JP_VISX_UASF_UOPERATION_POW,
-	JP_VISX_UASF_UOPERATION_POWO,
-	JP_VISX_UASF_UOPERATION_MULC,
-	JP_VISX_UASF_UOPERATION_DIVC,
-	JP_VISX_UASF_UOPERATION_INVALID,
-} jp_visx_uasf_UncertaintyTableElementType;
+#include "uasf/elementtype.h"
 
 // This only emulates the function of the UncertaintyTable class.
 // This is because there is no function in the UncertaintyTable which provides
 // access to a UncertaintyTableElement pointer.
 typedef void jp_visx_uasf_UncertaintyTable;
+typedef void jp_visx_uasf_UncertaintyTableSnapshot;
+typedef void jp_visx_uasf_UncertaintyTableArena;
 
 jp_visx_uasf_UncertaintyTable *jp_visx_uasf_UncertaintyTable_new1(void);
 jp_visx_uasf_UncertaintyTable *jp_visx_uasf_UncertaintyTable_new2(size_t starting_capacity);
@@ -69,10 +57,68 @@ size_t jp_visx_uasf_UncertaintyTable_count(jp_visx_uasf_UncertaintyTable *table)
 double jp_visx_uasf_UncertaintyTable_getResult(jp_visx_uasf_UncertaintyTable *table);
 double jp_visx_uasf_UncertaintyTable_getResultingUncertainty(jp_visx_uasf_UncertaintyTable *table);
 void jp_visx_uasf_UncertaintyTable_recompute(jp_visx_uasf_UncertaintyTable *table);
+// A handle of a row stays valid while rows are added, removed or swapped
+// around it (see UncertaintyTable::getHandle). It is never 0. findRow returns
+// SIZE_MAX if the handle is not valid.
+u64 jp_visx_uasf_UncertaintyTable_getHandle(jp_visx_uasf_UncertaintyTable *table, size_t row);
+size_t jp_visx_uasf_UncertaintyTable_findRow(jp_visx_uasf_UncertaintyTable *table, u64 handle);
+void jp_visx_uasf_UncertaintyTable_releaseHandles(jp_visx_uasf_UncertaintyTable *table);
+// These functions add rows to the end of the table, or replace every row of
+// the table (the first row is made the starting row), from parallel arrays of
+// count rows. The table is computed once.
+void jp_visx_uasf_UncertaintyTable_addRows(jp_visx_uasf_UncertaintyTable *table, const jp_visx_uasf_UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count);
+void jp_visx_uasf_UncertaintyTable_assignRows(jp_visx_uasf_UncertaintyTable *table, const jp_visx_uasf_UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count);
+// These functions copy at most count rows starting at starting_row (or their
+// cumulatives, which are the inputs of the rows) into the arrays, which may be
+// NULL. They return the number of rows copied.
+size_t jp_visx_uasf_UncertaintyTable_getRows(jp_visx_uasf_UncertaintyTable *table, size_t starting_row, size_t count, jp_visx_uasf_UncertaintyTableElementType *types_dest, double *values_dest, double *uncertainties_dest);
+size_t jp_visx_uasf_UncertaintyTable_getCumulatives(jp_visx_uasf_UncertaintyTable *table, size_t starting_row, size_t count, double *cumulatives_dest, double *cumulative_uncertainties_dest);
 void jp_visx_uasf_UncertaintyTable_free(jp_visx_uasf_UncertaintyTable *table);
+void jp_visx_uasf_UncertaintyTable_publish(jp_visx_uasf_UncertaintyTable *table);
+void jp_visx_uasf_UncertaintyTable_setPublishing(jp_visx_uasf_UncertaintyTable *table, bool publishing);
+// The snapshot must be freed with jp_visx_uasf_UncertaintyTableSnapshot_free. It is
+// NULL if no snapshot was published.
+jp_visx_uasf_UncertaintyTableSnapshot *jp_visx_uasf_UncertaintyTable_getSnapshot(jp_visx_uasf_UncertaintyTable *table);
+// The callback is told that the rows from first_row on (row_count rows) may
+// have changed, and the new result (see UncertaintyTableChange). subscribe
+// returns 0 if the callback is NULL.
+typedef void (*jp_visx_uasf_UncertaintyTable_ChangeCallback)(jp_visx_uasf_UncertaintyTable *table, size_t first_row, size_t row_count, double result, double resulting_uncertainty, void *user_data);
+u64 jp_visx_uasf_UncertaintyTable_subscribe(jp_visx_uasf_UncertaintyTable *table, jp_visx_uasf_UncertaintyTable_ChangeCallback callback, void *user_data);
+void jp_visx_uasf_UncertaintyTable_unsubscribe(jp_visx_uasf_UncertaintyTable *table, u64 id);
+void jp_visx_uasf_UncertaintyTable_setCoalescing(jp_visx_uasf_UncertaintyTable *table, bool coalescing);
+void jp_visx_uasf_UncertaintyTable_flushChanges(jp_visx_uasf_UncertaintyTable *table);
+size_t jp_visx_uasf_UncertaintyTableSnapshot_count(jp_visx_uasf_UncertaintyTableSnapshot *snapshot);
+jp_visx_uasf_UncertaintyTableElementType jp_visx_uasf_UncertaintyTableSnapshot_getType(jp_visx_uasf_UncertaintyTableSnapshot *snapshot, size_t row);
+double jp_visx_uasf_UncertaintyTableSnapshot_getValue(jp_visx_uasf_UncertaintyTableSnapshot *snapshot, size_t row);
+double jp_visx_uasf_UncertaintyTableSnapshot_getUncertainty(jp_visx_uasf_UncertaintyTableSnapshot *snapshot, size_t row);
+double jp_visx_uasf_UncertaintyTableSnapshot_getResult(jp_visx_uasf_UncertaintyTableSnapshot *snapshot);
+double jp_visx_uasf_UncertaintyTableSnapshot_getResultingUncertainty(jp_visx_uasf_UncertaintyTableSnapshot *snapshot);
+u64 jp_visx_uasf_UncertaintyTableSnapshot_getVersion(jp_visx_uasf_UncertaintyTableSnapshot *snapshot);
+void jp_visx_uasf_UncertaintyTableSnapshot_free(jp_visx_uasf_UncertaintyTableSnapshot *snapshot);
+// A block_size of zero uses the default (64 KiB). The tables of an arena must
+// not be freed with jp_visx_uasf_UncertaintyTable_free: they are all destroyed
+// by jp_visx_uasf_UncertaintyTableArena_reset or _free.
+jp_visx_uasf_UncertaintyTableArena *jp_visx_uasf_UncertaintyTableArena_new(size_t block_size);
+jp_visx_uasf_UncertaintyTable *jp_visx_uasf_UncertaintyTableArena_newTable(jp_visx_uasf_UncertaintyTableArena *arena, size_t starting_capacity, double starting_value, double starting_uncertainty);
+size_t jp_visx_uasf_UncertaintyTableArena_count(jp_visx_uasf_UncertaintyTableArena *arena);
+void jp_visx_uasf_UncertaintyTableArena_reset(jp_visx_uasf_UncertaintyTableArena *arena);
+void jp_visx_uasf_UncertaintyTableArena_free(jp_visx_uasf_UncertaintyTableArena *arena);
 
 u64 jp_visx_uasf_sigFigCount(const char *s);
 void jp_visx_uasf_simplifyUncertainty(double value, double uncertainty, double *value_dest, double *uncertainty_dest);
+size_t jp_visx_uasf_formatUncertainty(double value, double uncertainty, const char *separator, char *dest, size_t size);
+void jp_visx_uasf_setSimplifyCacheEnabled(bool enabled);
+bool jp_visx_uasf_isSimplifyCacheEnabled(void);
+void jp_visx_uasf_getSimplifyCacheStats(u64 *hits_dest, u64 *misses_dest);
+void jp_visx_uasf_resetSimplifyCacheStats(void);
+// See InstrumentationStats. The histograms have
+// JP_VISX_UASF_INSTRUMENTATION_BUCKETS buckets.
+#define JP_VISX_UASF_INSTRUMENTATION_BUCKETS 32
+bool jp_visx_uasf_isInstrumented(void);
+void jp_visx_uasf_getInstrumentationCounters(u64 *computes_dest, u64 *computed_rows_dest, u64 *simplifications_dest, u64 *nan_short_circuits_dest, u64 *allocations_dest);
+void jp_visx_uasf_getInstrumentationRowsHistogram(u64 *buckets_dest);
+void jp_visx_uasf_getInstrumentationTimeHistogram(jp_visx_uasf_UncertaintyTableElementType type, u64 *buckets_dest);
+void jp_visx_uasf_resetInstrumentationStats(void);
 
 #ifdef __cplusplus
 }
@@ -25,11 +25,18 @@
 #endif
 
 #include "../def.h"
+#include "memory.hpp"
+#include "orderindex.hpp"
+#include "smallvector.hpp"
+#include <functional>
+#include <memory>
 #include <vector>
 #include <string>
 
 namespace jp {
 	namespace visx {
+		class ThreadPool;
+
 		namespace uasf { // UASF stands for Uncertainty and Significant Figures
 			/* This enum contains the different types of operations. It starts at -1 (NUL).
 			 * Here is a description of each value:
@@ -143,21 +150,60 @@ namespace jp {
 											cumulative_uncertainty_;
 			};
 
+			class UncertaintyTableSnapshot;
+			class UncertaintyTable;
+
+			/* An UncertaintyTableChange tells the observers of a table which rows may
+			 * have changed: the rows from first_row to the end of the table (row_count
+			 * rows), their cumulatives, and the result. The rows before first_row and
+			 * their cumulatives did not change.
+			 */
+			typedef struct {
+				size_t first_row,
+					   row_count;
+				UncertaintyPair result;
+			} UncertaintyTableChange;
+
 			/* The UncertaintyTable class has a list of elements (UncertaintyTableElement)
 			 * It also has an output value and an output uncertainty.
 			 * Uncertainty Tables use doubles (long doubles aren't well supported on windows).
 			 */
 			class UncertaintyTable {
 			public:
+				// The number of rows (including the starting row) which are kept inside
+				// the table object. A table only allocates when it grows past them.
+				static const size_t inline_rows = 8;
 				// This constructor calls the other constructor with a starting capacity
-				// of 10.
+				// of inline_rows, so it does not allocate.
 				UncertaintyTable(void);
 				// This constructor allows the user to specify the starting capacity
-				// of the vector.
+				// of the vector. A capacity of at most inline_rows does not allocate.
 				UncertaintyTable(size_t starting_capacity);
 				UncertaintyTable(size_t starting_capacity, double starting_value, double starting_uncertainty);
+				// This constructor also takes the resource from which the rows are
+				// allocated (the default resource if it is NULL). A copy of the table
+				// uses the default resource.
+				UncertaintyTable(size_t starting_capacity, double starting_value, double starting_uncertainty, MemoryResource *resource);
+				// The rows, the handles and the plan go with a copy of a table. Its
+				// observers, its snapshots and whether it publishes them do not: a copy
+				// has none of them and does not publish.
+				UncertaintyTable(const UncertaintyTable &table);
+				// A moved table keeps everything, even its observers and its snapshots,
+				// and the table it is moved from is left empty.
+				UncertaintyTable(UncertaintyTable &&table);
+				// A table which is assigned takes the rows, the handles and the plan of
+				// the other table, and keeps its own observers and snapshots: it tells
+				// its observers that every row changed, and publishes a new snapshot if
+				// it publishes. A table it is moved from is left empty.
+				UncertaintyTable &operator=(const UncertaintyTable &table);
+				UncertaintyTable &operator=(UncertaintyTable &&table);
+				// This method returns the resource from which the rows are allocated.
+				MemoryResource *getMemoryResource(void) const;
 				// This method returns the current capacity of the table.
 				size_t getCapacity(void) const;
+				// This method makes sure the table can hold at least capacity rows
+				// without reallocating.
+				void reserve(size_t capacity);
 				// This method gets the current value of the table element on a specified
 				// row. If the row is invalid, it puts NaN into the result_dest.
 				// This method is equivalent to calling getValue on the corresponding
@@ -177,6 +223,11 @@ namespace jp {
 				UncertaintyTableElementType getType(size_t row) const;
 				// This method returns a constant reference to the specified row.
 				// If the row is invalid, it returns UncertaintyTableElement::invalid_element.
+				// If the last result of the table came from the ResultCache or the plan,
+				// the first call computes the cumulatives (which are mutable for this), so
+				// it must not be called by two threads at once in that case, even on a
+				// const table. Threads which read a table which is being changed should
+				// read its snapshots instead.
 				const UncertaintyTableElement &getElement(size_t row) const;
 				// This method adds a row to the end of the table.
 				void add(UncertaintyTableElementType type, double value, double uncertainty);
@@ -186,6 +237,9 @@ namespace jp {
 				void add(const UncertaintyTableElement &element);
 				// This method adds a row to the end of the table.
 				void add(UncertaintyTableElement &&element);
+				// This method adds count rows to the end of the table, and computes the
+				// table once, from the first of them.
+				void addRows(const UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count);
 				// This method removes the specified row from the table.
 				void remove(size_t row);
 				// This method clears the table. (Removes all elements.)
@@ -231,6 +285,18 @@ namespace jp {
 				double getStartingUncertainty(void) const;
 				// This method gets the starting value.
 				void getStartingValue(UncertaintyPair *value_dest) const;
+				// This method returns the handle of a row, or OrderIndex::invalid_handle
+				// if the row is invalid. A handle stays valid while rows are added,
+				// removed or swapped around its row (swap moves the handles with the
+				// rows), until its row is removed or the table is cleared or assigned.
+				// The table only keeps handles from the first call, which takes O(n).
+				// From then on, adding or removing a row also costs O(log n).
+				u64 getHandle(size_t row);
+				// This method returns the current row of a handle in O(log n), or
+				// SIZE_MAX if the handle is not valid.
+				size_t findRow(u64 handle) const;
+				// This method stops keeping handles. Every handle becomes invalid.
+				void releaseHandles(void);
 				// This method gets the number of elements in the table.
 				size_t count(void) const;
 				// This method gets the last computed result of the table.
@@ -241,14 +307,368 @@ namespace jp {
 				double getResultingUncertainty(void) const;
 				// Recompute the resulting value from the start.
 				void recompute(void);
+				// This method sets the pool on which the table is computed, or NULL (the
+				// default) to compute it on the calling thread. With a pool, when more than
+				// a few chunks of rows must be computed, the chunks are computed in
+				// parallel, each starting from the cumulatives stored in its first row (as
+				// if the rows before it had not changed). The chunks are then checked in
+				// order: a chunk which started from the wrong cumulatives is computed again
+				// until its cumulatives match the ones computed in parallel. The result is
+				// the same as without a pool. It is faster when the stored cumulatives are
+				// mostly right (for example when the table is recomputed without changes,
+				// or a change does not reach far), and about as fast otherwise.
+				void setComputePool(ThreadPool *pool);
+				ThreadPool *getComputePool(void) const;
+				// This method sets whether the table is computed from an optimized plan of
+				// its rows. It is false by default. The plan folds every run of ADD, SUB,
+				// MULC and DIVC rows (and rows which do nothing, like MUL by 1 +/- 0) into
+				// one step, which is rounded once instead of after every row. The result
+				// may therefore differ from the rows computed one by one: rounding the
+				// uncertainty after every row can lose most of it in a long run (0.01 +
+				// 0.001 rounds back to 0.01), while the plan keeps the whole sum. The
+				// rows are not changed, and their cumulatives are computed one by one
+				// when they are read (see getElement), from the lowest row which changed
+				// since they were last read. Since the cumulatives are those of the rows,
+				// computing the last row from its cumulative may not give getResult,
+				// which (like the result of a snapshot) is always the one of the plan.
+				// The plan is kept between computations and only built again from the
+				// changed rows, so recompute only evaluates its steps.
+				void setOptimizing(bool optimizing);
+				bool isOptimizing(void) const;
+				// This method returns the number of steps of the plan (zero if the table
+				// is not optimizing or was not computed yet).
+				size_t getPlanStepCount(void) const;
+				// This method replaces every row of the table with the provided elements.
+				// The first element is made the NUL starting row. If cumulatives_valid is
+				// true, the cumulatives stored in the elements are trusted and only the
+				// last row is computed. Otherwise, the table is recomputed from the start.
+				// If elements is empty, this is equivalent to calling clear.
+				void assign(std::vector<UncertaintyTableElement> &&elements, bool cumulatives_valid);
+				// This method starts a batch. While a batch is open, the methods which
+				// change the table do not compute it. They only remember the lowest row
+				// which must be computed. Batches may be nested.
+				void beginBatch(void);
+				// This method ends a batch. When the outermost batch ends, the table is
+				// computed once, starting from the lowest changed row.
+				void endBatch(void);
+				// This method returns whether a batch is open. While a batch is open,
+				// the cumulatives and the result may be out of date.
+				bool inBatch(void) const;
+				// This method returns the lowest row which is computed when the batch ends,
+				// or SIZE_MAX if there is none.
+				size_t getPendingRow(void) const;
+				// This method computes at most max_rows of the rows which are computed
+				// when the batch ends, without ending it, so that a large table can be
+				// computed in steps. It returns true when every row is computed, in which
+				// case the result is up to date.
+				bool computePending(size_t max_rows);
+				// This method publishes a snapshot of the table (see getSnapshot). If a
+				// batch is open, the snapshot is published when it ends.
+				void publish(void);
+				// This method sets whether the table publishes a snapshot after every
+				// change (or at the end of every batch). It is false by default. A
+				// snapshot shares the chunks of rows before the lowest changed row with
+				// the last snapshot, and copies the others, so changes which come
+				// together should be made in a batch.
+				void setPublishing(bool publishing);
+				bool isPublishing(void) const;
+				// This method returns the last published snapshot, or nullptr if none was
+				// published. Unlike the other methods, it may be called by any thread
+				// while the table is being changed.
+				std::shared_ptr<const UncertaintyTableSnapshot> getSnapshot(void) const;
+				// The observers of a table are called with the table and the change after
+				// every computation which is not deferred by a batch, so a batch is
+				// reported once, when it ends. A callback may read the table. A change it
+				// makes is reported after the callbacks of the current change. The
+				// observers are not copied with the table.
+				typedef std::function<void(const UncertaintyTable &, const UncertaintyTableChange &)> ChangeCallback;
+				// This method adds an observer and returns its id, which is never zero.
+				u64 subscribe(ChangeCallback callback);
+				// This method removes the observer with the id.
+				void unsubscribe(u64 id);
+				// This method sets whether the changes are held instead of reported. It is
+				// false by default. While it is true, the changes are merged into one,
+				// which is reported by flushChanges (for example once per frame), so
+				// several changes cost one update of the observers.
+				void setCoalescing(bool coalescing);
+				bool isCoalescing(void) const;
+				// This method reports the held change to the observers, if there is one.
+				// While a batch is open, the change is held until the batch ends.
+				void flushChanges(void);
+				// This method returns whether a change is held.
+				bool hasPendingChange(void) const;
 			private:
+				// This method replaces the rows, the handles and the plan of this table
+				// with those of table (see operator=).
+				void take(UncertaintyTable &&table);
 				// This method computes the table starting from starting_row.
 				// If starting_row >= count() then the method does nothing.
-				void compute(size_t starting_row);
-				std::vector<UncertaintyTableElement> elements_;
-				UncertaintyPair result_;
+				// If a batch is open, the computation is deferred until it ends.
+				// If every row must be computed and the global ResultCache is enabled,
+				// the result is looked up in the cache first.
+				// If rows_changed is false (for recompute), the plan is kept.
+				void compute(size_t starting_row, bool rows_changed = true);
+				// This method computes the rows from starting_row up to (not including)
+				// ending_row, without the cache, and sets the cumulatives of ending_row.
+				// It returns the next row to compute, or count() if the result was
+				// computed (which is also the case if a row was NaN). It only changes the
+				// mutable members, so it may be called by getElement.
+				size_t computeRows(size_t starting_row, size_t ending_row = SIZE_MAX) const;
+				// This method computes every row from starting_row on the compute pool.
+				void computeRowsParallel(size_t starting_row) const;
+				// This method computes the cumulatives of the rows from stale_row_ after
+				// the result was taken from the cache or the plan, and keeps the result
+				// of the plan.
+				void computeCumulatives(void) const;
+				// This method removes the steps of the plan which include row or a row
+				// after it.
+				void truncatePlan(size_t row);
+				// This method builds the missing steps of the plan and evaluates them.
+				void computePlan(void);
+				// A step of the plan: either a row which is computed like in computeRows,
+				// or a run of rows folded into value * scale + offset (and the same for
+				// the uncertainty).
+				struct PlanStep {
+					size_t first_row,
+						   row_count;
+					bool folded;
+					double scale,
+						   offset,
+						   uncertainty_scale,
+						   uncertainty_offset;
+					// The cumulative before the step, when it was last evaluated.
+					UncertaintyPair input;
+				};
+				/* The state of the features which most tables do not use: the snapshots
+				 * which are published, the handles, the plan and the observers. It is
+				 * allocated the first time one of them is used, so a table which does
+				 * not use them only holds a null pointer.
+				 */
+				struct Features {
+					Features(void);
+					// Only the handles and the plan are copied (see the copy constructor
+					// of UncertaintyTable).
+					Features(const Features &features);
+					// Whether a snapshot is published after every change, whether one
+					// must be published when the batch ends, and the version of the last
+					// snapshot.
+					bool publishing,
+						 publish_pending;
+					u64 version;
+					// The lowest row which changed since the last snapshot (SIZE_MAX if
+					// there is none). The chunks before it are shared with the last one.
+					size_t published_row;
+					// The handles of the rows. It is empty while the table does not keep
+					// handles.
+					OrderIndex handles;
+					bool optimizing;
+					std::vector<PlanStep> plan;
+					// The number of rows covered by the plan, and the number of steps
+					// whose input is up to date.
+					size_t plan_rows,
+						   plan_evaluated;
+					std::vector<std::pair<u64, ChangeCallback>> observers;
+					u64 next_observer;
+					// The lowest row of the change which was not reported yet (SIZE_MAX
+					// if there is none), whether changes are held until flushChanges,
+					// and whether the observers are being called.
+					size_t changed_row;
+					bool coalescing,
+						 notifying;
+				};
+				// This method returns the features, and allocates them the first time.
+				Features &features(void);
+				// This method returns the handles of the rows, or NULL if the table does
+				// not keep handles.
+				OrderIndex *handles(void);
+				// The rows and the result. They are mutable because the cumulatives of the
+				// rows are computed when they are first read (see getElement).
+				mutable SmallVector<UncertaintyTableElement, inline_rows, ResourceAllocator<UncertaintyTableElement>> elements_;
+				mutable UncertaintyPair result_;
+				// The depth of the open batches and the lowest row which was changed
+				// while they were open (SIZE_MAX if there is none).
+				size_t batch_depth_,
+					   dirty_row_;
+				// The row from which the cumulatives were not computed because the result
+				// was taken from the cache or the plan (SIZE_MAX if there is none). The
+				// cumulatives up to this row (included) are up to date.
+				mutable size_t stale_row_;
+				// The last snapshot. It is only accessed with std::atomic_load and
+				// std::atomic_store. It is not in the features, since any thread may
+				// read it.
+				std::shared_ptr<const UncertaintyTableSnapshot> snapshot_;
+				ThreadPool *compute_pool_;
+				std::unique_ptr<Features> features_;
 			}; // class UncertaintyTable
+
+			/* The UncertaintyTableSnapshot is a copy of an UncertaintyTable which never
+			 * changes, with every row computed. A thread which writes to a table
+			 * publishes snapshots of it, and threads which read the table take the last
+			 * snapshot, without locks. A snapshot stays valid as long as it is held, even
+			 * if the table publishes newer ones or is destroyed.
+			 *
+			 * The rows are kept in chunks of chunk_rows rows which are never changed, so
+			 * the snapshots of a table share the chunks which did not change between
+			 * them, like the versions of a PersistentUncertaintyTable.
+			 */
+			class UncertaintyTableSnapshot {
+			public:
+				// These methods work like the methods of UncertaintyTable with the same
+				// names.
+				size_t count(void) const;
+				UncertaintyTableElementType getType(size_t row) const;
+				double getValue(size_t row) const;
+				double getUncertainty(size_t row) const;
+				const UncertaintyTableElement &getElement(size_t row) const;
+				double getStartingValue(void) const;
+				double getStartingUncertainty(void) const;
+				double getResult(void) const;
+				void getResult(UncertaintyPair *result_dest) const;
+				double getResultingUncertainty(void) const;
+				// This method returns the version of the snapshot. The versions of the
+				// snapshots of a table start at 1 and increase by 1 with every snapshot.
+				u64 getVersion(void) const;
+			private:
+				friend class UncertaintyTable;
+				// The number of rows of a chunk (the last one may have fewer).
+				static const size_t chunk_rows = 1024;
+				typedef std::vector<UncertaintyTableElement> Chunk;
+				UncertaintyTableSnapshot(std::vector<std::shared_ptr<const Chunk>> &&chunks, size_t count, const UncertaintyPair &result, u64 version);
+				const std::vector<std::shared_ptr<const Chunk>> chunks_;
+				const size_t count_;
+				const UncertaintyPair result_;
+				const u64 version_;
+			}; // class UncertaintyTableSnapshot
+
+			/* The UncertaintyTableArena creates tables whose objects and rows are
+			 * allocated from one MonotonicArena, so creating a table costs a few pointer
+			 * bumps instead of calls to operator new. The tables are not freed one by
+			 * one: reset destroys every table of the arena at once and keeps its memory
+			 * for the next tables. A table which grows past its starting capacity leaves
+			 * its old rows in the arena until the reset. It may not be used by several
+			 * threads at once.
+			 */
+			class UncertaintyTableArena {
+			public:
+				UncertaintyTableArena(size_t block_size = 64 * 1024);
+				UncertaintyTableArena(const UncertaintyTableArena &) = delete;
+				UncertaintyTableArena &operator=(const UncertaintyTableArena &) = delete;
+				// The destructor destroys the tables and gives back the memory.
+				~UncertaintyTableArena(void);
+				// This method creates a table in the arena. It is valid until the arena
+				// is reset or destroyed, and must not be deleted.
+				UncertaintyTable *create(size_t starting_capacity = UncertaintyTable::inline_rows, double starting_value = 0.0, double starting_uncertainty = 0.0);
+				// This method destroys every table created in the arena.
+				void reset(void);
+				// This method returns the number of tables in the arena.
+				size_t count(void) const;
+				MonotonicArena &getArena(void);
+			private:
+				MonotonicArena arena_;
+				std::vector<UncertaintyTable *> tables_;
+			}; // class UncertaintyTableArena
+
+			/* The UncertaintyChain computes the result of a sequence of rows in the same
+			 * way as an UncertaintyTable, but without storing the rows. It is used when
+			 * only the result is needed, so the memory used does not depend on the number
+			 * of rows.
+			 */
+			class UncertaintyChain {
+			public:
+				// This constructor starts the chain with the specified starting value,
+				// like the first row of an UncertaintyTable.
+				UncertaintyChain(double starting_value = 0.0, double starting_uncertainty = 0.0);
+				// This method computes a row using the current result as its cumulative.
+				// Once the result is NaN, it stays NaN.
+				void add(UncertaintyTableElementType type, double value, double uncertainty);
+				// This method computes count rows, like calling add for every row.
+				void addRows(const UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count);
+				// This method gets the current result of the chain.
+				double getResult(void) const;
+				// This method gets the current result of the chain.
+				void getResult(UncertaintyPair *result_dest) const;
+				// This method gets the current resulting uncertainty of the chain.
+				double getResultingUncertainty(void) const;
+				// This method computes a row using cumulative as its cumulative, and puts
+				// the result into cumulative. Once the cumulative is NaN, it stays NaN.
+				// It is how a chain computes its rows, for code which keeps many
+				// cumulatives at once.
+				static void step(UncertaintyTableElementType type, double value, double uncertainty, UncertaintyPair *cumulative);
+			private:
+				UncertaintyPair cumulative_;
+			}; // class UncertaintyChain
+
+			// This function returns the operation named by the first length characters
+			// of s (for example "ADD" or "mulc", the names of UncertaintyTableElementType
+			// without the UOPERATION_ prefix, in any case). It returns UOPERATION_INVALID
+			// if the name is not known.
+			UncertaintyTableElementType parseOperation(const char *s, size_t length);
+			// This function returns the name of an operation (for example "ADD"), or
+			// "INVALID" if it is not a valid operation.
+			const char *getOperationName(UncertaintyTableElementType type);
+			// This function returns the operation whose value is type (for example
+			// UOPERATION_ADD for 0), or UOPERATION_INVALID if there is none. The C API
+			// converts the types it is given with it.
+			UncertaintyTableElementType getOperation(int type);
+			// This function rounds the uncertainty to one significant figure, and the
+			// value to the same decimal place. Every thread keeps the results of its
+			// recent calls in a small cache, indexed by the bits of the value and the
+			// uncertainty, so inputs which repeat (constants, or the cumulatives of a
+			// table which is recomputed) are not rounded again.
 			void simplifyUncertainty(double value, double uncertainty, double *value_dest, double *uncertainty_dest);
+			// The number of calls to simplifyUncertainty which were answered by the
+			// cache of their thread (hits), and which had to be computed (misses).
+			typedef struct {
+				u64 hits,
+					misses;
+			} SimplifyCacheStats;
+			// These functions enable or disable the cache of simplifyUncertainty for
+			// every thread. It is enabled by default.
+			void setSimplifyCacheEnabled(bool enabled);
+			bool isSimplifyCacheEnabled(void);
+			// This function puts the counts of every thread since the counters were
+			// last reset into stats_dest.
+			void getSimplifyCacheStats(SimplifyCacheStats *stats_dest);
+			void resetSimplifyCacheStats(void);
+			// The number of buckets of the histograms of InstrumentationStats. The
+			// bucket i counts the samples from 2^i to 2^(i+1) - 1 (the first one also
+			// counts zero, and the last one every larger sample).
+			const size_t instrumentation_buckets = 32;
+			// The histogram of the times of InstrumentationStats which counts the rows
+			// of an invalid type. It follows the histograms of the valid types.
+			const size_t instrumentation_invalid_histogram = (size_t)UOPERATION_INVALID + 1;
+			// The counts of the instrumentation of the library, summed over every
+			// thread since the counts were last reset.
+			typedef struct {
+				// The computations of the tables (calls to compute which were not
+				// deferred by a batch), the rows they computed, the calls to
+				// simplifyUncertainty, the computations which stopped at a NaN row, and
+				// the times the rows of a table were allocated.
+				u64 computes,
+					computed_rows,
+					simplifications,
+					nan_short_circuits,
+					allocations;
+				// The number of rows computed at once, by bucket.
+				u64 rows_histogram[instrumentation_buckets];
+				// The time taken to compute a row in nanoseconds, by bucket, for every
+				// type of row. They are indexed by the type plus one (NUL first), and
+				// the rows of an invalid type are counted in the last one.
+				u64 time_histograms[instrumentation_invalid_histogram + 1][instrumentation_buckets];
+			} InstrumentationStats;
+			// This function returns whether the library was compiled with
+			// JP_VISX_INSTRUMENT (CMake value VISX_INSTRUMENT). Otherwise, the counts
+			// are always zero. The counters belong to their thread, so they only cost
+			// a few increments, and the times two reads of the clock per row.
+			bool isInstrumented(void);
+			void getInstrumentationStats(InstrumentationStats *stats_dest);
+			void resetInstrumentationStats(void);
+			// This function simplifies the value and uncertainty and writes them into
+			// dest, for example "1.23 +/- 0.05" (the value has the decimal places of
+			// the uncertainty). The separator is put between them (" +/- " if it is
+			// NULL). Like snprintf, it writes at most size bytes including the NUL
+			// and returns the length of the full text.
+			size_t formatUncertainty(double value, double uncertainty, const char *separator, char *dest, size_t size);
 			u64 sigFigCount(const char *s);
 			u64 sigFigCount(const std::string &s);
 		} // namespace uasf
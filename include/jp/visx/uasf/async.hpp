@@ -0,0 +1,142 @@
+/* include/jp/visx/uasf/async.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_UASF_ASYNC_HPP
+#define JP_VISX_UASF_ASYNC_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../threadpool.hpp"
+#include "../uasf.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+
+namespace jp {
+	namespace visx {
+		namespace uasf {
+			/* An AsyncUncertaintyTable is an UncertaintyTable which is computed in the
+			 * background. The methods which change it return immediately, and the rows
+			 * are computed by a task on a ThreadPool, in steps of a few thousand rows.
+			 *
+			 * Between two steps, the table may be changed again. The lowest changed row
+			 * is remembered (like in a batch), so the task continues from the lowest row
+			 * which must be computed: a change before the rows it reached makes it start
+			 * again from there, and a change after them costs nothing more. A step is
+			 * computed in slices of a few hundred rows, and between two slices the task
+			 * lets in the threads which wait for the table, so a change or a read waits
+			 * for one slice at most.
+			 *
+			 * When every row is computed, the table publishes a snapshot (see
+			 * UncertaintyTable::getSnapshot), which is how the rows are read, and the
+			 * futures returned by getResult are given the result.
+			 */
+			class AsyncUncertaintyTable {
+			public:
+				// The progress callback is called by the task after every step with the
+				// number of rows which are computed and the number of rows of the table.
+				typedef std::function<void(size_t, size_t)> ProgressCallback;
+				// The table is computed on the pool, or on the global pool if it is NULL.
+				AsyncUncertaintyTable(ThreadPool *pool = nullptr);
+				AsyncUncertaintyTable(double starting_value, double starting_uncertainty, ThreadPool *pool = nullptr);
+				AsyncUncertaintyTable(const AsyncUncertaintyTable &) = delete;
+				AsyncUncertaintyTable &operator=(const AsyncUncertaintyTable &) = delete;
+				// The destructor stops the task, and waits for it if it is running. A task
+				// which is queued but not started is cancelled, so the table may be
+				// destroyed by a task of its pool. It must not be destroyed by the
+				// progress callback.
+				~AsyncUncertaintyTable(void);
+				// These methods work like the methods of UncertaintyTable with the same
+				// names, but the table is computed in the background.
+				void add(UncertaintyTableElementType type, double value, double uncertainty);
+				void addAt(size_t row, UncertaintyTableElementType type, double value, double uncertainty);
+				void remove(size_t row);
+				void clear(void);
+				void swap(size_t row1, size_t row2);
+				void set(size_t row, double value);
+				void set(size_t row, double value, double uncertainty);
+				void setUncertainty(size_t row, double uncertainty);
+				void setStartingValue(double value, double uncertainty);
+				void assign(std::vector<UncertaintyTableElement> &&elements);
+				// This method calls fn with the table, so that several changes can be made
+				// at once. The table is in a batch, which fn must not end.
+				void modify(const std::function<void(UncertaintyTable &)> &fn);
+				// This method returns the number of rows of the table.
+				size_t count(void) const;
+				// This method returns a future which is given the result once every row is
+				// computed. If the table is changed before then, the future is given the
+				// result with the change. If every row is computed, the future is ready.
+				std::shared_future<UncertaintyPair> getResult(void);
+				// This method returns the last published snapshot. It never blocks.
+				std::shared_ptr<const UncertaintyTableSnapshot> getSnapshot(void) const;
+				// This method returns whether every row is computed.
+				bool isReady(void) const;
+				// This method waits until every row is computed.
+				void wait(void);
+				// This method sets the progress callback. It is called on the threads of
+				// the pool.
+				void setProgressCallback(ProgressCallback callback);
+				// This method sets the number of rows computed in every step. The default
+				// is 16384.
+				void setStepSize(size_t rows);
+			private:
+				// The state shared with a queued task, which outlives the table if the
+				// task was not started when the table was destroyed.
+				struct Task {
+					std::mutex mutex;
+					bool started,
+						 cancelled;
+				};
+				// This method locks the mutex. While it waits, the task lets it in
+				// between two slices.
+				std::unique_lock<std::mutex> lockTable(void) const;
+				// This method starts the task if it is not running. The mutex must be held.
+				void schedule(void);
+				// This method is run by the task.
+				void run(void);
+				ThreadPool &pool_;
+				mutable std::mutex mutex_;
+				std::condition_variable idle_;
+				// The number of threads which wait for the mutex, and the condition on
+				// which the task waits for them.
+				mutable std::atomic<size_t> waiting_;
+				mutable std::condition_variable unblocked_;
+				std::shared_ptr<Task> task_;
+				// The table is always in a batch.
+				UncertaintyTable table_;
+				ProgressCallback progress_;
+				size_t step_size_;
+				// Whether the task is queued or running, and whether it must stop.
+				bool running_,
+					 stopping_;
+				// The promise of the futures returned since the table was last computed,
+				// or nullptr if none were returned.
+				std::unique_ptr<std::promise<UncertaintyPair>> promise_;
+				std::shared_future<UncertaintyPair> future_;
+			}; // class AsyncUncertaintyTable
+		} // namespace uasf
+	} // namespace visx
+} // namespace jp
+
+#endif
@@ -0,0 +1,92 @@
+/* include/jp/visx/uasf/decimation.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef JP_VISX_UASF_DECIMATION_HPP
+#define JP_VISX_UASF_DECIMATION_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../uasf.hpp"
+#include <vector>
+
+namespace jp {
+	namespace visx {
+		namespace uasf {
+			/* The extent of the results of some rows: the lowest and highest value, and
+			 * the lowest and highest bound of their uncertainty (value - uncertainty and
+			 * value + uncertainty). Rows which are NaN are left out, so an extent
+			 * without any row is NaN.
+			 */
+			typedef struct {
+				double low,
+					   high,
+					   band_low,
+					   band_high;
+			} ResultExtent;
+
+			/* The ResultDecimation keeps the extent of the results of a table (the
+			 * result after every row, which is the cumulative of the next row) in a
+			 * tree: the leaves are blocks of leaf_rows rows, and every node above holds
+			 * the extent of two nodes below it. The extent of any range of rows is then
+			 * found from O(log n) nodes, and the rows at its ends, so a plot of a table
+			 * can be drawn from one extent per pixel whatever the number of rows.
+			 *
+			 * The tree does not follow the table by itself: update must be called
+			 * after the table changes (for example by an observer of the table), and
+			 * only rebuilds the nodes of the changed rows. The table must be computed
+			 * (not in a batch with pending rows) when the tree is updated or read.
+			 */
+			class ResultDecimation {
+			public:
+				// The number of rows of a leaf.
+				static const size_t leaf_rows = 64;
+				// The table must live longer than the tree. The tree is built.
+				ResultDecimation(const UncertaintyTable *table);
+				// This method rebuilds the nodes of the rows from first_row to the end of
+				// the table, and follows the number of rows of the table.
+				void update(size_t first_row = 0);
+				// This method returns the number of rows in the tree.
+				size_t count(void) const;
+				// This method puts the extent of row_count rows starting at first_row into
+				// extent_dest.
+				void getExtent(size_t first_row, size_t row_count, ResultExtent *extent_dest) const;
+				// This method splits row_count rows starting at first_row into buckets
+				// ranges of rows of (almost) the same size, and puts their extents into
+				// extents_dest, which holds buckets extents. If there are fewer rows
+				// than buckets, some buckets have no rows (and are NaN). When every
+				// bucket covers at least 8 leaves, the boundaries between the buckets are
+				// moved to the nearest leaf, which is not visible in a plot but avoids
+				// reading rows.
+				void decimate(size_t first_row, size_t row_count, size_t buckets, ResultExtent *extents_dest) const;
+			private:
+				// This method adds the results of the rows to the extent.
+				void addRows(size_t first_row, size_t end_row, ResultExtent *extent) const;
+				const UncertaintyTable *table_;
+				// The nodes of every level of the tree, the leaves first.
+				std::vector<std::vector<ResultExtent>> levels_;
+				size_t count_;
+			}; // class ResultDecimation
+		} // namespace uasf
+	} // namespace visx
+} // namespace jp
+
+#endif
@@ -0,0 +1,50 @@
+/* include/jp/visx/uasf/elementtype.h
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_UASF_ELEMENTTYPE_H
+#define JP_VISX_UASF_ELEMENTTYPE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// This is jp::visx::uasf::UncertaintyTableElementType, with the same values.
+// It has its own header so that the library can use it without the rest of
+// the C API.
+typedef enum {
+	JP_VISX_UASF_UOPERATION_NUL = -1,
+	JP_VISX_UASF_UOPERATION_ADD,
+	JP_VISX_UASF_UOPERATION_SUB,
+	JP_VISX_UASF_UOPERATION_SUBO,
+	JP_VISX_UASF_UOPERATION_MUL,
+	JP_VISX_UASF_UOPERATION_DIV,
+	JP_VISX_UASF_UOPERATION_DIVO,
+	JP_VISX_UASF_UOPERATION_POW,
+	JP_VISX_UASF_UOPERATION_POWO,
+	JP_VISX_UASF_UOPERATION_MULC,
+	JP_VISX_UASF_UOPERATION_MULCO,
+	JP_VISX_UASF_UOPERATION_DIVC,
+	JP_VISX_UASF_UOPERATION_DIVCO,
+	JP_VISX_UASF_UOPERATION_INVALID,
+} jp_visx_uasf_UncertaintyTableElementType;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,39 @@
+/* include/jp/visx/uasf/fit.h
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef JP_VISX_UASF_FIT_H
+#define JP_VISX_UASF_FIT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "../uasf.h"
+
+// This function fits a polynomial (see fitPolynomial). x and y hold count
+// pairs of a value and its uncertainty, one after the other. The degree + 1
+// parameters are put into values_dest and uncertainties_dest, the constant
+// first. The other destinations may be NULL.
+bool jp_visx_uasf_fitPolynomial(const double *x, const double *y, size_t count, size_t degree, double *values_dest, double *uncertainties_dest, double *chi_squared_dest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,84 @@
+/* include/jp/visx/uasf/fit.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef JP_VISX_UASF_FIT_HPP
+#define JP_VISX_UASF_FIT_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../threadpool.hpp"
+#include "../uasf.hpp"
+
+namespace jp {
+	namespace visx {
+		namespace uasf {
+			// The highest degree of a polynomial which can be fitted.
+			const size_t max_fit_degree = 8;
+
+			// The quality of a fit: the weighted sum of the squared residuals, the
+			// number of points which were used, the number of points minus the number
+			// of parameters, and the number of points which were left out because
+			// their effective uncertainty is zero (or infinite).
+			typedef struct {
+				double chi_squared;
+				size_t points,
+					   degrees_of_freedom,
+					   rejected;
+			} FitStatistics;
+
+			/* This function fits a polynomial of the degree to count points (x[i],
+			 * y[i]) by weighted least squares, and puts its coefficients into
+			 * parameters_dest (degree + 1 pairs, the constant first), with their
+			 * uncertainties (the square roots of the diagonal of their covariance).
+			 *
+			 * Every point is weighted by 1 / s^2, where s is its effective uncertainty:
+			 * the uncertainty of y, and the uncertainty of x multiplied by the slope of
+			 * the polynomial at x. Since the slope depends on the fit, the fit is
+			 * repeated until the parameters stop changing (a few times) when some x
+			 * have an uncertainty. Points with a NaN are left out. Points with no
+			 * effective uncertainty cannot be weighted: they are left out too, and
+			 * counted in the rejected of the statistics. If no point has an
+			 * uncertainty, every point has the same weight instead, and the
+			 * uncertainties of the parameters come from the scatter of the points
+			 * around the polynomial.
+			 *
+			 * The x are moved and scaled to [-1, 1], and the sums of the normal
+			 * equations are computed in one pass over the points, in blocks which are
+			 * split between the threads of the pool (the global pool if it is NULL) and
+			 * added in order, so the result does not depend on the number of threads.
+			 * The equations are solved by a Cholesky decomposition, and chi^2 is
+			 * computed from the residuals in a second pass.
+			 *
+			 * If covariance_dest is not NULL, the covariance of the parameters is put
+			 * into it ((degree + 1)^2 values, by rows). The function returns false if
+			 * the degree is higher than max_fit_degree, if there are not more points
+			 * than parameters, or if the points do not determine the polynomial (for
+			 * example if every x is the same).
+			 */
+			bool fitPolynomial(const UncertaintyPair *x, const UncertaintyPair *y, size_t count, size_t degree, UncertaintyPair *parameters_dest, double *covariance_dest = nullptr, FitStatistics *statistics_dest = nullptr, ThreadPool *pool = nullptr);
+			// This function fits a line (a polynomial of degree 1).
+			bool fitLine(const UncertaintyPair *x, const UncertaintyPair *y, size_t count, UncertaintyPair *intercept_dest, UncertaintyPair *slope_dest, FitStatistics *statistics_dest = nullptr, ThreadPool *pool = nullptr);
+		} // namespace uasf
+	} // namespace visx
+} // namespace jp
+
+#endif
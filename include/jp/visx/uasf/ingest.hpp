@@ -0,0 +1,105 @@
+/* include/jp/visx/uasf/ingest.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_UASF_INGEST_HPP
+#define JP_VISX_UASF_INGEST_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../uasf.hpp"
+#include "../threadpool.hpp"
+
+namespace jp {
+	namespace visx {
+		namespace uasf {
+			/* The TableIngestor reads rows from CSV or TSV text. Every line has the
+			 * columns operation, value and uncertainty, for example:
+			 *		MUL,2.5,0.1
+			 * The operation is the name of an UncertaintyTableElementType without the
+			 * UOPERATION_ prefix (in any case). The uncertainty may be left out, in
+			 * which case it is zero. Empty lines and lines starting with '#' are
+			 * skipped. If the first line is not a valid row, it is taken as a header.
+			 *
+			 * The text is cut into chunks at line boundaries. The chunks are parsed on
+			 * the workers of a ThreadPool and the rows are used in order as the chunks
+			 * complete. At most two chunks per worker are in memory at once, so the
+			 * memory used by evaluate does not depend on the size of the input. A
+			 * line of a file may be at most 1 MiB long; a longer one is reported like
+			 * an invalid row. A chunk which no worker has started when its rows are
+			 * needed is parsed by the calling thread, so the methods may be called
+			 * from a task of the pool.
+			 */
+			class TableIngestor {
+			public:
+				TableIngestor(void);
+				// This method sets the delimiter between the columns. If it is zero
+				// (the default), a tab is used if the first line contains one, and a
+				// comma is used otherwise.
+				void setDelimiter(char delimiter);
+				// This method sets the size of the chunks in bytes. The default is 4 MiB.
+				void setChunkSize(size_t bytes);
+				// This method sets the pool which parses the chunks. If it is NULL (the
+				// default), ThreadPool::global() is used.
+				void setThreadPool(ThreadPool *pool);
+				// This method sets whether files are mapped into memory instead of being
+				// read in chunks. The default is false.
+				void setMapFiles(bool map_files);
+				// These methods add the rows to the end of the table. The table is
+				// computed once, after the last row. They return false if the input
+				// could not be read or a line is not a valid row. In that case, the rows
+				// before the invalid line are still added.
+				bool ingestFile(const char *path, UncertaintyTable *table);
+				bool ingestBuffer(const char *data, size_t size, UncertaintyTable *table);
+				// These methods compute the result of the rows (as if they were added to
+				// a new table) without storing them. They return false in the same cases
+				// as ingestFile and ingestBuffer.
+				bool evaluateFile(const char *path, UncertaintyPair *result_dest);
+				bool evaluateBuffer(const char *data, size_t size, UncertaintyPair *result_dest);
+				// This method returns the number of rows read by the last call.
+				size_t getRowCount(void) const;
+				// This method returns the line (starting at one) of the invalid row which
+				// stopped the last call, or zero if there was none.
+				size_t getErrorLine(void) const;
+			private:
+				char delimiter_;
+				size_t chunk_size_;
+				ThreadPool *pool_;
+				bool map_files_;
+				size_t row_count_,
+					   error_line_;
+			}; // class TableIngestor
+
+			// This function parses one line of the format read by the TableIngestor
+			// (without its line feed). It returns false if the line is not a valid
+			// row. If the line is empty or a comment, it returns true and sets *empty.
+			bool parseRow(const char *line, size_t length, char delimiter, UncertaintyTableElementType *type, double *value, double *uncertainty, bool *empty);
+			// This function parses an expression such as "2.5+/-0.1 * 3 / 1.2" (the
+			// uncertainty may also follow a "±"). The operators are + - * / ^, and are
+			// computed from left to right. The rows of the expression are added to
+			// elements_dest, starting with a NUL row, so that they can be computed by an
+			// UncertaintyChain or an UncertaintyTable. Nothing is added for an empty
+			// line or a comment. It returns false (and adds nothing) if s is invalid.
+			bool parseExpression(const char *s, std::vector<UncertaintyTableElement> *elements_dest);
+		} // namespace uasf
+	} // namespace visx
+} // namespace jp
+
+#endif
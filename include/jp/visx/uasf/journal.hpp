@@ -0,0 +1,134 @@
+/* include/jp/visx/uasf/journal.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_UASF_JOURNAL_HPP
+#define JP_VISX_UASF_JOURNAL_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../uasf.hpp"
+#include <string>
+#include <vector>
+
+namespace jp {
+	namespace visx {
+		namespace uasf {
+			/* A JournaledUncertaintyTable is an UncertaintyTable which is persisted in two
+			 * files: a snapshot (a table file, see tablefile.hpp) and an append-only
+			 * journal of the changes made since the snapshot was written.
+			 *
+			 * Every change is encoded as a small record in a memory buffer. When commit is
+			 * called (or the buffer grows past the commit threshold), the buffered records
+			 * are written to the journal as one group, protected by a checksum, and flushed
+			 * to the disk once. Saving therefore costs the size of the changes, not the
+			 * size of the table. When the journal grows past the compaction threshold, the
+			 * table is written to a new snapshot and the journal is emptied.
+			 *
+			 * When the files are opened, the snapshot is loaded and the journal is replayed
+			 * in a single batch. A group which was only partly written (because of a crash)
+			 * fails its checksum; it and everything after it are discarded.
+			 */
+			class JournaledUncertaintyTable {
+			public:
+				JournaledUncertaintyTable(void);
+				JournaledUncertaintyTable(const JournaledUncertaintyTable &) = delete;
+				JournaledUncertaintyTable &operator=(const JournaledUncertaintyTable &) = delete;
+				// The destructor commits the pending changes and closes the files.
+				~JournaledUncertaintyTable(void);
+				// This method opens (or creates) the snapshot and journal files and
+				// recovers the table from them. If files were already open, they are
+				// committed and closed first. It returns false if the files could not
+				// be opened, in which case the table is empty.
+				bool open(const char *snapshot_path, const char *journal_path);
+				// This method commits the pending changes and closes the files.
+				// The table is kept in memory.
+				void close(void);
+				// This method returns whether the files are open.
+				bool isOpen(void) const;
+				// This method returns the table. The table must be changed through the
+				// methods of this class, so that the changes are journaled.
+				const UncertaintyTable &getTable(void) const;
+				// These methods are the same as the methods of UncertaintyTable with the
+				// same name, except the change is also added to the journal buffer.
+				void add(UncertaintyTableElementType type, double value, double uncertainty);
+				void addAt(size_t row, UncertaintyTableElementType type, double value, double uncertainty);
+				void remove(size_t row);
+				void clear(void);
+				void swap(size_t row1, size_t row2);
+				void set(size_t row, double value);
+				void set(size_t row, double value, double uncertainty);
+				void setUncertainty(size_t row, double uncertainty);
+				void setStartingValue(double value, double uncertainty);
+				void setStartingValue(double value);
+				void setStartingUncertainty(double uncertainty);
+				// This method writes the buffered changes to the journal as one group and
+				// flushes the journal to the disk. If the journal grew past the compaction
+				// threshold, the journal is compacted. It returns false if the changes
+				// could not be written.
+				bool commit(void);
+				// This method writes the table to a new snapshot and empties the journal.
+				// It returns false if the snapshot could not be written, in which case the
+				// old snapshot and journal are kept.
+				bool compact(void);
+				// This method sets the number of buffered bytes after which the changes
+				// are committed automatically. Zero disables the automatic commit.
+				// The default is 64 KiB.
+				void setCommitThreshold(size_t bytes);
+				// This method sets the size of the journal (in bytes) after which a commit
+				// compacts it. Zero disables the automatic compaction. The default is
+				// 64 MiB.
+				void setCompactionThreshold(u64 bytes);
+				// This method returns the current size of the journal file in bytes.
+				u64 getJournalSize(void) const;
+				// This method returns the number of bytes waiting to be committed.
+				size_t getPendingSize(void) const;
+			private:
+				// These methods encode a record into the buffer. A record is started with
+				// beginRecord, followed by its fields, and finished with endRecord.
+				void beginRecord(u8 kind);
+				void putRow(u64 row);
+				void putType(UncertaintyTableElementType type);
+				void putDouble(double value);
+				void endRecord(void);
+				// This method replays the groups of data (which does not include the
+				// journal header) into the table. It returns the size of the valid part.
+				size_t replay(const u8 *data, size_t size);
+				// This method truncates the journal and writes a header with the
+				// current sequence number.
+				bool resetJournal(void);
+				UncertaintyTable table_;
+				std::string snapshot_path_,
+							journal_path_;
+				// The journal file descriptor, or -1 if the files are not open.
+				int journal_fd_;
+				// The sequence number of the snapshot which the journal applies to.
+				u64 sequence_;
+				u64 journal_size_,
+					compaction_threshold_;
+				size_t commit_threshold_;
+				// The pending records. The first bytes are reserved for the group header.
+				std::vector<u8> buffer_;
+			}; // class JournaledUncertaintyTable
+		} // namespace uasf
+	} // namespace visx
+} // namespace jp
+
+#endif
@@ -0,0 +1,122 @@
+/* include/jp/visx/uasf/persistent.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_UASF_PERSISTENT_HPP
+#define JP_VISX_UASF_PERSISTENT_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../uasf.hpp"
+#include <memory>
+#include <vector>
+
+namespace jp {
+	namespace visx {
+		namespace uasf {
+			/* A PersistentUncertaintyTable is a table whose copies share their rows. The
+			 * rows are kept in chunks at the leaves of a B-tree which is never changed:
+			 * a change copies the chunk of the row and the nodes above it, and shares
+			 * every other node with the table it was copied from. A copy therefore costs
+			 * O(1), and a change O(log n) in time and memory, so old versions can be
+			 * kept for undo, or copied to try alternatives.
+			 *
+			 * The table is computed when its result or cumulatives are read. Every node
+			 * remembers the cumulative it was last computed from and the cumulative it
+			 * gave, so the nodes which are shared with an older version are not computed
+			 * again if their first row starts from the same cumulative. After a change,
+			 * only the changed chunk and the rows after it (whose cumulatives changed)
+			 * are computed.
+			 *
+			 * The rows are computed like those of an UncertaintyTable. Unlike an
+			 * UncertaintyTable, rows after a NaN result keep their values; only their
+			 * cumulatives are NaN. Different copies may be used by different threads at
+			 * once, but a single copy must not be changed while it is read.
+			 */
+			class PersistentUncertaintyTable {
+			public:
+				PersistentUncertaintyTable(void);
+				PersistentUncertaintyTable(double starting_value, double starting_uncertainty);
+				// This constructor copies the rows of the table. It costs O(n).
+				explicit PersistentUncertaintyTable(const UncertaintyTable &table);
+				// These methods work like the methods of UncertaintyTable with the same
+				// names. The changes only apply to this copy.
+				size_t count(void) const;
+				UncertaintyTableElementType getType(size_t row) const;
+				double getValue(size_t row) const;
+				double getUncertainty(size_t row) const;
+				double getStartingValue(void) const;
+				double getStartingUncertainty(void) const;
+				void add(UncertaintyTableElementType type, double value, double uncertainty);
+				void addAt(size_t row, UncertaintyTableElementType type, double value, double uncertainty);
+				void remove(size_t row);
+				void set(size_t row, double value, double uncertainty);
+				void set(size_t row, UncertaintyTableElementType type, double value, double uncertainty);
+				void setStartingValue(double value, double uncertainty);
+				double getResult(void) const;
+				void getResult(UncertaintyPair *result_dest) const;
+				double getResultingUncertainty(void) const;
+				// This method returns the specified row with its cumulatives (the result
+				// of the rows before it). If the row is invalid, it returns
+				// UncertaintyTableElement::invalid_element. It costs O(log n) if the rows
+				// before it were computed.
+				UncertaintyTableElement getElement(size_t row) const;
+				// This method replaces the rows of table with the rows of this table.
+				void toTable(UncertaintyTable *table) const;
+				// This method returns whether the two tables are the same version (one
+				// was copied from the other, and neither was changed since).
+				bool isSameVersion(const PersistentUncertaintyTable &other) const;
+				// A node of the tree (see persistent.cpp).
+				struct Node;
+			private:
+				std::shared_ptr<const Node> root_;
+			}; // class PersistentUncertaintyTable
+
+			/* The UncertaintyTableHistory keeps the versions of a table for undo and
+			 * redo. Since the versions share their rows, a version costs about as much
+			 * memory as the change which made it.
+			 */
+			class UncertaintyTableHistory {
+			public:
+				UncertaintyTableHistory(void);
+				explicit UncertaintyTableHistory(const PersistentUncertaintyTable &table);
+				// This method returns the current version.
+				const PersistentUncertaintyTable &getCurrent(void) const;
+				// This method makes table the current version. The versions which were
+				// undone are forgotten.
+				void commit(const PersistentUncertaintyTable &table);
+				// These methods go back to the version before the current one, or forward
+				// to the version which was last undone. They return false if there is none.
+				bool undo(void);
+				bool redo(void);
+				bool canUndo(void) const;
+				bool canRedo(void) const;
+				// This method forgets every version except the current one.
+				void clear(void);
+			private:
+				std::vector<PersistentUncertaintyTable> undo_,
+														redo_;
+				PersistentUncertaintyTable current_;
+			}; // class UncertaintyTableHistory
+		} // namespace uasf
+	} // namespace visx
+} // namespace jp
+
+#endif
@@ -0,0 +1,54 @@
+/* include/jp/visx/uasf/quantiles.h
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_UASF_QUANTILES_H
+#define JP_VISX_UASF_QUANTILES_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "../uasf.h"
+
+// This only emulates the function of the QuantileSketch class.
+typedef void jp_visx_uasf_QuantileSketch;
+
+// A k of zero uses the default (200).
+jp_visx_uasf_QuantileSketch *jp_visx_uasf_QuantileSketch_new(size_t k);
+void jp_visx_uasf_QuantileSketch_add(jp_visx_uasf_QuantileSketch *sketch, double value);
+void jp_visx_uasf_QuantileSketch_addValues(jp_visx_uasf_QuantileSketch *sketch, const double *values, size_t count);
+void jp_visx_uasf_QuantileSketch_merge(jp_visx_uasf_QuantileSketch *sketch, jp_visx_uasf_QuantileSketch *other);
+void jp_visx_uasf_QuantileSketch_reset(jp_visx_uasf_QuantileSketch *sketch);
+u64 jp_visx_uasf_QuantileSketch_count(jp_visx_uasf_QuantileSketch *sketch);
+double jp_visx_uasf_QuantileSketch_getMin(jp_visx_uasf_QuantileSketch *sketch);
+double jp_visx_uasf_QuantileSketch_getMax(jp_visx_uasf_QuantileSketch *sketch);
+double jp_visx_uasf_QuantileSketch_getQuantile(jp_visx_uasf_QuantileSketch *sketch, double q);
+void jp_visx_uasf_QuantileSketch_getQuantiles(jp_visx_uasf_QuantileSketch *sketch, const double *qs, size_t count, double *quantiles_dest);
+double jp_visx_uasf_QuantileSketch_getRank(jp_visx_uasf_QuantileSketch *sketch, double value);
+double jp_visx_uasf_QuantileSketch_getRankError(jp_visx_uasf_QuantileSketch *sketch);
+void jp_visx_uasf_QuantileSketch_free(jp_visx_uasf_QuantileSketch *sketch);
+// This function computes the sets of rows like jp_visx_uasf_evaluateRowSets,
+// and adds the values and the uncertainties of the results to the sketches
+// (either may be NULL).
+void jp_visx_uasf_sketchRowSets(const jp_visx_uasf_UncertaintyTableElementType *types, const double *values, const double *uncertainties, const size_t *counts, size_t set_count, jp_visx_uasf_QuantileSketch *values_dest, jp_visx_uasf_QuantileSketch *uncertainties_dest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
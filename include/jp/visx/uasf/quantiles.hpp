@@ -0,0 +1,137 @@
+/* include/jp/visx/uasf/quantiles.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_UASF_QUANTILES_HPP
+#define JP_VISX_UASF_QUANTILES_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../threadpool.hpp"
+#include "../uasf.hpp"
+#include "resultcache.hpp"
+#include <vector>
+
+namespace jp {
+	namespace visx {
+		namespace uasf {
+			/* The QuantileSketch estimates the quantiles (for example the median or the
+			 * 95th percentile) of a stream of values, without storing them. It is a
+			 * KLL sketch: the values go into a stack of compactors, the compactor of
+			 * level h holding values which each stand for 2^h values of the stream.
+			 * When the compactors are full, the lowest full one is sorted and every
+			 * other value (starting at the first or the second, at random) is moved to
+			 * the level above. The capacity of a level is k times (2/3) to the power of
+			 * its distance to the top level, but at least 8, so the sketch holds about
+			 * 3k values however long the stream is.
+			 *
+			 * The rank of a value in the stream (the fraction of the values which are
+			 * not greater) estimated by the sketch is within getRankError of the true
+			 * rank with a probability of 99%. With the default k of 200, this is about
+			 * 1.3%. Sketches with the same k may be merged, with the same guarantee, so
+			 * parts of a stream may be read separately (for example on several threads).
+			 *
+			 * The random choices come from a generator seeded in the constructor, so a
+			 * sketch given the same values gives the same quantiles. NaN values are
+			 * counted, but left out of the quantiles. The lowest and highest values are
+			 * kept exactly.
+			 */
+			class QuantileSketch {
+			public:
+				// The value of k used when none is specified.
+				static const size_t default_k = 200;
+				// This constructor makes an empty sketch. k is at least 8.
+				QuantileSketch(size_t k = default_k, u64 seed = 0);
+				// This method adds one value.
+				void add(double value);
+				// This method adds count values.
+				void add(const double *values, size_t count);
+				// This method adds the values of another sketch, as if they were added to
+				// this one. If the other sketch has a different k, the error of this
+				// sketch is at most the larger of the two.
+				void merge(const QuantileSketch &other);
+				// This method removes every value. The k and the state of the generator
+				// are kept.
+				void reset(void);
+				size_t getK(void) const;
+				// This method returns the number of values added, not counting NaN values.
+				u64 count(void) const;
+				// This method returns the number of NaN values added.
+				u64 countNaN(void) const;
+				// This method returns the number of values held by the sketch.
+				size_t getRetained(void) const;
+				double getMin(void) const;
+				double getMax(void) const;
+				// This method returns the estimated q-quantile (0 <= q <= 1): the
+				// smallest value held whose estimated rank is at least q. The 0 and 1
+				// quantiles are the lowest and highest values. It returns NaN if there
+				// are no values or if q is not in [0, 1].
+				double getQuantile(double q) const;
+				// This method computes count quantiles at once, which sorts the values
+				// held only once.
+				void getQuantiles(const double *qs, size_t count, double *quantiles_dest) const;
+				// This method returns the estimated rank of a value, or NaN if there are
+				// no values.
+				double getRank(double value) const;
+				// This method returns the bound on the error of the ranks, which holds
+				// with a probability of 99% (the empirical bound of the KLL sketch,
+				// 2.296 / k^0.9723).
+				double getRankError(void) const;
+				// This function adds count values on the threads of the pool (the global
+				// pool if it is NULL). The values are split into at most 64 parts
+				// independently of the number of threads, and the sketches of the parts
+				// are merged in order, so the result is the same on any pool.
+				static QuantileSketch sketch(const double *values, size_t count, size_t k = default_k, ThreadPool *pool = nullptr);
+			private:
+				// This method computes the capacities of the levels, which depend on the
+				// number of levels.
+				void updateCapacities(void);
+				// This method compacts the lowest full level, adding a level on top if
+				// needed, until the sketch holds fewer values than its capacity.
+				void compress(void);
+				// This method returns the values held, sorted, with their cumulative
+				// weights.
+				void sortedView(std::vector<double> *values_dest, std::vector<u64> *weights_dest) const;
+				size_t k_;
+				u64 state_,
+					count_,
+					nan_count_;
+				double min_,
+					   max_;
+				std::vector<std::vector<double>> levels_;
+				std::vector<size_t> capacities_;
+				// The buffer into which a compacted level is merged with the level above.
+				std::vector<double> merged_;
+				// The number of values held, and the sum of the capacities of the levels.
+				size_t retained_,
+					   max_retained_;
+			}; // class QuantileSketch
+
+			// This function computes set_count sets of rows like evaluateRowSets, but
+			// adds the values and the uncertainties of the results to the sketches
+			// instead of storing them (either sketch may be NULL). The sets are split
+			// into at most 64 parts on the pool (the global pool if it is NULL); every
+			// part has its own sketches, which are merged in order at the end.
+			void sketchRowSets(const UncertaintyTableElementType *types, const double *values, const double *uncertainties, const size_t *counts, size_t set_count, QuantileSketch *values_dest, QuantileSketch *uncertainties_dest, ResultCache *cache, ThreadPool *pool = nullptr);
+		} // namespace uasf
+	} // namespace visx
+} // namespace jp
+
+#endif
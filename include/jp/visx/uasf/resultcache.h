@@ -0,0 +1,48 @@
+/* include/jp/visx/uasf/resultcache.h
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_UASF_RESULTCACHE_H
+#define JP_VISX_UASF_RESULTCACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "../uasf.h"
+
+// These functions use the global cache (see ResultCache::global).
+void jp_visx_uasf_ResultCache_setBudget(size_t bytes);
+size_t jp_visx_uasf_ResultCache_getBudget(void);
+size_t jp_visx_uasf_ResultCache_count(void);
+u64 jp_visx_uasf_ResultCache_getHits(void);
+u64 jp_visx_uasf_ResultCache_getMisses(void);
+u64 jp_visx_uasf_ResultCache_getEvictions(void);
+void jp_visx_uasf_ResultCache_resetCounters(void);
+void jp_visx_uasf_ResultCache_clear(void);
+// These functions evaluate rows without a table (see evaluateRows and
+// evaluateRowSets). The sets of rows of evaluateRowSets follow each other in
+// the arrays, the set i having counts[i] rows, and their results are put into
+// values_dest[i] and uncertainties_dest[i]. The destinations may be NULL.
+void jp_visx_uasf_evaluateRows(const jp_visx_uasf_UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count, double *value_dest, double *uncertainty_dest);
+void jp_visx_uasf_evaluateRowSets(const jp_visx_uasf_UncertaintyTableElementType *types, const double *values, const double *uncertainties, const size_t *counts, size_t set_count, double *values_dest, double *uncertainties_dest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
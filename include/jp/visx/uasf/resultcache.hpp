@@ -0,0 +1,130 @@
+/* include/jp/visx/uasf/resultcache.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_UASF_RESULTCACHE_HPP
+#define JP_VISX_UASF_RESULTCACHE_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../uasf.hpp"
+#include "../threadpool.hpp"
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace jp {
+	namespace visx {
+		namespace uasf {
+			/* The key of a sequence of rows: two xxHashes (with different seeds) of the
+			 * types, values and uncertainties of the rows, and the number of rows.
+			 */
+			typedef struct {
+				u64 hash,
+					check,
+					count;
+			} ResultKey;
+
+			/* The ResultCache remembers the results of sequences of rows, by their
+			 * content. It holds as many results as fit in its budget, and removes the
+			 * results which were not used recently (with the CLOCK algorithm) to make
+			 * room. It may be used by several threads at once.
+			 *
+			 * The global cache is used by UncertaintyTable when it computes every row
+			 * (for example in recompute, or at the end of a batch which changed the
+			 * first row), and by evaluateRows. Its budget is zero by default, which
+			 * disables it.
+			 */
+			class ResultCache {
+			public:
+				ResultCache(size_t budget = 0);
+				ResultCache(const ResultCache &) = delete;
+				ResultCache &operator=(const ResultCache &) = delete;
+				// This method sets the number of bytes the cache may use. Results are
+				// removed if they no longer fit. A budget of zero disables the cache.
+				void setBudget(size_t bytes);
+				size_t getBudget(void) const;
+				// This method returns whether the budget holds at least one result.
+				bool isEnabled(void) const;
+				// This method puts the result of the rows with the key into result_dest.
+				// It returns false if the result is not in the cache.
+				bool find(const ResultKey &key, UncertaintyPair *result_dest);
+				// This method adds a result. Results which are NaN are not added, since
+				// a table which computes one also changes its rows.
+				void insert(const ResultKey &key, const UncertaintyPair &result);
+				// This method removes every result. The counters are kept.
+				void clear(void);
+				// These methods return the number of results in the cache, and the
+				// number of hits, misses and removed results since the counters were
+				// reset.
+				size_t count(void) const;
+				u64 getHits(void) const;
+				u64 getMisses(void) const;
+				u64 getEvictions(void) const;
+				void resetCounters(void);
+				// This method returns the cache shared by the process.
+				static ResultCache &global(void);
+				// These functions return the key of rows. The rows of a table include
+				// its first (NUL) row.
+				static ResultKey hashRows(const UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count);
+				static ResultKey hashTable(const UncertaintyTable &table);
+			private:
+				struct Entry {
+					ResultKey key;
+					UncertaintyPair result;
+					bool referenced;
+				};
+				// This method removes entries until at most capacity_ are left.
+				void shrink(void);
+				mutable std::mutex mutex_;
+				std::vector<Entry> entries_;
+				// The position of the entries by the hash of their key.
+				std::unordered_map<u64, size_t> index_;
+				// The position of the clock hand in entries_.
+				size_t hand_;
+				std::atomic<size_t> budget_,
+									capacity_;
+				std::atomic<u64> hits_,
+								 misses_,
+								 evictions_;
+			}; // class ResultCache
+
+			// This function computes rows in the same way as an UncertaintyTable (a NUL
+			// row sets the result to its value, and once the result is NaN, it stays
+			// NaN), starting at zero, and puts the result into result_dest. If cache is
+			// not NULL and is enabled, the result is looked up and stored in it.
+			void evaluateRows(const UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count, UncertaintyPair *result_dest, ResultCache *cache);
+
+			// This function puts the offset of every set of rows in the arrays (the sum
+			// of the counts of the sets before it) into offsets_dest. It returns false
+			// if there are rows but one of the arrays is NULL.
+			bool findRowSetOffsets(const UncertaintyTableElementType *types, const double *values, const double *uncertainties, const size_t *counts, size_t set_count, std::vector<size_t> *offsets_dest);
+
+			// This function evaluates set_count sets of rows which follow each other in
+			// the arrays, like evaluateRows: the set i has counts[i] rows, and its
+			// result is put into results_dest[i]. The sets are split between the
+			// threads of the pool (the global pool if it is NULL).
+			void evaluateRowSets(const UncertaintyTableElementType *types, const double *values, const double *uncertainties, const size_t *counts, size_t set_count, UncertaintyPair *results_dest, ResultCache *cache, ThreadPool *pool = nullptr);
+		} // namespace uasf
+	} // namespace visx
+} // namespace jp
+
+#endif
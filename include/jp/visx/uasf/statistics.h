@@ -0,0 +1,54 @@
+/* include/jp/visx/uasf/statistics.h
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef JP_VISX_UASF_STATISTICS_H
+#define JP_VISX_UASF_STATISTICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "../uasf.h"
+
+// This only emulates the function of the MeasurementAccumulator class.
+typedef void jp_visx_uasf_MeasurementAccumulator;
+
+jp_visx_uasf_MeasurementAccumulator *jp_visx_uasf_MeasurementAccumulator_new(void);
+void jp_visx_uasf_MeasurementAccumulator_add(jp_visx_uasf_MeasurementAccumulator *accumulator, double value);
+void jp_visx_uasf_MeasurementAccumulator_addValues(jp_visx_uasf_MeasurementAccumulator *accumulator, const double *values, size_t count);
+void jp_visx_uasf_MeasurementAccumulator_merge(jp_visx_uasf_MeasurementAccumulator *accumulator, jp_visx_uasf_MeasurementAccumulator *other);
+void jp_visx_uasf_MeasurementAccumulator_reset(jp_visx_uasf_MeasurementAccumulator *accumulator);
+u64 jp_visx_uasf_MeasurementAccumulator_count(jp_visx_uasf_MeasurementAccumulator *accumulator);
+double jp_visx_uasf_MeasurementAccumulator_getMean(jp_visx_uasf_MeasurementAccumulator *accumulator);
+double jp_visx_uasf_MeasurementAccumulator_getStandardDeviation(jp_visx_uasf_MeasurementAccumulator *accumulator);
+double jp_visx_uasf_MeasurementAccumulator_getStandardError(jp_visx_uasf_MeasurementAccumulator *accumulator);
+double jp_visx_uasf_MeasurementAccumulator_getMin(jp_visx_uasf_MeasurementAccumulator *accumulator);
+double jp_visx_uasf_MeasurementAccumulator_getMax(jp_visx_uasf_MeasurementAccumulator *accumulator);
+// The simplified mean and standard error. The destinations may be NULL.
+void jp_visx_uasf_MeasurementAccumulator_getResult(jp_visx_uasf_MeasurementAccumulator *accumulator, double *value_dest, double *uncertainty_dest);
+// This function adds a row of the type with the simplified result to the end
+// of the table.
+void jp_visx_uasf_MeasurementAccumulator_addToTable(jp_visx_uasf_MeasurementAccumulator *accumulator, jp_visx_uasf_UncertaintyTable *table, jp_visx_uasf_UncertaintyTableElementType type);
+void jp_visx_uasf_MeasurementAccumulator_free(jp_visx_uasf_MeasurementAccumulator *accumulator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
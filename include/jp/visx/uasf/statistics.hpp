@@ -0,0 +1,98 @@
+/* include/jp/visx/uasf/statistics.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef JP_VISX_UASF_STATISTICS_HPP
+#define JP_VISX_UASF_STATISTICS_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../threadpool.hpp"
+#include "../uasf.hpp"
+
+namespace jp {
+	namespace visx {
+		namespace uasf {
+			/* The MeasurementAccumulator turns repeated readings of a quantity into a
+			 * value and an uncertainty: the mean of the readings and its standard error
+			 * (the sample standard deviation divided by the square root of the number
+			 * of readings). It also keeps the lowest and highest reading. The readings
+			 * are not stored, so a stream of any length is read once.
+			 *
+			 * The mean and the sum of the squared deviations are kept as in Welford's
+			 * algorithm. Arrays of readings are read in blocks: the sums of a block are
+			 * computed in several lanes (which the compiler can vectorize), and the
+			 * block is merged with the readings before it with the formulas of Chan et
+			 * al., which are also used to merge two accumulators. This loses less
+			 * precision than summing the squares.
+			 *
+			 * A NaN reading makes the mean and the uncertainty NaN, like a NaN row of a
+			 * table. The lowest and highest readings leave it out.
+			 */
+			class MeasurementAccumulator {
+			public:
+				MeasurementAccumulator(void);
+				// This method adds one reading.
+				void add(double value);
+				// This method adds count readings.
+				void add(const double *values, size_t count);
+				// This method adds the readings of another accumulator, as if they were
+				// added to this one. Accumulators of parts of a stream may be computed
+				// separately (for example on several threads) and merged.
+				void merge(const MeasurementAccumulator &other);
+				// This method removes every reading.
+				void reset(void);
+				// This method returns the number of readings.
+				u64 count(void) const;
+				double getMean(void) const;
+				// This method returns the sample variance (divided by count - 1), which is
+				// NaN with fewer than two readings. The same goes for the standard
+				// deviation and the standard error.
+				double getVariance(void) const;
+				double getStandardDeviation(void) const;
+				double getStandardError(void) const;
+				// These methods return the lowest and highest reading, or NaN if there is
+				// none.
+				double getMin(void) const;
+				double getMax(void) const;
+				// This method puts the mean and the standard error into result_dest,
+				// simplified to their significant figures (see simplifyUncertainty).
+				void getResult(UncertaintyPair *result_dest) const;
+				// This method returns a row of the type with the simplified result, to
+				// be added to a table.
+				UncertaintyTableElement getElement(UncertaintyTableElementType type = UOPERATION_ADD) const;
+				// This function adds count readings on the threads of the pool (the
+				// global pool if it is NULL). The blocks of readings are merged in order,
+				// so the result does not depend on the number of threads.
+				static MeasurementAccumulator accumulate(const double *values, size_t count, ThreadPool *pool = nullptr);
+			private:
+				u64 count_;
+				double mean_,
+					   // The sum of the squared deviations from the mean.
+					   m2_,
+					   min_,
+					   max_;
+			}; // class MeasurementAccumulator
+		} // namespace uasf
+	} // namespace visx
+} // namespace jp
+
+#endif
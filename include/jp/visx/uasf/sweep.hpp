@@ -0,0 +1,70 @@
+/* include/jp/visx/uasf/sweep.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_UASF_SWEEP_HPP
+#define JP_VISX_UASF_SWEEP_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../threadpool.hpp"
+#include "../uasf.hpp"
+
+namespace jp {
+	namespace visx {
+		namespace uasf {
+			// The part of a row which is varied by a sweep.
+			typedef enum {
+				SWEEP_VALUE,
+				SWEEP_UNCERTAINTY,
+			} SweepTarget;
+
+			// An axis of a sweep: the row, the part of it which is varied, and the
+			// count points it takes.
+			typedef struct {
+				size_t row;
+				SweepTarget target;
+				const double *points;
+				size_t count;
+			} SweepAxis;
+
+			/* This function computes the result of the table for every point of a grid
+			 * of one or two axes, as if the rows of the axes were set to the point and
+			 * the table recomputed, without changing the table. With two axes, the
+			 * result of the points (i, j) is put into results_dest[i * axes[1].count +
+			 * j]; results_dest must hold the product of the counts of the axes.
+			 *
+			 * The rows before the first varied row are not computed again: their
+			 * cumulative is taken from the table. With two axes on different rows, the
+			 * rows between them are computed once per point of the first. The points
+			 * are split into blocks which are computed on the pool (the global pool if
+			 * it is NULL), every block going through the rows once.
+			 *
+			 * The table must not be in a batch. Since a table sets the rows after a NaN
+			 * result to NaN, the points of such a table after that row are NaN. It
+			 * returns false if there are no axes or more than two, if a row is invalid,
+			 * or if both axes vary the same part of the same row.
+			 */
+			bool sweep(const UncertaintyTable &table, const SweepAxis *axes, size_t axis_count, UncertaintyPair *results_dest, ThreadPool *pool = nullptr);
+		} // namespace uasf
+	} // namespace visx
+} // namespace jp
+
+#endif
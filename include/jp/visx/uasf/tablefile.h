@@ -0,0 +1,51 @@
+/* include/jp/visx/uasf/tablefile.h
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_UASF_TABLEFILE_H
+#define JP_VISX_UASF_TABLEFILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "../uasf.h"
+
+#define JP_VISX_UASF_TABLEFILE_CUMULATIVES 0x1
+
+// A read-only view of a table file (see MappedUncertaintyTable).
+typedef void jp_visx_uasf_MappedUncertaintyTable;
+
+bool jp_visx_uasf_saveTable(jp_visx_uasf_UncertaintyTable *table, const char *path, u32 flags, u64 sequence);
+bool jp_visx_uasf_loadTable(const char *path, jp_visx_uasf_UncertaintyTable *table);
+// Returns NULL if the file could not be mapped.
+jp_visx_uasf_MappedUncertaintyTable *jp_visx_uasf_MappedUncertaintyTable_open(const char *path);
+size_t jp_visx_uasf_MappedUncertaintyTable_count(jp_visx_uasf_MappedUncertaintyTable *table);
+double jp_visx_uasf_MappedUncertaintyTable_getValue(jp_visx_uasf_MappedUncertaintyTable *table, size_t row);
+double jp_visx_uasf_MappedUncertaintyTable_getUncertainty(jp_visx_uasf_MappedUncertaintyTable *table, size_t row);
+jp_visx_uasf_UncertaintyTableElementType jp_visx_uasf_MappedUncertaintyTable_getType(jp_visx_uasf_MappedUncertaintyTable *table, size_t row);
+double jp_visx_uasf_MappedUncertaintyTable_getCumulative(jp_visx_uasf_MappedUncertaintyTable *table, size_t row);
+double jp_visx_uasf_MappedUncertaintyTable_getCumulativeUncertainty(jp_visx_uasf_MappedUncertaintyTable *table, size_t row);
+double jp_visx_uasf_MappedUncertaintyTable_getResult(jp_visx_uasf_MappedUncertaintyTable *table);
+double jp_visx_uasf_MappedUncertaintyTable_getResultingUncertainty(jp_visx_uasf_MappedUncertaintyTable *table);
+void jp_visx_uasf_MappedUncertaintyTable_close(jp_visx_uasf_MappedUncertaintyTable *table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,165 @@
+/* include/jp/visx/uasf/tablefile.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_UASF_TABLEFILE_HPP
+#define JP_VISX_UASF_TABLEFILE_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include "../uasf.hpp"
+#include "../mappedfile.hpp"
+
+namespace jp {
+	namespace visx {
+		namespace uasf {
+			/* A table file is a binary image of an UncertaintyTable. It starts with a
+			 * TableFileHeader and is followed by one column per field, each starting on
+			 * a TABLEFILE_ALIGNMENT boundary:
+			 *		types:					 one i8 per row (UncertaintyTableElementType).
+			 *		values:					 one double per row.
+			 *		uncertainties:			 one double per row.
+			 *		cumulative values:		 one double per row (only with TABLEFILE_CUMULATIVES).
+			 *		cumulative uncertainties: one double per row (only with TABLEFILE_CUMULATIVES).
+			 * The file uses the byte order of the machine that wrote it. Files written
+			 * with a different byte order are rejected rather than converted.
+			 */
+			enum {
+				// The current version of the format.
+				TABLEFILE_VERSION = 1,
+				// The alignment (in bytes) of every column in the file.
+				TABLEFILE_ALIGNMENT = 64,
+				// If set, the cumulative columns are present in the file.
+				TABLEFILE_CUMULATIVES = 0x1
+			};
+			typedef struct {
+				// The magic number, "VISXTBL" followed by a NUL byte.
+				char magic[8];
+				// The version of the format (TABLEFILE_VERSION).
+				u32 version;
+				// 0x01020304 written in the byte order of the writer.
+				u32 byte_order;
+				// The TABLEFILE_* flags.
+				u32 flags;
+				// The size of this header.
+				u32 header_size;
+				// The number of rows (the starting row counts as a row).
+				u64 row_count;
+				// A number which is not used by the table itself. It is free for the
+				// caller to use (for example, to match a file with a journal).
+				u64 sequence;
+				// The result of the table when it was written.
+				double result_value,
+					   result_uncertainty;
+				// The offsets of the columns from the start of the file. The cumulative
+				// offsets are zero if TABLEFILE_CUMULATIVES is not set.
+				u64 types_offset,
+					values_offset,
+					uncertainties_offset,
+					cumulative_values_offset,
+					cumulative_uncertainties_offset;
+				// The total size of the file.
+				u64 file_size;
+				u8 reserved[16];
+			} TableFileHeader;
+
+			/* The MappedUncertaintyTable is a read-only view of a table file. The file is
+			 * mapped into memory, so opening it does not read or copy the rows, and every
+			 * process which opens the same file shares the same pages. It provides the
+			 * const interface of an UncertaintyTable, as well as direct access to the
+			 * columns of the file.
+			 */
+			class MappedUncertaintyTable {
+			public:
+				MappedUncertaintyTable(void);
+				MappedUncertaintyTable(MappedUncertaintyTable &&other);
+				MappedUncertaintyTable &operator=(MappedUncertaintyTable &&other);
+				// This method maps the table file at path. If another file is open, it
+				// is closed first. It returns false if the file could not be mapped or
+				// is not a valid table file.
+				bool open(const char *path);
+				// This method unmaps the file. It does nothing if no file is open.
+				void close(void);
+				// This method returns whether a file is open.
+				bool isOpen(void) const;
+				// This method returns whether the file contains the cumulative columns.
+				bool hasCumulatives(void) const;
+				// This method returns the sequence number stored in the file.
+				u64 getSequence(void) const;
+				// This method gets the number of elements in the table.
+				size_t count(void) const;
+				// This method gets the value of the specified row. If the row is invalid,
+				// it returns NaN.
+				double getValue(size_t row) const;
+				// This method gets the value and uncertainty of the specified row. If the
+				// row is invalid, it puts NaN into the result_dest.
+				void getValue(size_t row, UncertaintyPair *result_dest) const;
+				// This method gets the uncertainty of the specified row. If the row is
+				// invalid, it returns NaN.
+				double getUncertainty(size_t row) const;
+				// This method gets the type of the specified row. If the row is invalid,
+				// it returns UOPERATION_INVALID.
+				UncertaintyTableElementType getType(size_t row) const;
+				// This method gets the cumulative value of the specified row. If the row
+				// is invalid or the file has no cumulatives, it returns NaN.
+				double getCumulative(size_t row) const;
+				// This method gets the cumulative value and uncertainty of the specified
+				// row. If the row is invalid or the file has no cumulatives, it puts NaN
+				// into the result_dest.
+				void getCumulative(size_t row, UncertaintyPair *result_dest) const;
+				// This method gets the cumulative uncertainty of the specified row. If the
+				// row is invalid or the file has no cumulatives, it returns NaN.
+				double getCumulativeUncertainty(size_t row) const;
+				// This method gets the result of the table when it was written.
+				double getResult(void) const;
+				// This method gets the result of the table when it was written.
+				void getResult(UncertaintyPair *result_dest) const;
+				// This method gets the resulting uncertainty of the table when it was
+				// written.
+				double getResultingUncertainty(void) const;
+				// These methods return the columns of the file, or NULL if no file is
+				// open (or, for the cumulatives, if the file has none).
+				const i8 *getTypes(void) const;
+				const double *getValues(void) const;
+				const double *getUncertainties(void) const;
+				const double *getCumulatives(void) const;
+				const double *getCumulativeUncertainties(void) const;
+				// This method copies the rows into an owned table. If the file has
+				// cumulatives, the table is not recomputed.
+				bool copyTo(UncertaintyTable *table_dest) const;
+			private:
+				MappedFile file_;
+				const TableFileHeader *header_;
+			}; // class MappedUncertaintyTable
+
+			// This function writes the table to a table file at path. The flags are
+			// TABLEFILE_* values. The file is written to path with ".tmp" added, and
+			// moved to path once it is complete, so the file at path is never partly
+			// written. It returns false if the file could not be written, in which
+			// case the file at path is not changed.
+			bool saveTable(const UncertaintyTable &table, const char *path, u32 flags = TABLEFILE_CUMULATIVES, u64 sequence = 0);
+			// This function reads a table file into table_dest. It returns false if the
+			// file could not be read, in which case table_dest is not changed.
+			bool loadTable(const char *path, UncertaintyTable *table_dest);
+		} // namespace uasf
+	} // namespace visx
+} // namespace jp
+
+#endif
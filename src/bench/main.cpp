@@ -0,0 +1,359 @@
+/* src/bench/main.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <jp/visx.hpp>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+/* visx_bench measures the hot paths of the uasf library and writes the results
+ * as JSON, so that the results of two builds can be compared. It has two
+ * groups of benchmarks:
+ *		micro - simplifyUncertainty, sigFigCount and the computation of one row,
+ *		macro - building, editing (addAt, remove, swap, set) and recomputing
+ *				tables of 10 to 10^7 rows, for every operation and for a mix.
+ * Every benchmark is repeated until it has run for the minimum time, and the
+ * mean time per operation is reported.
+ */
+
+namespace {
+	const char usage[] =
+		"Usage: visx_bench [OPTION]...\n"
+		"Measure the uasf library and write the results as JSON.\n"
+		"\n"
+		"  -o FILE     write the JSON to FILE instead of stdout\n"
+		"  -m ROWS     the largest table of the macro benchmarks (default: 10000000)\n"
+		"  -t SECONDS  the minimum time of every benchmark (default: 0.2)\n"
+		"  -f FILTER   only run the benchmarks whose name contains FILTER\n"
+		"  -q          do not write the progress to stderr\n"
+		"  -h          show this help\n";
+
+	struct Options {
+		const char *output,
+				   *filter;
+		size_t max_rows;
+		double min_time;
+		bool quiet;
+	};
+
+	struct Result {
+		std::string name,
+					group,
+					mix;
+		size_t rows;
+		u64 iterations,
+			operations;
+		double seconds,
+			   result;
+	};
+
+	// A mix of rows: the operations of the rows of the macro benchmarks. The rows
+	// come in pairs which (nearly) undo each other, so the result of a long table
+	// stays finite and the benchmarks do not measure NaN rows.
+	struct Mix {
+		const char *name;
+		UncertaintyTableElementType type;
+	};
+
+	const Mix mixes[] = {
+		{"ADD", UOPERATION_ADD},
+		{"SUB", UOPERATION_SUB},
+		{"SUBO", UOPERATION_SUBO},
+		{"MUL", UOPERATION_MUL},
+		{"DIV", UOPERATION_DIV},
+		{"DIVO", UOPERATION_DIVO},
+		{"POW", UOPERATION_POW},
+		{"POWO", UOPERATION_POWO},
+		{"MULC", UOPERATION_MULC},
+		{"MULCO", UOPERATION_MULCO},
+		{"DIVC", UOPERATION_DIVC},
+		{"DIVCO", UOPERATION_DIVCO},
+		// Every pair takes one of the operations above.
+		{"MIXED", UOPERATION_INVALID},
+	};
+
+	const size_t micro_batch = 1024;
+
+	typedef std::chrono::steady_clock Clock;
+
+	double since(Clock::time_point start) {
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	class Bench {
+	public:
+		Bench(const Options &options) : options_(options) {}
+
+		bool selected(const std::string &name) const {
+			return !options_.filter || name.find(options_.filter) != std::string::npos;
+		}
+
+		// This method calls fn until it has run for the minimum time. Every call
+		// does operations operations.
+		void run(const std::string &name, const std::string &group, const std::string &mix, size_t rows, u64 operations, const std::function<double(void)> &fn) {
+			if (!this->selected(name)) return;
+			Result result{name, group, mix, rows, 0, 0, 0.0, 0.0};
+			Clock::time_point start = Clock::now();
+			do {
+				result.result = fn();
+				++result.iterations;
+				result.operations += operations;
+			} while ((result.seconds = since(start)) < options_.min_time);
+			this->add(result);
+		}
+
+		// This method is like run, but fn returns the time of the part which is
+		// measured, so that it may prepare (or undo) its work outside the time.
+		void runTimed(const std::string &name, const std::string &group, const std::string &mix, size_t rows, const std::function<double(double *)> &fn) {
+			if (!this->selected(name)) return;
+			Result result{name, group, mix, rows, 0, 0, 0.0, 0.0};
+			Clock::time_point start = Clock::now();
+			do {
+				result.seconds += fn(&result.result);
+				++result.iterations;
+				++result.operations;
+			} while (since(start) < options_.min_time);
+			this->add(result);
+		}
+
+		bool write(FILE *f) const {
+			fprintf(f, "{\n  \"benchmark\": \"visx_bench\",\n  \"version\": 1,\n  \"min_time\": %g,\n  \"results\": [", options_.min_time);
+			for (size_t i = 0; i < results_.size(); ++i) {
+				const Result &r = results_[i];
+				fprintf(f, "%s\n    {\"name\": \"%s\", \"group\": \"%s\", ", i ? "," : "", r.name.c_str(), r.group.c_str());
+				if (r.mix.empty()) fputs("\"mix\": null, ", f);
+				else fprintf(f, "\"mix\": \"%s\", ", r.mix.c_str());
+				fprintf(f, "\"rows\": %zu, \"iterations\": %llu, \"operations\": %llu, \"seconds\": %.9g, \"ns_per_op\": %.6g, ", r.rows, (unsigned long long)r.iterations, (unsigned long long)r.operations, r.seconds, r.seconds * 1e9 / r.operations);
+				// JSON has no NaN or infinity.
+				if (isfinite(r.result)) fprintf(f, "\"result\": %.17g}", r.result);
+				else fputs("\"result\": null}", f);
+			}
+			fputs("\n  ]\n}\n", f);
+			return !ferror(f);
+		}
+	private:
+		void add(const Result &result) {
+			if (!options_.quiet) fprintf(stderr, "%-40s %8zu rows %14.1f ns/op\n", result.name.c_str(), result.rows, result.seconds * 1e9 / result.operations);
+			results_.push_back(result);
+		}
+		const Options &options_;
+		std::vector<Result> results_;
+	};
+
+	// This function adds the rows of a mix to a table.
+	void fill(UncertaintyTable *table, const Mix &mix, size_t rows, u32 seed) {
+		static const UncertaintyTableElementType mixed[] = {UOPERATION_ADD, UOPERATION_SUB, UOPERATION_MUL, UOPERATION_DIV, UOPERATION_POW};
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<double> values(1.01, 1.3);
+		table->reserve(rows + 1);
+		for (size_t i = 0; i < rows; i += 2) {
+			UncertaintyTableElementType type = mix.type == UOPERATION_INVALID ? mixed[random() % NELS(mixed)] : mix.type;
+			double value = values(random), second = value;
+			UncertaintyTableElementType second_type = type;
+			// The second row of the pair undoes the first.
+			switch (type) {
+			case UOPERATION_ADD:
+				second_type = mix.type == UOPERATION_INVALID ? UOPERATION_SUB : type;
+				break;
+			case UOPERATION_SUB:
+				second_type = mix.type == UOPERATION_INVALID ? UOPERATION_ADD : type;
+				break;
+			case UOPERATION_MUL:
+			case UOPERATION_DIV:
+			case UOPERATION_MULC:
+			case UOPERATION_MULCO:
+			case UOPERATION_DIVC:
+			case UOPERATION_POW:
+				second = 1.0 / value;
+				break;
+			// Like SUBO, DIVO and POWO, DIVCO is undone by the same row (v / (v / c)
+			// is c).
+			case UOPERATION_DIVCO:
+				break;
+			default:
+				break;
+			}
+			// The uncertainties are small enough that they do not round the values
+			// of a long table to zero.
+			table->add(type, value, value * 1e-12);
+			if (i + 1 < rows) table->add(second_type, second, second * 1e-12);
+		}
+	}
+
+	void runMicro(Bench &bench) {
+		std::mt19937 random(1);
+		std::uniform_real_distribution<double> exponents(-6.0, 6.0), digits(1.0, 10.0);
+		// Inputs which are all different, and inputs which repeat (like the
+		// cumulatives of a table which is recomputed).
+		std::vector<double> values(1 << 16), uncertainties(1 << 16);
+		for (size_t i = 0; i < values.size(); ++i) {
+			double scale = pow(10.0, exponents(random));
+			values[i] = digits(random) * scale;
+			uncertainties[i] = digits(random) * scale * 1e-3;
+		}
+		bool cache_enabled = isSimplifyCacheEnabled();
+		size_t next = 0;
+		setSimplifyCacheEnabled(false);
+		bench.run("simplifyUncertainty", "micro", "", 0, micro_batch, [&](void) {
+			double sum = 0.0, value, uncertainty;
+			for (size_t i = 0; i < micro_batch; ++i, next = (next + 1) & (values.size() - 1)) {
+				simplifyUncertainty(values[next], uncertainties[next], &value, &uncertainty);
+				sum += value;
+			}
+			return sum;
+		});
+		setSimplifyCacheEnabled(true);
+		bench.run("simplifyUncertainty/cached", "micro", "", 0, micro_batch, [&](void) {
+			double sum = 0.0, value, uncertainty;
+			for (size_t i = 0; i < micro_batch; ++i, next = (next + 1) & 255) {
+				simplifyUncertainty(values[next], uncertainties[next], &value, &uncertainty);
+				sum += value;
+			}
+			return sum;
+		});
+		setSimplifyCacheEnabled(cache_enabled);
+		const char *numbers[] = {"0", "1", "12300", "1.2300", "0.00120", "-4.560", "1.2e5", "6.02214076e23", "100.", "0.000000001"};
+		bench.run("sigFigCount", "micro", "", 0, micro_batch, [&](void) {
+			u64 sum = 0;
+			for (size_t i = 0; i < micro_batch; ++i) {
+				sum += sigFigCount(numbers[i % NELS(numbers)]);
+			}
+			return (double)sum;
+		});
+		// The computation of one row, through the table (setting the last row of a
+		// table computes that row only).
+		for (const Mix &mix : mixes) {
+			UncertaintyTable table(0, 1.5, 1e-12);
+			fill(&table, mix, 2, 1);
+			size_t row = table.count() - 1;
+			double value = table.getValue(row), uncertainty = table.getUncertainty(row);
+			bench.run(std::string("UncertaintyTable::compute/") + mix.name, "micro", mix.name, table.count(), micro_batch, [&](void) {
+				for (size_t i = 0; i < micro_batch; ++i) {
+					table.set(row, value, uncertainty);
+				}
+				return table.getResult();
+			});
+		}
+	}
+
+	void runMacro(Bench &bench, size_t max_rows) {
+		for (size_t rows = 10; rows <= max_rows; rows *= 10) {
+			for (const Mix &mix : mixes) {
+				std::string suffix = std::string("/") + mix.name + "/" + std::to_string(rows);
+				bench.runTimed("build" + suffix, "macro", mix.name, rows, [&](double *result) {
+					Clock::time_point start = Clock::now();
+					UncertaintyTable table(0, 1.5, 1e-12);
+					table.beginBatch();
+					fill(&table, mix, rows, 1);
+					table.endBatch();
+					double seconds = since(start);
+					*result = table.getResult();
+					return seconds;
+				});
+				// The other benchmarks share one table, which they leave as it was.
+				if (!bench.selected("recompute" + suffix) && !bench.selected("addAt" + suffix) && !bench.selected("remove" + suffix) && !bench.selected("swap" + suffix) && !bench.selected("set" + suffix)) continue;
+				UncertaintyTable table(0, 1.5, 1e-12);
+				table.beginBatch();
+				fill(&table, mix, rows, 1);
+				table.endBatch();
+				// The edits are made in the middle of the table, so half of the rows
+				// are computed again.
+				size_t middle = table.count() / 2;
+				bench.run("recompute" + suffix, "macro", mix.name, rows, 1, [&](void) {
+					table.recompute();
+					return table.getResult();
+				});
+				UncertaintyTableElement element = table.getElement(middle);
+				bench.runTimed("addAt" + suffix, "macro", mix.name, rows, [&](double *result) {
+					Clock::time_point start = Clock::now();
+					table.addAt(middle, element.getType(), element.getValue(), element.getUncertainty());
+					double seconds = since(start);
+					*result = table.getResult();
+					table.remove(middle);
+					return seconds;
+				});
+				bench.runTimed("remove" + suffix, "macro", mix.name, rows, [&](double *result) {
+					Clock::time_point start = Clock::now();
+					table.remove(middle);
+					double seconds = since(start);
+					*result = table.getResult();
+					table.addAt(middle, element.getType(), element.getValue(), element.getUncertainty());
+					return seconds;
+				});
+				bench.run("swap" + suffix, "macro", mix.name, rows, 1, [&](void) {
+					table.swap(middle, middle + 1);
+					return table.getResult();
+				});
+				double values[] = {element.getValue(), element.getValue() * 1.000001};
+				size_t flip = 0;
+				bench.run("set" + suffix, "macro", mix.name, rows, 1, [&](void) {
+					table.set(middle, values[++flip & 1]);
+					return table.getResult();
+				});
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	Options options{nullptr, nullptr, 10000000, 0.2, false};
+	for (int i = 1; i < argc; ++i) {
+		const char *arg = argv[i];
+		if (!strcmp(arg, "-o") && i + 1 < argc) {
+			options.output = argv[++i];
+		} else if (!strcmp(arg, "-m") && i + 1 < argc) {
+			options.max_rows = strtoul(argv[++i], nullptr, 10);
+		} else if (!strcmp(arg, "-t") && i + 1 < argc) {
+			options.min_time = strtod(argv[++i], nullptr);
+		} else if (!strcmp(arg, "-f") && i + 1 < argc) {
+			options.filter = argv[++i];
+		} else if (!strcmp(arg, "-q")) {
+			options.quiet = true;
+		} else if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+			fputs(usage, stdout);
+			return 0;
+		} else {
+			fprintf(stderr, "visx_bench: invalid option '%s'\n%s", arg, usage);
+			return 2;
+		}
+	}
+	Bench bench(options);
+	runMicro(bench);
+	runMacro(bench, options.max_rows);
+	FILE *f = options.output ? fopen(options.output, "w") : stdout;
+	if (!f) {
+		fprintf(stderr, "visx_bench: could not open '%s'\n", options.output);
+		return 1;
+	}
+	bool ok = bench.write(f);
+	if (options.output) ok = !fclose(f) && ok;
+	if (!ok) {
+		fprintf(stderr, "visx_bench: could not write the results\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,338 @@
+/* src/cli/main.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <errno.h>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+/* The console front-end runs in three stages, each on its own thread:
+ *		parse   - read the lines of the inputs and parse them into terms,
+ *		compute - run the terms through an UncertaintyChain,
+ *		format  - write the results to stdout.
+ * The stages pass batches of rows through SpscQueues, and the used batches go
+ * back from the last stage to the first so they are not allocated again.
+ */
+
+namespace {
+	const char usage[] =
+		"Usage: visx-cli [OPTION]... [FILE]...\n"
+		"Compute the uncertainty of the rows or expressions in the FILEs (or stdin).\n"
+		"\n"
+		"Without -e, every line is a row of an uncertainty table, with the columns\n"
+		"operation, value and uncertainty (for example \"MUL,2.5,0.1\"). The files are\n"
+		"one table, starting at 0, and the result is written after every row. A NUL\n"
+		"row restarts the table at its value.\n"
+		"\n"
+		"  -e        every line is an expression (for example \"2.5+/-0.1 * 3 / 1.2\"),\n"
+		"            computed from left to right with the operators + - * / ^\n"
+		"  -s        only write the result of the last row (or expression)\n"
+		"  -d DELIM  the delimiter between the columns (default: tab if the first line\n"
+		"            of a file has one, comma otherwise)\n"
+		"  -t        separate the value and uncertainty with a tab instead of \" +/- \"\n"
+		"  -h        show this help\n"
+		"\n"
+		"Empty lines and lines starting with '#' are skipped. Without -e, if the first\n"
+		"line of a file is not a valid row, it is skipped as a header.\n";
+
+	// The number of rows sent between the stages at once. Passing them in batches
+	// keeps the cost of the queues small next to the cost of the rows.
+	const size_t batch_rows = 4096;
+
+	struct Options {
+		bool expressions,
+			 summary;
+		char delimiter;
+		const char *separator;
+		std::vector<const char *> paths;
+	};
+
+	// One row of a table or one operand of an expression. The chain is restarted at
+	// every NUL term, and its result is written after every term with emit set.
+	struct Term {
+		UncertaintyTableElementType type;
+		double value,
+			   uncertainty;
+		bool emit;
+	};
+
+	struct Batch {
+		std::vector<Term> terms;
+		std::vector<UncertaintyPair> results;
+		// If the input stops after this batch because of an error, the message to
+		// write. Otherwise, it is empty.
+		std::string error;
+	};
+
+	// Every stage closes its output queue at the end of its input.
+	typedef SpscQueue<std::unique_ptr<Batch>> BatchQueue;
+
+	// The first stage.
+	class Parser {
+	public:
+		Parser(const Options &options, BatchQueue &output, BatchQueue &free_batches) : options_(options), output_(output), free_batches_(free_batches), failed_(false) {}
+
+		void run(void) {
+			if (options_.paths.empty()) {
+				this->parseFile(stdin, "<stdin>");
+			}
+			for (const char *path : options_.paths) {
+				if (failed_) break;
+				if (!strcmp(path, "-")) {
+					this->parseFile(stdin, "<stdin>");
+					continue;
+				}
+				FILE *file = fopen(path, "rb");
+				if (!file) {
+					this->fail(std::string(path) + ": " + strerror(errno));
+					break;
+				}
+				this->parseFile(file, path);
+				fclose(file);
+			}
+			if (batch_) this->send();
+			output_.close();
+		}
+	private:
+		// Read the lines of a file. The buffer grows if a line does not fit.
+		void parseFile(FILE *file, const char *name) {
+			std::vector<char> buffer(1 << 20);
+			size_t used = 0, line_number = 0;
+			delimiter_ = options_.delimiter;
+			for (;;) {
+				// Leave room to terminate the last line.
+				size_t n = fread(buffer.data() + used, 1, buffer.size() - used - 1, file);
+				used += n;
+				bool end = n == 0;
+				if (end && ferror(file)) {
+					this->fail(std::string(name) + ": " + strerror(errno));
+					return;
+				}
+				char *line = buffer.data(), *data_end = buffer.data() + used;
+				for (;;) {
+					char *newline = (char *)memchr(line, '\n', data_end - line);
+					if (!newline) {
+						// At the end of the file, the last line has no line feed.
+						if (!end || line == data_end) break;
+						newline = data_end;
+					}
+					*newline = '\0';
+					if (!this->parseLine(line, newline, name, ++line_number)) return;
+					line = newline + 1;
+					if (line > data_end) break;
+				}
+				if (end) return;
+				// Keep the unfinished line.
+				used = line < data_end ? data_end - line : 0;
+				memmove(buffer.data(), line, used);
+				if (used + 1 == buffer.size()) buffer.resize(2 * buffer.size());
+			}
+		}
+
+		// Parse one line, which is terminated at end. It returns false if the input
+		// has stopped.
+		bool parseLine(char *line, char *end, const char *name, size_t line_number) {
+			Batch &batch = this->getBatch();
+			size_t old_size = batch.terms.size();
+			bool ok;
+			if (options_.expressions) {
+				ok = this->parseExpression(line, &batch);
+			} else {
+				if (!delimiter_) delimiter_ = memchr(line, '\t', end - line) ? '\t' : ',';
+				Term term;
+				bool empty;
+				ok = parseRow(line, end - line, delimiter_, &term.type, &term.value, &term.uncertainty, &empty);
+				if (ok && !empty) {
+					term.emit = !options_.summary;
+					batch.terms.push_back(term);
+				}
+			}
+			if (!ok) {
+				batch.terms.resize(old_size);
+				// The first line of a file of rows may be a header.
+				if (options_.expressions || line_number != 1) {
+					char number[24];
+					snprintf(number, sizeof(number), ":%zu: ", line_number);
+					this->fail(name + std::string(number) + (options_.expressions ? "invalid expression" : "invalid row"));
+					return false;
+				}
+			}
+			if (batch.terms.size() >= batch_rows) this->send();
+			return true;
+		}
+
+		// Parse an expression into its terms.
+		bool parseExpression(const char *s, Batch *batch) {
+			elements_.clear();
+			if (!uasf::parseExpression(s, &elements_)) return false;
+			for (const UncertaintyTableElement &element : elements_) {
+				batch->terms.push_back(Term{element.getType(), element.getValue(), element.getUncertainty(), false});
+			}
+			if (!elements_.empty()) batch->terms.back().emit = !options_.summary;
+			return true;
+		}
+
+		Batch &getBatch(void) {
+			if (!batch_ && !free_batches_.tryPop(&batch_)) {
+				batch_.reset(new Batch());
+				batch_->terms.reserve(batch_rows + 64);
+			}
+			return *batch_;
+		}
+
+		void send(void) {
+			output_.push(std::move(batch_));
+			batch_.reset();
+		}
+
+		// Stop the input with an error, which is written after the rows before it.
+		void fail(const std::string &error) {
+			this->getBatch().error = error;
+			failed_ = true;
+		}
+
+		const Options &options_;
+		BatchQueue &output_, &free_batches_;
+		std::unique_ptr<Batch> batch_;
+		std::vector<UncertaintyTableElement> elements_;
+		char delimiter_;
+		bool failed_;
+	};
+
+	// The second stage.
+	void compute(const Options &options, BatchQueue &input, BatchQueue &output) {
+		UncertaintyChain chain;
+		bool failed = false;
+		std::unique_ptr<Batch> batch;
+		while (input.pop(&batch)) {
+			batch->results.clear();
+			for (const Term &term : batch->terms) {
+				if (term.type == UOPERATION_NUL) {
+					chain = UncertaintyChain(term.value, term.uncertainty);
+				} else {
+					chain.add(term.type, term.value, term.uncertainty);
+				}
+				if (term.emit) {
+					UncertaintyPair result;
+					chain.getResult(&result);
+					batch->results.push_back(result);
+				}
+			}
+			if (!batch->error.empty()) failed = true;
+			output.push(std::move(batch));
+		}
+		// The summary is not written if the input stopped early. The chain holds
+		// the last row, or the last expression (which starts with a NUL term).
+		if (options.summary && !failed) {
+			batch.reset(new Batch());
+			UncertaintyPair result;
+			chain.getResult(&result);
+			batch->results.push_back(result);
+			output.push(std::move(batch));
+		}
+		output.close();
+	}
+
+	// The last stage. It returns the exit status.
+	int format(const Options &options, BatchQueue &input, BatchQueue &free_batches) {
+		std::vector<char> out(1 << 16);
+		size_t used = 0;
+		int status = 0;
+		std::unique_ptr<Batch> batch;
+		while (input.pop(&batch)) {
+			for (const UncertaintyPair &result : batch->results) {
+				size_t length = formatUncertainty(result.value, result.uncertainty, options.separator, out.data() + used, out.size() - used);
+				// If the result did not fit (with its line feed), write the rest out and
+				// format it again.
+				if (length + 1 >= out.size() - used) {
+					fwrite(out.data(), 1, used, stdout);
+					used = 0;
+					length = formatUncertainty(result.value, result.uncertainty, options.separator, out.data(), out.size());
+				}
+				used += length;
+				out[used++] = '\n';
+			}
+			if (!batch->error.empty()) {
+				fwrite(out.data(), 1, used, stdout);
+				used = 0;
+				fflush(stdout);
+				fprintf(stderr, "visx-cli: %s\n", batch->error.c_str());
+				status = 1;
+			}
+			// Give the batch back to the first stage. If it has enough, drop it.
+			batch->terms.clear();
+			batch->error.clear();
+			free_batches.tryPush(std::move(batch));
+		}
+		fwrite(out.data(), 1, used, stdout);
+		fflush(stdout);
+		return status;
+	}
+
+	bool parseArguments(int argc, char **argv, Options *options) {
+		options->expressions = options->summary = false;
+		options->delimiter = '\0';
+		options->separator = " +/- ";
+		bool files_only = false;
+		for (int i = 1; i < argc; ++i) {
+			const char *arg = argv[i];
+			if (files_only || arg[0] != '-' || !arg[1]) {
+				options->paths.push_back(arg);
+			} else if (!strcmp(arg, "--")) {
+				files_only = true;
+			} else if (!strcmp(arg, "-e")) {
+				options->expressions = true;
+			} else if (!strcmp(arg, "-s")) {
+				options->summary = true;
+			} else if (!strcmp(arg, "-t")) {
+				options->separator = "\t";
+			} else if (!strcmp(arg, "-d") && i + 1 < argc && argv[i + 1][0]) {
+				const char *delimiter = argv[++i];
+				options->delimiter = !strcmp(delimiter, "\\t") || !strcmp(delimiter, "tab") ? '\t' : delimiter[0];
+			} else if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+				fputs(usage, stdout);
+				exit(0);
+			} else {
+				fprintf(stderr, "visx-cli: invalid option '%s'\n%s", arg, usage);
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char **argv) {
+	Options options;
+	if (!parseArguments(argc, argv, &options)) return 2;
+	BatchQueue parsed(64), computed(64), free_batches(256);
+	Parser parser(options, parsed, free_batches);
+	std::thread parse_thread([&parser](void) { parser.run(); });
+	std::thread compute_thread([&options, &parsed, &computed](void) { compute(options, parsed, computed); });
+	int status = format(options, computed, free_batches);
+	parse_thread.join();
+	compute_thread.join();
+	return status;
+}
@@ -0,0 +1,161 @@
+/* src/daemon/bench.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <jp/visx/daemon.hpp>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+/* visx-daemon-bench sends requests to a running visx-daemon from several
+ * clients at once, and reports the throughput and the latency of the requests.
+ * The clients draw their tables from one shared set, so some of the requests
+ * are answered from the cache of the daemon.
+ */
+
+namespace {
+	const char usage[] =
+		"Usage: visx-daemon-bench [OPTION]...\n"
+		"Send requests to a visx-daemon and measure them.\n"
+		"\n"
+		"  -s PATH     the socket of the daemon (default: visx-daemon.sock in\n"
+		"              $XDG_RUNTIME_DIR, or /tmp/visx-daemon.sock if it is not set)\n"
+		"  -c CLIENTS  the number of clients, each on its own thread (default: 8)\n"
+		"  -n COUNT    the number of requests per client (default: 10000)\n"
+		"  -r ROWS     the number of rows per table (default: 64)\n"
+		"  -u TABLES   the number of different tables (default: 256)\n"
+		"  -h          show this help\n";
+
+	struct Table {
+		std::vector<UncertaintyTableElementType> types;
+		std::vector<double> values,
+							uncertainties;
+		UncertaintyPair expected;
+	};
+
+	const UncertaintyTableElementType operations[] = {UOPERATION_ADD, UOPERATION_SUB, UOPERATION_MUL, UOPERATION_DIV};
+
+	Table makeTable(size_t rows, u32 seed) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<double> values(1.0, 2.0), uncertainties(0.0, 0.01);
+		Table table;
+		UncertaintyChain chain;
+		for (size_t i = 0; i < rows; ++i) {
+			UncertaintyTableElementType type = operations[random() % NELS(operations)];
+			double value = values(random), uncertainty = uncertainties(random);
+			table.types.push_back(type);
+			table.values.push_back(value);
+			table.uncertainties.push_back(uncertainty);
+			chain.add(type, value, uncertainty);
+		}
+		chain.getResult(&table.expected);
+		return table;
+	}
+
+	bool same(double a, double b) {
+		return a == b || (isnan(a) && isnan(b));
+	}
+}
+
+int main(int argc, char **argv) {
+	const char *path = nullptr;
+	size_t clients = 8, count = 10000, rows = 64, tables = 256;
+	for (int i = 1; i < argc; ++i) {
+		const char *arg = argv[i];
+		if (!strcmp(arg, "-s") && i + 1 < argc) {
+			path = argv[++i];
+		} else if (!strcmp(arg, "-c") && i + 1 < argc) {
+			clients = strtoul(argv[++i], nullptr, 10);
+		} else if (!strcmp(arg, "-n") && i + 1 < argc) {
+			count = strtoul(argv[++i], nullptr, 10);
+		} else if (!strcmp(arg, "-r") && i + 1 < argc) {
+			rows = strtoul(argv[++i], nullptr, 10);
+		} else if (!strcmp(arg, "-u") && i + 1 < argc) {
+			tables = strtoul(argv[++i], nullptr, 10);
+		} else if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+			fputs(usage, stdout);
+			return 0;
+		} else {
+			fprintf(stderr, "visx-daemon-bench: invalid option '%s'\n%s", arg, usage);
+			return 2;
+		}
+	}
+	if (!clients || !tables) {
+		fputs(usage, stderr);
+		return 2;
+	}
+	std::vector<Table> set;
+	for (size_t i = 0; i < tables; ++i) {
+		set.push_back(makeTable(rows, (u32)i));
+	}
+	// Every client records the latency of its requests in nanoseconds.
+	std::vector<std::vector<u64>> latencies(clients);
+	std::vector<size_t> failures(clients, 0);
+	std::vector<std::thread> threads;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t c = 0; c < clients; ++c) {
+		threads.emplace_back([&, c](void) {
+			DaemonClient client;
+			if (!client.connect(path)) {
+				failures[c] = count;
+				return;
+			}
+			std::mt19937 random((u32)c);
+			latencies[c].reserve(count);
+			for (size_t i = 0; i < count; ++i) {
+				const Table &table = set[random() % set.size()];
+				UncertaintyPair result;
+				auto request_start = std::chrono::steady_clock::now();
+				bool ok = client.evaluate(table.types.data(), table.values.data(), table.uncertainties.data(), rows, &result);
+				latencies[c].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - request_start).count());
+				if (!ok || !same(result.value, table.expected.value) || !same(result.uncertainty, table.expected.uncertainty)) {
+					++failures[c];
+					if (!client.isConnected()) return;
+				}
+			}
+		});
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::vector<u64> all;
+	size_t failed = 0;
+	for (size_t c = 0; c < clients; ++c) {
+		all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+		failed += failures[c];
+	}
+	if (all.empty()) {
+		fprintf(stderr, "visx-daemon-bench: could not reach the daemon\n");
+		return 1;
+	}
+	std::sort(all.begin(), all.end());
+	printf("requests:   %zu (%zu clients, %zu rows, %zu tables)\n", all.size(), clients, rows, tables);
+	printf("throughput: %.0f requests/s\n", all.size() / seconds);
+	printf("latency:    p50 %.1f us, p99 %.1f us, max %.1f us\n", all[all.size() / 2] / 1000.0, all[all.size() * 99 / 100] / 1000.0, all.back() / 1000.0);
+	printf("failures:   %zu\n", failed);
+	return failed ? 1 : 0;
+}
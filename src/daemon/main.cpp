@@ -0,0 +1,398 @@
+/* src/daemon/main.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <jp/visx/daemon.hpp>
+#include <errno.h>
+#include <fcntl.h>
+#include <iterator>
+#include <map>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+/* visx-daemon serves the requests of DaemonClients (see daemon.hpp) on a Unix
+ * domain socket. A single thread waits on the sockets. Every time it wakes up,
+ * it reads the complete requests of every ready client, and computes them
+ * together: identical requests are computed once, and the rest are split
+ * between the workers of a ThreadPool. The results of the rows are kept in the
+ * global ResultCache.
+ */
+
+namespace {
+	const char usage[] =
+		"Usage: visx-daemon [OPTION]...\n"
+		"Compute uncertainty tables and expressions for the clients on this host.\n"
+		"\n"
+		"  -s PATH     listen at PATH (default: visx-daemon.sock in $XDG_RUNTIME_DIR,\n"
+		"              or /tmp/visx-daemon.sock if it is not set)\n"
+		"  -j THREADS  the number of workers (default: one per hardware thread)\n"
+		"  -c MIB      the size of the result cache in MiB (default: 64, 0 to disable)\n"
+		"  -h          show this help\n";
+
+	// The input read from a client at once, and the output queued for it, beyond
+	// which the daemon stops reading from the client until its output is written.
+	// A complete frame always fits in the input.
+	const size_t max_client_input = 4 + (size_t)DAEMON_MAX_FRAME,
+				 max_client_output = 2 * (size_t)DAEMON_MAX_FRAME;
+
+	volatile sig_atomic_t stopping = 0;
+
+	void stop(int) {
+		stopping = 1;
+	}
+
+	template <typename T>
+	void put(std::string *dest, T value) {
+		dest->append((const char *)&value, sizeof(T));
+	}
+
+	template <typename T>
+	T get(const char *src) {
+		T value;
+		memcpy(&value, src, sizeof(T));
+		return value;
+	}
+
+	struct Client {
+		int fd;
+		std::string input,
+					output;
+		// The number of bytes of output which were written.
+		size_t written;
+	};
+
+	struct Request {
+		u64 client;
+		u32 id;
+		// The kind, flags and payload of the request. Requests with the same key
+		// have the same response.
+		std::string key;
+		// The response after its size and id.
+		const std::string *response;
+	};
+
+	// Compute the response to a request (without its size and id).
+	std::string respond(const std::string &key) {
+		u8 kind = key[0], flags = key[1];
+		const char *payload = key.data() + 2;
+		size_t size = key.size() - 2;
+		std::string response;
+		std::vector<UncertaintyTableElementType> types;
+		std::vector<double> values,
+							uncertainties;
+		bool ok = false;
+		if (kind == DAEMON_TABLE && size >= 4) {
+			u32 count = get<u32>(payload);
+			if (size - 4 == (size_t)count * 17) {
+				ok = true;
+				types.reserve(count);
+				values.reserve(count);
+				uncertainties.reserve(count);
+				const char *value = payload + 4 + count, *uncertainty = value + 8 * (size_t)count;
+				for (u32 i = 0; ok && i < count; ++i) {
+					i8 type = (i8)payload[4 + i];
+					ok = type >= UOPERATION_NUL && type < UOPERATION_INVALID;
+					types.push_back((UncertaintyTableElementType)type);
+					values.push_back(get<double>(value + 8 * i));
+					uncertainties.push_back(get<double>(uncertainty + 8 * i));
+				}
+			}
+		} else if (kind == DAEMON_EXPRESSION) {
+			// The expression is not terminated in the request.
+			std::vector<UncertaintyTableElement> elements;
+			ok = parseExpression(std::string(payload, size).c_str(), &elements) && !elements.empty();
+			for (const UncertaintyTableElement &element : elements) {
+				types.push_back(element.getType());
+				values.push_back(element.getValue());
+				uncertainties.push_back(element.getUncertainty());
+			}
+		}
+		if (!ok) {
+			put<u8>(&response, DAEMON_INVALID);
+			put<double>(&response, NAN);
+			put<double>(&response, NAN);
+			return response;
+		}
+		put<u8>(&response, DAEMON_OK);
+		if (!(flags & DAEMON_ALL_ROWS)) {
+			UncertaintyPair result;
+			evaluateRows(types.data(), values.data(), uncertainties.data(), types.size(), &result, &ResultCache::global());
+			put<double>(&response, result.value);
+			put<double>(&response, result.uncertainty);
+			return response;
+		}
+		// Every row is needed, so the cache is not used.
+		UncertaintyChain chain;
+		std::string rows;
+		for (size_t i = 0; i < types.size(); ++i) {
+			chain.add(types[i], values[i], uncertainties[i]);
+			put<double>(&rows, chain.getResult());
+			put<double>(&rows, chain.getResultingUncertainty());
+		}
+		put<double>(&response, chain.getResult());
+		put<double>(&response, chain.getResultingUncertainty());
+		put<u32>(&response, (u32)types.size());
+		response += rows;
+		return response;
+	}
+
+	class Server {
+	public:
+		Server(ThreadPool &pool) : pool_(pool), listener_(-1), next_client_(0) {}
+
+		~Server(void) {
+			for (auto &client : clients_) {
+				close(client.second.fd);
+			}
+			if (listener_ >= 0) {
+				close(listener_);
+				unlink(path_.c_str());
+			}
+		}
+
+		bool listen(const char *path) {
+			sockaddr_un address;
+			memset(&address, 0, sizeof(address));
+			address.sun_family = AF_UNIX;
+			if (strlen(path) >= sizeof(address.sun_path)) {
+				fprintf(stderr, "visx-daemon: %s: path too long\n", path);
+				return false;
+			}
+			strcpy(address.sun_path, path);
+			if (!this->removeStaleSocket(path, address)) return false;
+			int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+			if (fd < 0 || bind(fd, (const sockaddr *)&address, sizeof(address)) || ::listen(fd, 64)) {
+				fprintf(stderr, "visx-daemon: %s: %s\n", path, strerror(errno));
+				if (fd >= 0) close(fd);
+				return false;
+			}
+			fcntl(fd, F_SETFL, O_NONBLOCK);
+			listener_ = fd;
+			path_ = path;
+			return true;
+		}
+
+		void run(void) {
+			std::vector<pollfd> fds;
+			std::vector<u64> ids;
+			while (!stopping) {
+				fds.assign(1, pollfd{listener_, POLLIN, 0});
+				ids.clear();
+				for (auto &client : clients_) {
+					// A client which does not read its responses is not read from.
+					short events = client.second.output.size() - client.second.written < max_client_output ? POLLIN : 0;
+					if (client.second.written < client.second.output.size()) events |= POLLOUT;
+					fds.push_back(pollfd{client.second.fd, events, 0});
+					ids.push_back(client.first);
+				}
+				if (poll(fds.data(), fds.size(), -1) < 0) {
+					if (errno == EINTR) continue;
+					perror("visx-daemon: poll");
+					return;
+				}
+				if (fds[0].revents & POLLIN) this->accept();
+				for (size_t i = 1; i < fds.size(); ++i) {
+					auto it = clients_.find(ids[i - 1]);
+					if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+						if (!this->read(it->first, &it->second)) {
+							this->drop(it);
+							continue;
+						}
+					}
+					if ((fds[i].revents & POLLOUT) && !this->write(&it->second)) {
+						this->drop(it);
+					}
+				}
+				if (!requests_.empty()) this->answer();
+			}
+		}
+	private:
+		// Remove the socket of a daemon which did not stop cleanly. The path may be
+		// in a directory which other users can write to, so only a socket of this
+		// user is removed, and only if no daemon listens on it.
+		bool removeStaleSocket(const char *path, const sockaddr_un &address) {
+			struct stat status;
+			if (lstat(path, &status)) {
+				if (errno == ENOENT) return true;
+				fprintf(stderr, "visx-daemon: %s: %s\n", path, strerror(errno));
+				return false;
+			}
+			if (!S_ISSOCK(status.st_mode) || status.st_uid != geteuid()) {
+				fprintf(stderr, "visx-daemon: %s: exists and is not a socket of this user\n", path);
+				return false;
+			}
+			int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+			bool listening = fd >= 0 && !::connect(fd, (const sockaddr *)&address, sizeof(address));
+			if (fd >= 0) close(fd);
+			if (listening) {
+				fprintf(stderr, "visx-daemon: %s: another daemon is listening\n", path);
+				return false;
+			}
+			if (unlink(path) && errno != ENOENT) {
+				fprintf(stderr, "visx-daemon: %s: %s\n", path, strerror(errno));
+				return false;
+			}
+			return true;
+		}
+
+		void accept(void) {
+			for (;;) {
+				int fd = ::accept(listener_, nullptr, nullptr);
+				if (fd < 0) return;
+				fcntl(fd, F_SETFL, O_NONBLOCK);
+				clients_[next_client_++] = Client{fd, std::string(), std::string(), 0};
+			}
+		}
+
+		void drop(std::map<u64, Client>::iterator it) {
+			close(it->second.fd);
+			clients_.erase(it);
+		}
+
+		// Read what the client sent and queue its complete requests. It returns false
+		// if the client is gone or sent an invalid frame. At most max_client_input
+		// bytes are kept; the rest is read once the requests before it are queued.
+		bool read(u64 id, Client *client) {
+			char buffer[1 << 16];
+			while (client->input.size() < max_client_input) {
+				size_t room = max_client_input - client->input.size();
+				ssize_t n = ::read(client->fd, buffer, room < sizeof(buffer) ? room : sizeof(buffer));
+				if (n > 0) {
+					client->input.append(buffer, n);
+					continue;
+				}
+				if (n == 0) return false;
+				if (errno == EINTR) continue;
+				if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+				return false;
+			}
+			size_t position = 0;
+			while (client->input.size() - position >= 4) {
+				u32 size = get<u32>(client->input.data() + position);
+				// A request has at least an id, a kind and flags.
+				if (size < 6 || size > DAEMON_MAX_FRAME) return false;
+				if (client->input.size() - position - 4 < size) break;
+				const char *frame = client->input.data() + position + 4;
+				requests_.push_back(Request{id, get<u32>(frame), std::string(frame + 4, size - 4), nullptr});
+				position += 4 + size;
+			}
+			client->input.erase(0, position);
+			return true;
+		}
+
+		// Write as much of the output as the socket takes. It returns false if the
+		// client is gone.
+		bool write(Client *client) {
+			while (client->written < client->output.size()) {
+				ssize_t n = ::write(client->fd, client->output.data() + client->written, client->output.size() - client->written);
+				if (n < 0) {
+					if (errno == EINTR) continue;
+					return errno == EAGAIN || errno == EWOULDBLOCK;
+				}
+				client->written += n;
+			}
+			client->output.clear();
+			client->written = 0;
+			return true;
+		}
+
+		// Answer the queued requests.
+		void answer(void) {
+			// Find the requests which must be computed, once per key.
+			std::unordered_map<std::string, size_t> batch;
+			std::vector<const std::string *> keys;
+			for (Request &request : requests_) {
+				if (batch.emplace(request.key, keys.size()).second) keys.push_back(&request.key);
+			}
+			std::vector<std::string> responses(keys.size());
+			pool_.parallelFor(keys.size(), 1, [&keys, &responses](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i) {
+					responses[i] = respond(*keys[i]);
+				}
+			});
+			for (Request &request : requests_) {
+				request.response = &responses[batch[request.key]];
+				auto it = clients_.find(request.client);
+				// The client may have left after sending the request.
+				if (it == clients_.end()) continue;
+				std::string &output = it->second.output;
+				put<u32>(&output, (u32)(4 + request.response->size()));
+				put<u32>(&output, request.id);
+				output += *request.response;
+			}
+			requests_.clear();
+			for (auto it = clients_.begin(); it != clients_.end(); ) {
+				auto next = std::next(it);
+				if (!this->write(&it->second)) this->drop(it);
+				it = next;
+			}
+		}
+
+		ThreadPool &pool_;
+		int listener_;
+		std::string path_;
+		std::map<u64, Client> clients_;
+		u64 next_client_;
+		std::vector<Request> requests_;
+	};
+}
+
+int main(int argc, char **argv) {
+	std::string default_path = getDefaultDaemonSocket();
+	const char *path = default_path.c_str();
+	size_t threads = 0, cache_size = 64 << 20;
+	for (int i = 1; i < argc; ++i) {
+		const char *arg = argv[i];
+		if (!strcmp(arg, "-s") && i + 1 < argc) {
+			path = argv[++i];
+		} else if (!strcmp(arg, "-j") && i + 1 < argc) {
+			threads = strtoul(argv[++i], nullptr, 10);
+		} else if (!strcmp(arg, "-c") && i + 1 < argc) {
+			cache_size = (size_t)strtoul(argv[++i], nullptr, 10) << 20;
+		} else if (!strcmp(arg, "-h") || !strcmp(arg, "--help")) {
+			fputs(usage, stdout);
+			return 0;
+		} else {
+			fprintf(stderr, "visx-daemon: invalid option '%s'\n%s", arg, usage);
+			return 2;
+		}
+	}
+	// A client which leaves while its response is written must not stop the daemon.
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, stop);
+	signal(SIGTERM, stop);
+	ThreadPool pool(threads);
+	ResultCache::global().setBudget(cache_size);
+	Server server(pool);
+	if (!server.listen(path)) return 1;
+	server.run();
+	return 0;
+}
@@ -25,8 +25,10 @@ Application *Application::application = nullptr;
 #ifndef __APPLE__
 wxMenu *MainFrame::menu_file = nullptr;
 #endif
+wxMenu *MainFrame::menu_table = nullptr;
 wxMenu *MainFrame::menu_help = nullptr;
 wxMenuBar *MainFrame::menubar = nullptr;
+TablePanel *MainFrame::table_panel = nullptr;
 
 wxIMPLEMENT_APP(jp::visx::gui::Application);
 wxDECLARE_APP(jp::visx::gui::Application);
@@ -42,6 +44,12 @@ bool Application::OnInit(void) {
 MainFrame::MainFrame(void) : wxFrame(NULL, wxID_ANY, "VisX") {
 	wxMenu *menu_help = MainFrame::menu_help = new wxMenu();
 
+	wxMenu *menu_table = MainFrame::menu_table = new wxMenu();
+	menu_table->Append(ID_OPEN_TABLE, "&Open...\tCtrl+O", "Opens a table file.");
+	menu_table->AppendSeparator();
+	menu_table->Append(ID_ADD_ROW, "&Add row\tCtrl+Ins", "Adds a row after the selected row.");
+	menu_table->Append(ID_REMOVE_ROW, "&Remove row\tCtrl+Del", "Removes the selected row.");
+
 #ifndef __APPLE__
 	wxMenu *menu_file = MainFrame::menu_file = new wxMenu();
 	menu_file->Append(wxID_EXIT, "E&xit.\tAlt+F4", "Exits the program.");
@@ -56,10 +64,14 @@ MainFrame::MainFrame(void) : wxFrame(NULL, wxID_ANY, "VisX") {
 	menubar->Append(menu_file, "&File");
 #endif
 
+	menubar->Append(menu_table, "&Table");
 	menubar->Append(menu_help, "&Help");
 
 	SetMenuBar(menubar);
 
+	// The table fills the frame (see onSizeChange).
+	table_panel = new TablePanel(this);
+
 	this->SetClientSize(800, 600);
 }
 
@@ -70,6 +82,9 @@ BEGIN_EVENT_TABLE(MainFrame, wxFrame)
 	EVT_MENU(wxID_ABOUT, MainFrame::onAbout)
 	EVT_MENU(wxID_EXIT, MainFrame::onExit)
 #endif
+	EVT_MENU(ID_OPEN_TABLE, MainFrame::onOpenTable)
+	EVT_MENU(ID_ADD_ROW, MainFrame::onAddRow)
+	EVT_MENU(ID_REMOVE_ROW, MainFrame::onRemoveRow)
 	EVT_SIZE(MainFrame::onSizeChange)
 END_EVENT_TABLE()
 
@@ -81,6 +96,24 @@ void MainFrame::onAbout(wxCommandEvent &event) {
 	wxMessageBox(JP_VISX_GUI_ABOUTSTR, "About VisX", wxOK | wxICON_INFORMATION);
 }
 
+void MainFrame::onOpenTable(wxCommandEvent &event) {
+	wxFileDialog dialog(this, "Open table", wxEmptyString, wxEmptyString, wxFileSelectorDefaultWildcardStr, wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+	if (dialog.ShowModal() != wxID_OK) return;
+	if (!table_panel->openTable(dialog.GetPath())) {
+		wxMessageBox("The file could not be read.", "Open table", wxOK | wxICON_ERROR);
+	}
+}
+
+void MainFrame::onAddRow(wxCommandEvent &event) {
+	table_panel->addRow();
+}
+
+void MainFrame::onRemoveRow(wxCommandEvent &event) {
+	table_panel->removeRow();
+}
+
 void MainFrame::onSizeChange(wxSizeEvent &event) {
+	// The table fills the frame. The frame is resized once before it exists.
+	if (table_panel) table_panel->SetSize(this->GetClientSize());
 }
 
@@ -0,0 +1,99 @@
+/* src/gui/plotpanel.cpp
+ *
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <jp/visx/gui/plotpanel.hpp>
+#include <wx/dcbuffer.h>
+#include <math.h>
+
+using namespace jp::visx;
+using namespace jp::visx::gui;
+
+namespace {
+	// The space around the plot, in pixels.
+	const int plot_margin = 8;
+}
+
+PlotPanel::PlotPanel(wxWindow *parent, uasf::UncertaintyTable *table) : wxPanel(parent, wxID_ANY), table_(table), decimation_(table), observer_(0) {
+	// Every pixel is drawn by onPaint.
+	this->SetBackgroundStyle(wxBG_STYLE_PAINT);
+	this->SetMinSize(wxSize(-1, 160));
+	observer_ = table_->subscribe([this](const uasf::UncertaintyTable &, const uasf::UncertaintyTableChange &change) {
+		// The result of the row before the change is the cumulative of its first
+		// row, which also changed.
+		decimation_.update(change.first_row ? change.first_row - 1 : 0);
+		this->Refresh(false);
+	});
+}
+
+PlotPanel::~PlotPanel(void) {
+	table_->unsubscribe(observer_);
+}
+
+BEGIN_EVENT_TABLE(PlotPanel, wxPanel)
+	EVT_PAINT(PlotPanel::onPaint)
+	EVT_SIZE(PlotPanel::onSizeChange)
+END_EVENT_TABLE()
+
+void PlotPanel::onPaint(wxPaintEvent &event) {
+	wxAutoBufferedPaintDC dc(this);
+	dc.SetBackground(*wxWHITE_BRUSH);
+	dc.Clear();
+	wxSize size = this->GetClientSize();
+	int width = size.GetWidth() - 2 * plot_margin, height = size.GetHeight() - 2 * plot_margin;
+	size_t rows = decimation_.count();
+	if (width <= 0 || height <= 0 || !rows) return;
+	// There is at most one column per row.
+	size_t count = (size_t)width < rows ? (size_t)width : rows;
+	columns_.resize(count);
+	decimation_.decimate(0, rows, count, columns_.data());
+	uasf::ResultExtent total;
+	decimation_.getExtent(0, rows, &total);
+	double low = total.band_low, high = total.band_high;
+	if (!isfinite(low) || !isfinite(high)) return;
+	// A flat plot is drawn in the middle.
+	if (high - low <= 0.0) {
+		low -= 1.0;
+		high += 1.0;
+	}
+	double scale = height / (high - low);
+	auto y = [&](double value) {
+		return plot_margin + (int)((high - value) * scale);
+	};
+	dc.SetPen(*wxTRANSPARENT_PEN);
+	wxBrush band_brush(wxColour(176, 196, 232)), value_brush(wxColour(32, 64, 160));
+	for (size_t i = 0; i < count; ++i) {
+		const uasf::ResultExtent &column = columns_[i];
+		if (isnan(column.low)) continue;
+		// A column covers the pixels of its rows, or one pixel if there are more
+		// rows than pixels.
+		int x = plot_margin + (int)((u64)width * i / count),
+			column_width = plot_margin + (int)((u64)width * (i + 1) / count) - x;
+		int band_top = y(column.band_high), value_top = y(column.high);
+		dc.SetBrush(band_brush);
+		dc.DrawRectangle(x, band_top, column_width, y(column.band_low) - band_top + 1);
+		dc.SetBrush(value_brush);
+		dc.DrawRectangle(x, value_top, column_width, y(column.low) - value_top + 1);
+	}
+}
+
+void PlotPanel::onSizeChange(wxSizeEvent &event) {
+	// The columns depend on the width, so everything is drawn again.
+	this->Refresh(false);
+	event.Skip();
+}
@@ -0,0 +1,244 @@
+/* src/gui/tablepanel.cpp
+ *
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <jp/visx/gui/tablepanel.hpp>
+#include <wx/stopwatch.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace jp::visx;
+using namespace jp::visx::gui;
+
+namespace {
+	const char *column_labels[TableGridModel::COLUMN_COUNT] = {"Operation", "Value", "Uncertainty", "Result"};
+
+	// This function returns the last row in the window of the grid, or the number
+	// of rows if the window reaches past them.
+	long lastVisibleRow(wxGrid *grid) {
+		int x, y;
+		grid->CalcUnscrolledPosition(0, grid->GetGridWindow()->GetClientSize().GetHeight(), &x, &y);
+		int row = grid->YToRow(y);
+		return row == wxNOT_FOUND ? grid->GetNumberRows() : row;
+	}
+}
+
+TableGridModel::TableGridModel(uasf::UncertaintyTable *table) : table_(table) {}
+
+int TableGridModel::GetNumberRows(void) {
+	// A wxGrid counts its rows with an int.
+	size_t count = table_->count();
+	return count < INT_MAX ? (int)count : INT_MAX;
+}
+
+int TableGridModel::GetNumberCols(void) {
+	return COLUMN_COUNT;
+}
+
+bool TableGridModel::IsEmptyCell(int row, int col) {
+	return row < 0 || (size_t)row >= table_->count();
+}
+
+wxString TableGridModel::GetValue(int row, int col) {
+	if (this->IsEmptyCell(row, col)) return wxEmptyString;
+	size_t r = (size_t)row;
+	char buffer[64];
+	switch (col) {
+	case COLUMN_OPERATION:
+		return uasf::getOperationName(table_->getType(r));
+	case COLUMN_VALUE:
+		snprintf(buffer, sizeof(buffer), "%.15g", table_->getValue(r));
+		return buffer;
+	case COLUMN_UNCERTAINTY:
+		snprintf(buffer, sizeof(buffer), "%.15g", table_->getUncertainty(r));
+		return buffer;
+	case COLUMN_RESULT: {
+		// The result of a row is the cumulative of the next row (or the result of
+		// the table for the last row), which is only known once the row is
+		// computed.
+		if (r >= table_->getPendingRow()) return "...";
+		uasf::UncertaintyPair result;
+		if (r + 1 < table_->count()) {
+			table_->getElement(r + 1).getCumulative(&result);
+		} else {
+			table_->getResult(&result);
+		}
+		uasf::formatUncertainty(result.value, result.uncertainty, nullptr, buffer, sizeof(buffer));
+		return buffer;
+	}
+	default:
+		return wxEmptyString;
+	}
+}
+
+void TableGridModel::SetValue(int row, int col, const wxString &value) {
+	if (this->IsEmptyCell(row, col)) return;
+	size_t r = (size_t)row;
+	wxScopedCharBuffer text = value.utf8_str();
+	if (col == COLUMN_OPERATION) {
+		// The starting row is always NUL.
+		if (!r) return;
+		uasf::UncertaintyTableElementType type = uasf::parseOperation(text.data(), text.length());
+		if (type == uasf::UOPERATION_INVALID) return;
+		table_->set(r, uasf::UncertaintyTableElement{type, table_->getValue(r), table_->getUncertainty(r)});
+		return;
+	}
+	char *end;
+	double number = strtod(text.data(), &end);
+	if (end == text.data()) return;
+	if (col == COLUMN_VALUE) {
+		table_->set(r, number);
+	} else if (col == COLUMN_UNCERTAINTY) {
+		table_->setUncertainty(r, number);
+	}
+}
+
+wxString TableGridModel::GetColLabelValue(int col) {
+	if (col < 0 || col >= COLUMN_COUNT) return wxEmptyString;
+	return column_labels[col];
+}
+
+wxString TableGridModel::GetRowLabelValue(int row) {
+	// The first row holds the starting value.
+	if (!row) return "Start";
+	return wxString::Format("%d", row);
+}
+
+TablePanel::TablePanel(wxWindow *parent) : wxPanel(parent, wxID_ANY), observer_(0) {
+	// The table is only computed when the program is idle (see onIdle).
+	table_.beginBatch();
+	model_ = new TableGridModel(&table_);
+	grid_ = new wxGrid(this, wxID_ANY);
+	// The grid owns the model.
+	grid_->SetTable(model_, true);
+	// Rows of different heights would make the grid keep the height of every row.
+	grid_->DisableDragRowSize();
+	grid_->SetRowLabelSize(96);
+	// The operation is chosen from a list.
+	wxArrayString operations;
+	for (int type = uasf::UOPERATION_NUL; type < uasf::UOPERATION_INVALID; ++type) {
+		operations.Add(uasf::getOperationName((uasf::UncertaintyTableElementType)type));
+	}
+	wxGridCellAttr *attr = new wxGridCellAttr();
+	attr->SetEditor(new wxGridCellChoiceEditor(operations));
+	grid_->SetColAttr(TableGridModel::COLUMN_OPERATION, attr);
+	attr = new wxGridCellAttr();
+	attr->SetReadOnly();
+	grid_->SetColAttr(TableGridModel::COLUMN_RESULT, attr);
+	plot_ = new PlotPanel(this, &table_);
+	status_ = new wxStaticText(this, wxID_ANY, wxEmptyString);
+	wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
+	sizer->Add(grid_, 3, wxEXPAND);
+	sizer->Add(plot_, 2, wxEXPAND);
+	sizer->Add(status_, 0, wxEXPAND | wxALL, 4);
+	this->SetSizer(sizer);
+	observer_ = table_.subscribe([this](const uasf::UncertaintyTable &, const uasf::UncertaintyTableChange &change) {
+		// Only the visible rows are drawn again, and only if they changed.
+		if ((long)change.first_row <= lastVisibleRow(grid_)) grid_->ForceRefresh();
+		this->updateStatus();
+	});
+	this->updateStatus();
+}
+
+TablePanel::~TablePanel(void) {
+	table_.unsubscribe(observer_);
+	// The grid reads the table, so it is destroyed before it.
+	this->DestroyChildren();
+}
+
+void TablePanel::addRow(void) {
+	int cursor = grid_->GetGridCursorRow();
+	size_t row = cursor < 0 ? table_.count() : (size_t)cursor + 1;
+	if (row > table_.count()) row = table_.count();
+	table_.addAt(row, uasf::UOPERATION_ADD, 0.0, 0.0);
+	this->notifyRows(row, 1);
+	this->updateStatus();
+}
+
+void TablePanel::removeRow(void) {
+	int cursor = grid_->GetGridCursorRow();
+	// The starting row can not be removed.
+	if (cursor <= 0 || (size_t)cursor >= table_.count()) return;
+	table_.remove((size_t)cursor);
+	this->notifyRows((size_t)cursor, -1);
+	this->updateStatus();
+}
+
+bool TablePanel::openTable(const wxString &path) {
+	int old_rows = grid_->GetNumberRows();
+	if (!uasf::loadTable(path.utf8_str(), &table_)) return false;
+	// The grid is told that every row was replaced.
+	this->notifyRows(0, -(long)old_rows);
+	this->notifyRows(0, (long)model_->GetNumberRows());
+	grid_->GoToCell(0, 0);
+	this->updateStatus();
+	return true;
+}
+
+uasf::UncertaintyTable &TablePanel::getTable(void) {
+	return table_;
+}
+
+BEGIN_EVENT_TABLE(TablePanel, wxPanel)
+	EVT_IDLE(TablePanel::onIdle)
+END_EVENT_TABLE()
+
+void TablePanel::onIdle(wxIdleEvent &event) {
+	size_t pending = table_.getPendingRow();
+	if (pending == SIZE_MAX) return;
+	// Compute slices until the time of the event is used up, so the events of
+	// the user are not held back.
+	wxStopWatch watch;
+	bool done;
+	while (!(done = table_.computePending(idle_slice_rows)) && watch.Time() < idle_budget_ms);
+	if (done) {
+		// Every row is computed. Ending the batch reports the change to the
+		// observer, which draws the grid again.
+		table_.endBatch();
+		table_.beginBatch();
+	} else {
+		// The rows which were just computed may be visible.
+		if ((long)pending <= lastVisibleRow(grid_)) grid_->ForceRefresh();
+		this->updateStatus();
+		event.RequestMore();
+	}
+}
+
+void TablePanel::updateStatus(void) {
+	char buffer[128];
+	size_t pending = table_.getPendingRow(), count = table_.count();
+	if (pending != SIZE_MAX) {
+		snprintf(buffer, sizeof(buffer), "Computing... (%zu of %zu rows)", pending, count);
+	} else {
+		char result[64];
+		uasf::formatUncertainty(table_.getResult(), table_.getResultingUncertainty(), nullptr, result, sizeof(result));
+		snprintf(buffer, sizeof(buffer), "%zu rows. Result: %s", count, result);
+	}
+	status_->SetLabel(buffer);
+}
+
+void TablePanel::notifyRows(size_t row, long count) {
+	if (count > 0) {
+		wxGridTableMessage message(model_, wxGRIDTABLE_NOTIFY_ROWS_INSERTED, (int)row, (int)count);
+		grid_->ProcessTableMessage(message);
+	} else if (count < 0) {
+		wxGridTableMessage message(model_, wxGRIDTABLE_NOTIFY_ROWS_DELETED, (int)row, (int)-count);
+		grid_->ProcessTableMessage(message);
+	}
+}
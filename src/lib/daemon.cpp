@@ -0,0 +1,223 @@
+/* src/lib/daemon.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx/daemon.hpp>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <utility>
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+const char *const jp::visx::daemon_default_socket = "/tmp/visx-daemon.sock";
+
+std::string jp::visx::getDefaultDaemonSocket(void) {
+	const char *directory = getenv("XDG_RUNTIME_DIR");
+	if (!directory || !*directory) return daemon_default_socket;
+	return std::string(directory) + "/visx-daemon.sock";
+}
+
+namespace {
+	template <typename T>
+	void put(std::vector<char> *dest, T value) {
+		const char *bytes = (const char *)&value;
+		dest->insert(dest->end(), bytes, bytes + sizeof(T));
+	}
+
+	template <typename T>
+	T get(const char *src) {
+		T value;
+		memcpy(&value, src, sizeof(T));
+		return value;
+	}
+
+	// A daemon which has stopped must not raise SIGPIPE in the process of the
+	// client. On the systems without MSG_NOSIGNAL, the socket has SO_NOSIGPIPE.
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+	bool writeAll(int fd, const char *data, size_t size) {
+		while (size) {
+			ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+			if (n < 0) {
+				if (errno == EINTR) continue;
+				return false;
+			}
+			data += n;
+			size -= n;
+		}
+		return true;
+	}
+
+	bool readAll(int fd, char *data, size_t size) {
+		while (size) {
+			ssize_t n = ::read(fd, data, size);
+			if (n <= 0) {
+				if (n < 0 && errno == EINTR) continue;
+				return false;
+			}
+			data += n;
+			size -= n;
+		}
+		return true;
+	}
+}
+
+DaemonClient::DaemonClient(void) : fd_(-1), next_id_(0) {}
+
+DaemonClient::DaemonClient(DaemonClient &&other) : DaemonClient() {
+	*this = std::move(other);
+}
+
+DaemonClient &DaemonClient::operator=(DaemonClient &&other) {
+	if (this != &other) {
+		this->close();
+		std::swap(fd_, other.fd_);
+		next_id_ = other.next_id_;
+	}
+	return *this;
+}
+
+DaemonClient::~DaemonClient(void) {
+	this->close();
+}
+
+bool DaemonClient::connect(const char *path) {
+	this->close();
+	std::string default_path;
+	if (!path) {
+		default_path = getDefaultDaemonSocket();
+		path = default_path.c_str();
+	}
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) return false;
+	strcpy(address.sun_path, path);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) return false;
+#ifdef SO_NOSIGPIPE
+	int one = 1;
+	setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+	if (::connect(fd, (const sockaddr *)&address, sizeof(address))) {
+		::close(fd);
+		return false;
+	}
+	fd_ = fd;
+	return true;
+}
+
+void DaemonClient::close(void) {
+	if (fd_ < 0) return;
+	::close(fd_);
+	fd_ = -1;
+}
+
+bool DaemonClient::isConnected(void) const {
+	return fd_ >= 0;
+}
+
+bool DaemonClient::evaluate(const UncertaintyTable &table, UncertaintyPair *result_dest, std::vector<UncertaintyPair> *rows_dest) {
+	// The first row of the table is its NUL row, which starts the chain on the
+	// daemon at the starting value.
+	size_t count = table.count();
+	std::vector<UncertaintyTableElementType> types(count);
+	std::vector<double> values(count), uncertainties(count);
+	for (size_t i = 0; i < count; ++i) {
+		types[i] = table.getType(i);
+		values[i] = table.getValue(i);
+		uncertainties[i] = table.getUncertainty(i);
+	}
+	return this->evaluate(types.data(), values.data(), uncertainties.data(), count, result_dest, rows_dest);
+}
+
+bool DaemonClient::evaluate(const UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count, UncertaintyPair *result_dest, std::vector<UncertaintyPair> *rows_dest) {
+	if (count && (!types || !values || !uncertainties)) return false;
+	// The header and count, then one byte and two doubles per row.
+	if (count > (DAEMON_MAX_FRAME - 16) / 17) return false;
+	request_.resize(10);
+	put<u32>(&request_, (u32)count);
+	for (size_t i = 0; i < count; ++i) {
+		put<i8>(&request_, (i8)types[i]);
+	}
+	const char *values_bytes = (const char *)values, *uncertainties_bytes = (const char *)uncertainties;
+	request_.insert(request_.end(), values_bytes, values_bytes + count * sizeof(double));
+	request_.insert(request_.end(), uncertainties_bytes, uncertainties_bytes + count * sizeof(double));
+	return this->exchange(DAEMON_TABLE, rows_dest ? DAEMON_ALL_ROWS : 0, result_dest, rows_dest);
+}
+
+bool DaemonClient::evaluateExpression(const char *expression, UncertaintyPair *result_dest) {
+	if (!expression) return false;
+	size_t length = strlen(expression);
+	if (length > DAEMON_MAX_FRAME - 16) return false;
+	request_.resize(10);
+	request_.insert(request_.end(), expression, expression + length);
+	return this->exchange(DAEMON_EXPRESSION, 0, result_dest, nullptr);
+}
+
+bool DaemonClient::exchange(u8 kind, u8 flags, UncertaintyPair *result_dest, std::vector<UncertaintyPair> *rows_dest) {
+	if (fd_ < 0) return false;
+	u32 id = next_id_++, size = (u32)(request_.size() - 4);
+	memcpy(request_.data(), &size, 4);
+	memcpy(request_.data() + 4, &id, 4);
+	request_[8] = (char)kind;
+	request_[9] = (char)flags;
+	char header[8];
+	if (!writeAll(fd_, request_.data(), request_.size()) || !readAll(fd_, header, sizeof(header))) {
+		this->close();
+		return false;
+	}
+	size = get<u32>(header);
+	// The response has at least the id, status, value and uncertainty.
+	if (size < 21 || size > DAEMON_MAX_FRAME || get<u32>(header + 4) != id) {
+		this->close();
+		return false;
+	}
+	response_.resize(size - 4);
+	if (!readAll(fd_, response_.data(), response_.size())) {
+		this->close();
+		return false;
+	}
+	if (response_[0] != DAEMON_OK) return false;
+	if (result_dest) {
+		result_dest->value = get<double>(response_.data() + 1);
+		result_dest->uncertainty = get<double>(response_.data() + 9);
+	}
+	if (rows_dest) {
+		rows_dest->clear();
+		if (response_.size() < 21) return false;
+		u32 count = get<u32>(response_.data() + 17);
+		if (response_.size() - 21 < (size_t)count * 16) return false;
+		rows_dest->resize(count);
+		for (u32 i = 0; i < count; ++i) {
+			(*rows_dest)[i].value = get<double>(response_.data() + 21 + 16 * i);
+			(*rows_dest)[i].uncertainty = get<double>(response_.data() + 29 + 16 * i);
+		}
+	}
+	return true;
+}
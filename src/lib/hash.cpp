@@ -0,0 +1,145 @@
+/* src/lib/hash.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx/hash.hpp>
+#include <string.h>
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx;
+
+// The constants and steps are those of the reference implementation of XXH64.
+namespace {
+	const u64 prime1 = 0x9E3779B185EBCA87ULL,
+			  prime2 = 0xC2B2AE3D27D4EB4FULL,
+			  prime3 = 0x165667B19E3779F9ULL,
+			  prime4 = 0x85EBCA77C2B2AE63ULL,
+			  prime5 = 0x27D4EB2F165667C5ULL;
+
+	inline u64 rotateLeft(u64 x, int bits) {
+		return (x << bits) | (x >> (64 - bits));
+	}
+
+	inline u64 read64(const u8 *p) {
+		u64 x;
+		memcpy(&x, p, 8);
+		return x;
+	}
+
+	inline u32 read32(const u8 *p) {
+		u32 x;
+		memcpy(&x, p, 4);
+		return x;
+	}
+
+	inline u64 accumulate(u64 accumulator, u64 input) {
+		accumulator += input * prime2;
+		accumulator = rotateLeft(accumulator, 31);
+		return accumulator * prime1;
+	}
+
+	inline u64 mergeRound(u64 hash, u64 accumulator) {
+		hash ^= accumulate(0, accumulator);
+		return hash * prime1 + prime4;
+	}
+
+	// Hash the last bytes (less than 32) and mix the bits of the hash.
+	u64 finish(u64 hash, const u8 *p, size_t size) {
+		for ( ; size >= 8; p += 8, size -= 8) {
+			hash ^= accumulate(0, read64(p));
+			hash = rotateLeft(hash, 27) * prime1 + prime4;
+		}
+		if (size >= 4) {
+			hash ^= (u64)read32(p) * prime1;
+			hash = rotateLeft(hash, 23) * prime2 + prime3;
+			p += 4;
+			size -= 4;
+		}
+		for ( ; size; ++p, --size) {
+			hash ^= *p * prime5;
+			hash = rotateLeft(hash, 11) * prime1;
+		}
+		hash ^= hash >> 33;
+		hash *= prime2;
+		hash ^= hash >> 29;
+		hash *= prime3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+}
+
+XxHash64::XxHash64(u64 seed) {
+	this->reset(seed);
+}
+
+void XxHash64::reset(u64 seed) {
+	accumulators_[0] = seed + prime1 + prime2;
+	accumulators_[1] = seed + prime2;
+	accumulators_[2] = seed;
+	accumulators_[3] = seed - prime1;
+	seed_ = seed;
+	total_size_ = 0;
+	buffer_size_ = 0;
+}
+
+void XxHash64::update(const void *data, size_t size) {
+	const u8 *p = (const u8 *)data;
+	total_size_ += size;
+	// Fill the buffer first.
+	if (buffer_size_) {
+		size_t n = 32 - buffer_size_ < size ? 32 - buffer_size_ : size;
+		memcpy(buffer_ + buffer_size_, p, n);
+		buffer_size_ += n;
+		p += n;
+		size -= n;
+		if (buffer_size_ < 32) return;
+		for (int i = 0; i < 4; ++i) {
+			accumulators_[i] = accumulate(accumulators_[i], read64(buffer_ + 8 * i));
+		}
+		buffer_size_ = 0;
+	}
+	for ( ; size >= 32; p += 32, size -= 32) {
+		for (int i = 0; i < 4; ++i) {
+			accumulators_[i] = accumulate(accumulators_[i], read64(p + 8 * i));
+		}
+	}
+	memcpy(buffer_, p, size);
+	buffer_size_ = size;
+}
+
+u64 XxHash64::digest(void) const {
+	u64 hash;
+	if (total_size_ >= 32) {
+		hash = rotateLeft(accumulators_[0], 1) + rotateLeft(accumulators_[1], 7) + rotateLeft(accumulators_[2], 12) + rotateLeft(accumulators_[3], 18);
+		for (int i = 0; i < 4; ++i) {
+			hash = mergeRound(hash, accumulators_[i]);
+		}
+	} else {
+		hash = seed_ + prime5;
+	}
+	hash += total_size_;
+	return finish(hash, buffer_, buffer_size_);
+}
+
+u64 jp::visx::xxHash64(const void *data, size_t size, u64 seed) {
+	XxHash64 hash(seed);
+	hash.update(data, size);
+	return hash.digest();
+}
@@ -0,0 +1,159 @@
+/* src/lib/mappedfile.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx/mappedfile.hpp>
+#include <utility>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx;
+
+MappedFile::MappedFile(void) : data_(nullptr), size_(0)
+#ifdef _WIN32
+	, file_handle_(nullptr), mapping_handle_(nullptr)
+#endif
+{}
+
+MappedFile::MappedFile(MappedFile &&other) : MappedFile() {
+	*this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) {
+	if (this != &other) {
+		this->close();
+		// Take the mapping from the other file and leave it closed.
+		std::swap(data_, other.data_);
+		std::swap(size_, other.size_);
+#ifdef _WIN32
+		std::swap(file_handle_, other.file_handle_);
+		std::swap(mapping_handle_, other.mapping_handle_);
+#endif
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile(void) {
+	this->close();
+}
+
+bool MappedFile::open(const char *path) {
+	this->close();
+	if (!path) return false;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || !size.QuadPart) {
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) {
+		CloseHandle(file);
+		return false;
+	}
+	void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	file_handle_ = file;
+	mapping_handle_ = mapping;
+	data_ = view;
+	size_ = (size_t)size.QuadPart;
+#else
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) || st.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+	void *view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	// The mapping stays valid after the descriptor is closed.
+	::close(fd);
+	if (view == MAP_FAILED) return false;
+	data_ = view;
+	size_ = (size_t)st.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::close(void) {
+	if (!data_) return;
+#ifdef _WIN32
+	UnmapViewOfFile(data_);
+	CloseHandle((HANDLE)mapping_handle_);
+	CloseHandle((HANDLE)file_handle_);
+	file_handle_ = mapping_handle_ = nullptr;
+#else
+	munmap(data_, size_);
+#endif
+	data_ = nullptr;
+	size_ = 0;
+}
+
+bool MappedFile::isOpen(void) const {
+	return data_ != nullptr;
+}
+
+const void *MappedFile::getData(void) const {
+	return data_;
+}
+
+size_t MappedFile::getSize(void) const {
+	return size_;
+}
+
+bool jp::visx::syncFile(const char *path) {
+	if (!path) return false;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	bool ok = FlushFileBuffers(file) != 0;
+	CloseHandle(file);
+#else
+	int fd = ::open(path, O_RDWR);
+	if (fd < 0) return false;
+	bool ok = !fsync(fd);
+	::close(fd);
+#endif
+	return ok;
+}
+
+bool jp::visx::replaceFile(const char *from, const char *to) {
+	if (!from || !to) return false;
+#ifdef _WIN32
+	return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return !rename(from, to);
+#endif
+}
@@ -0,0 +1,102 @@
+/* src/lib/memory.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <jp/visx/memory.hpp>
+#include <new>
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx;
+
+namespace {
+	// Operator new aligns its memory for every fundamental type, which is as
+	// much as the containers of the library need.
+	class NewDeleteResource : public MemoryResource {
+	public:
+		void *allocate(size_t size, size_t) override {
+			return ::operator new(size);
+		}
+		void deallocate(void *p, size_t, size_t) override {
+			::operator delete(p);
+		}
+	};
+}
+
+MemoryResource *jp::visx::getDefaultResource(void) {
+	static NewDeleteResource resource;
+	return &resource;
+}
+
+MonotonicArena::MonotonicArena(size_t block_size) : current_(0), used_(0), block_size_(block_size ? block_size : 1) {}
+
+MonotonicArena::~MonotonicArena(void) {
+	this->release();
+}
+
+void *MonotonicArena::allocate(size_t size, size_t alignment) {
+	if (current_ < blocks_.size()) {
+		Block &block = blocks_[current_];
+		uintptr_t start = (uintptr_t)block.data + used_;
+		start = (start + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		size_t offset = start - (uintptr_t)block.data;
+		if (offset + size <= block.size) {
+			used_ = offset + size;
+			return block.data + offset;
+		}
+		// The rest of the block is wasted.
+		++current_;
+	}
+	// The next block is used if it is large enough (after a reset). Otherwise, a
+	// new block is put before it.
+	size_t needed = size + alignment - 1;
+	if (current_ >= blocks_.size() || blocks_[current_].size < needed) {
+		size_t block_size = needed > block_size_ ? needed : block_size_;
+		blocks_.insert(blocks_.begin() + current_, Block{(u8 *)::operator new(block_size), block_size});
+	}
+	Block &block = blocks_[current_];
+	uintptr_t start = ((uintptr_t)block.data + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	used_ = start - (uintptr_t)block.data + size;
+	return (void *)start;
+}
+
+void MonotonicArena::deallocate(void *, size_t, size_t) {}
+
+void MonotonicArena::reset(void) {
+	current_ = 0;
+	used_ = 0;
+}
+
+void MonotonicArena::release(void) {
+	for (Block &block : blocks_) {
+		::operator delete(block.data);
+	}
+	blocks_.clear();
+	current_ = 0;
+	used_ = 0;
+}
+
+size_t MonotonicArena::getReservedBytes(void) const {
+	size_t bytes = 0;
+	for (const Block &block : blocks_) {
+		bytes += block.size;
+	}
+	return bytes;
+}
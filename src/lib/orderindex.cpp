@@ -0,0 +1,209 @@
+/* src/lib/orderindex.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <jp/visx/orderindex.hpp>
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx;
+
+OrderIndex::OrderIndex(void) : nodes_(1, Node{0, 0, 0, 0, 0, 0}), slots_(1, Slot{0, 0}), root_(0), random_(0x9E3779B9) {}
+
+size_t OrderIndex::count(void) const {
+	return nodes_[root_].size;
+}
+
+u64 OrderIndex::insert(size_t position) {
+	if (position > this->count()) position = this->count();
+	u32 node = this->newNode(), left, right;
+	this->split(root_, position, &left, &right);
+	root_ = this->merge(this->merge(left, node), right);
+	nodes_[root_].parent = 0;
+	u32 slot = nodes_[node].slot;
+	return (u64)slots_[slot].generation << 32 | slot;
+}
+
+void OrderIndex::erase(size_t position) {
+	if (position >= this->count()) return;
+	u32 left, middle, right;
+	this->split(root_, position, &left, &right);
+	this->split(right, 1, &middle, &right);
+	this->freeNode(middle);
+	root_ = this->merge(left, right);
+	nodes_[root_].parent = 0;
+}
+
+void OrderIndex::swap(size_t position1, size_t position2) {
+	size_t count = this->count();
+	if (position1 >= count || position2 >= count || position1 == position2) return;
+	// The nodes stay where they are, and trade their slots.
+	u32 node1 = this->nodeAt(position1),
+		node2 = this->nodeAt(position2),
+		slot1 = nodes_[node1].slot,
+		slot2 = nodes_[node2].slot;
+	nodes_[node1].slot = slot2;
+	nodes_[node2].slot = slot1;
+	slots_[slot1].node = node2;
+	slots_[slot2].node = node1;
+}
+
+void OrderIndex::reset(size_t count) {
+	// The handles of the old items must become invalid, so their slots are freed
+	// instead of dropped.
+	for (u32 slot = 1; slot < slots_.size(); ++slot) {
+		if (!slots_[slot].node) continue;
+		slots_[slot].node = 0;
+		++slots_[slot].generation;
+		free_slots_.push_back(slot);
+	}
+	nodes_.resize(1);
+	free_nodes_.clear();
+	nodes_.reserve(count + 1);
+	// The tree is built from left to right with a stack of its right spine. A
+	// node is taken off the spine by a node with a higher priority, which makes
+	// it its left child. Its subtree is then complete, so its size is updated.
+	std::vector<u32> spine;
+	for (size_t i = 0; i < count; ++i) {
+		u32 node = this->newNode(), last = 0;
+		while (!spine.empty() && nodes_[spine.back()].priority < nodes_[node].priority) {
+			last = spine.back();
+			spine.pop_back();
+			this->update(last);
+		}
+		nodes_[node].left = last;
+		if (!spine.empty()) nodes_[spine.back()].right = node;
+		spine.push_back(node);
+	}
+	// The bottom of the spine is the root.
+	root_ = spine.empty() ? 0 : spine.front();
+	while (!spine.empty()) {
+		this->update(spine.back());
+		spine.pop_back();
+	}
+}
+
+u64 OrderIndex::getHandle(size_t position) const {
+	if (position >= this->count()) return invalid_handle;
+	u32 slot = nodes_[this->nodeAt(position)].slot;
+	return (u64)slots_[slot].generation << 32 | slot;
+}
+
+size_t OrderIndex::find(u64 handle) const {
+	u32 slot = (u32)handle;
+	if (!slot || slot >= slots_.size() || slots_[slot].generation != (u32)(handle >> 32) || !slots_[slot].node) return SIZE_MAX;
+	// The position is the number of nodes before the node: the nodes of its left
+	// subtree, and of the left subtrees of the ancestors it is to the right of.
+	u32 node = slots_[slot].node;
+	size_t position = nodes_[nodes_[node].left].size;
+	for (u32 parent = nodes_[node].parent; parent; node = parent, parent = nodes_[node].parent) {
+		if (nodes_[parent].right == node) position += nodes_[nodes_[parent].left].size + 1;
+	}
+	return position;
+}
+
+u32 OrderIndex::newNode(void) {
+	u32 slot, node;
+	if (free_slots_.empty()) {
+		slot = (u32)slots_.size();
+		slots_.push_back(Slot{0, 0});
+	} else {
+		slot = free_slots_.back();
+		free_slots_.pop_back();
+	}
+	if (free_nodes_.empty()) {
+		node = (u32)nodes_.size();
+		nodes_.push_back(Node{});
+	} else {
+		node = free_nodes_.back();
+		free_nodes_.pop_back();
+	}
+	// The priorities come from a xorshift generator.
+	random_ ^= random_ << 13;
+	random_ ^= random_ >> 17;
+	random_ ^= random_ << 5;
+	nodes_[node] = Node{0, 0, 0, 1, random_, slot};
+	slots_[slot].node = node;
+	return node;
+}
+
+void OrderIndex::freeNode(u32 node) {
+	u32 slot = nodes_[node].slot;
+	slots_[slot].node = 0;
+	++slots_[slot].generation;
+	free_slots_.push_back(slot);
+	free_nodes_.push_back(node);
+}
+
+u32 OrderIndex::nodeAt(size_t position) const {
+	u32 node = root_;
+	for (;;) {
+		size_t left_size = nodes_[nodes_[node].left].size;
+		if (position < left_size) {
+			node = nodes_[node].left;
+		} else if (position == left_size) {
+			return node;
+		} else {
+			position -= left_size + 1;
+			node = nodes_[node].right;
+		}
+	}
+}
+
+void OrderIndex::update(u32 node) {
+	Node &n = nodes_[node];
+	n.size = 1 + nodes_[n.left].size + nodes_[n.right].size;
+	if (n.left) nodes_[n.left].parent = node;
+	if (n.right) nodes_[n.right].parent = node;
+}
+
+void OrderIndex::split(u32 tree, size_t count, u32 *left_dest, u32 *right_dest) {
+	if (!tree) {
+		*left_dest = *right_dest = 0;
+		return;
+	}
+	size_t left_size = nodes_[nodes_[tree].left].size;
+	if (left_size < count) {
+		u32 right;
+		this->split(nodes_[tree].right, count - left_size - 1, &nodes_[tree].right, &right);
+		this->update(tree);
+		*left_dest = tree;
+		*right_dest = right;
+	} else {
+		u32 left;
+		this->split(nodes_[tree].left, count, &left, &nodes_[tree].left);
+		this->update(tree);
+		*left_dest = left;
+		*right_dest = tree;
+	}
+}
+
+u32 OrderIndex::merge(u32 left, u32 right) {
+	if (!left) return right;
+	if (!right) return left;
+	if (nodes_[left].priority > nodes_[right].priority) {
+		nodes_[left].right = this->merge(nodes_[left].right, right);
+		this->update(left);
+		return left;
+	}
+	nodes_[right].left = this->merge(left, nodes_[right].left);
+	this->update(right);
+	return right;
+}
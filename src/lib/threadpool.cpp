@@ -0,0 +1,122 @@
+/* src/lib/threadpool.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx/threadpool.hpp>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx;
+
+ThreadPool::ThreadPool(size_t threads) : stopping_(false) {
+	if (!threads) threads = std::thread::hardware_concurrency();
+	// hardware_concurrency may not know the number of threads.
+	if (!threads) threads = 1;
+	threads_.reserve(threads);
+	for (size_t i = 0; i < threads; ++i) {
+		threads_.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+ThreadPool::~ThreadPool(void) {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	condition_.notify_all();
+	for (std::thread &thread : threads_) {
+		thread.join();
+	}
+}
+
+size_t ThreadPool::getThreadCount(void) const {
+	return threads_.size();
+}
+
+void ThreadPool::submit(std::function<void(void)> task) {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		tasks_.push_back(std::move(task));
+	}
+	condition_.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &fn) {
+	if (!count) return;
+	if (!grain) grain = 1;
+	size_t ranges = (count + grain - 1) / grain;
+	// If there is only one range, there is nothing to share.
+	if (ranges == 1) {
+		fn(0, count);
+		return;
+	}
+	// The state is shared with the helper tasks, which may only start after this
+	// call has returned (if every worker was busy).
+	struct State {
+		std::atomic<size_t> next, done;
+		std::mutex mutex;
+		std::condition_variable condition;
+	};
+	std::shared_ptr<State> state = std::make_shared<State>();
+	state->next = 0;
+	state->done = 0;
+	// Run ranges until there are none left. fn is only used while ranges remain,
+	// and the caller does not return before they are all done.
+	auto run = [state, ranges, count, grain, &fn](void) {
+		for (size_t range; (range = state->next++) < ranges; ) {
+			size_t begin = range * grain;
+			fn(begin, begin + grain < count ? begin + grain : count);
+			if (++state->done == ranges) {
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->condition.notify_all();
+			}
+		}
+	};
+	size_t helpers = ranges - 1 < threads_.size() ? ranges - 1 : threads_.size();
+	for (size_t i = 0; i < helpers; ++i) {
+		this->submit(run);
+	}
+	// The calling thread helps too, so a call from a worker can not deadlock.
+	run();
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->condition.wait(lock, [&state, ranges](void) { return state->done == ranges; });
+}
+
+ThreadPool &ThreadPool::global(void) {
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::work(void) {
+	for (;;) {
+		std::function<void(void)> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			condition_.wait(lock, [this](void) { return stopping_ || !tasks_.empty(); });
+			// Finish the queued tasks before stopping.
+			if (tasks_.empty()) return;
+			task = std::move(tasks_.front());
+			tasks_.pop_front();
+		}
+		task();
+	}
+}
@@ -17,9 +17,17 @@
  */
 
 #include <jp/visx.hpp>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <utility>
+#include <vector>
 #include <math.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 
 #ifndef __cplusplus
 #error Not compiled using C++!
@@ -27,6 +35,185 @@
 
 using namespace jp::visx::uasf;
 
+// The instrumentation (see getInstrumentationStats) is only compiled if
+// JP_VISX_INSTRUMENT is defined (CMake value VISX_INSTRUMENT). Otherwise, the
+// statements in INSTRUMENT are removed.
+#ifdef JP_VISX_INSTRUMENT
+#define INSTRUMENT(statement) statement
+#else
+#define INSTRUMENT(statement)
+#endif
+// This counts an allocation if the capacity of the rows changes before the end
+// of the block.
+#define INSTRUMENT_ALLOCATION(rows) INSTRUMENT(AllocationProbe<decltype(rows)> allocation_probe(rows))
+
+namespace {
+	/* The counters of the threads, and the counts of the threads which ended. It
+	 * is never destroyed, since threads may end after the static objects are
+	 * destroyed. The counters of the threads are not written when the counts are
+	 * reset, since their threads may be incrementing them, so the counts at the
+	 * reset are subtracted instead.
+	 */
+	template <size_t count>
+	struct CounterRegistry {
+		std::mutex mutex;
+		std::vector<const std::atomic<u64> *> threads;
+		// The counts of the threads which ended, and the counts when the counters
+		// were last reset.
+		u64 ended[count],
+			reset[count];
+
+		// The total counts of every thread, without the reset. The mutex must be
+		// locked.
+		void totals(u64 *totals_dest) const {
+			memcpy(totals_dest, ended, sizeof(ended));
+			for (const std::atomic<u64> *counters : threads) {
+				for (size_t i = 0; i < count; ++i) {
+					totals_dest[i] += counters[i].load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		void get(u64 *counts_dest) {
+			std::lock_guard<std::mutex> lock(mutex);
+			totals(counts_dest);
+			for (size_t i = 0; i < count; ++i) {
+				counts_dest[i] -= reset[i];
+			}
+		}
+
+		void resetCounts(void) {
+			std::lock_guard<std::mutex> lock(mutex);
+			totals(reset);
+		}
+	};
+
+	// The counters of a thread. They are only written by their thread, so they
+	// are not incremented atomically, and they start on their own cache line so
+	// that no other thread writes to it.
+	template <size_t count>
+	class ThreadCounters {
+	public:
+		ThreadCounters(CounterRegistry<count> &registry) : registry_(registry) {
+			for (std::atomic<u64> &word : words_) {
+				word = 0;
+			}
+			std::lock_guard<std::mutex> lock(registry_.mutex);
+			registry_.threads.push_back(words_);
+		}
+
+		~ThreadCounters(void) {
+			std::lock_guard<std::mutex> lock(registry_.mutex);
+			for (size_t i = 0; i < count; ++i) {
+				registry_.ended[i] += words_[i];
+			}
+			for (auto it = registry_.threads.begin(); it != registry_.threads.end(); ++it) {
+				if (*it != words_) continue;
+				registry_.threads.erase(it);
+				break;
+			}
+		}
+
+		void add(size_t counter, u64 n) {
+			std::atomic<u64> &word = words_[counter];
+			word.store(word.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+		}
+	private:
+		CounterRegistry<count> &registry_;
+		alignas(64) std::atomic<u64> words_[count];
+	};
+}
+
+#ifdef JP_VISX_INSTRUMENT
+namespace {
+	// The counters are the words of InstrumentationStats.
+	const size_t counter_count = sizeof(InstrumentationStats) / sizeof(u64),
+				 counter_computes = offsetof(InstrumentationStats, computes) / sizeof(u64),
+				 counter_computed_rows = offsetof(InstrumentationStats, computed_rows) / sizeof(u64),
+				 counter_simplifications = offsetof(InstrumentationStats, simplifications) / sizeof(u64),
+				 counter_nan_short_circuits = offsetof(InstrumentationStats, nan_short_circuits) / sizeof(u64),
+				 counter_allocations = offsetof(InstrumentationStats, allocations) / sizeof(u64),
+				 counter_rows_histogram = offsetof(InstrumentationStats, rows_histogram) / sizeof(u64),
+				 counter_time_histograms = offsetof(InstrumentationStats, time_histograms) / sizeof(u64);
+
+	CounterRegistry<counter_count> &instrumentationRegistry(void) {
+		static CounterRegistry<counter_count> *registry = new CounterRegistry<counter_count>{};
+		return *registry;
+	}
+
+	thread_local ThreadCounters<counter_count> thread_instrumentation(instrumentationRegistry());
+
+	void addCounter(size_t counter, u64 n) {
+		thread_instrumentation.add(counter, n);
+	}
+
+	// The bucket of a sample in the histograms.
+	size_t bucket(u64 sample) {
+		size_t i = 0;
+		while ((sample >>= 1) && i < instrumentation_buckets - 1) ++i;
+		return i;
+	}
+
+	void addComputedRows(size_t rows) {
+		addCounter(counter_computed_rows, rows);
+		addCounter(counter_rows_histogram + bucket(rows), 1);
+	}
+
+	// This object adds the time from its construction to its destruction to the
+	// histogram of the type of a row.
+	class RowTimer {
+	public:
+		RowTimer(UncertaintyTableElementType type) : start_(std::chrono::steady_clock::now()) {
+			// The types before NUL become large indices, so they are also counted as
+			// invalid.
+			size_t index = (size_t)((int)type + 1);
+			index_ = index < instrumentation_invalid_histogram ? index : instrumentation_invalid_histogram;
+		}
+		~RowTimer(void) {
+			u64 time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+			addCounter(counter_time_histograms + index_ * instrumentation_buckets + bucket(time), 1);
+		}
+	private:
+		std::chrono::steady_clock::time_point start_;
+		size_t index_;
+	};
+
+	template <typename Rows>
+	class AllocationProbe {
+	public:
+		AllocationProbe(const Rows &rows) : rows_(rows), capacity_(rows.capacity()) {}
+		~AllocationProbe(void) {
+			if (rows_.capacity() != capacity_) addCounter(counter_allocations, 1);
+		}
+	private:
+		const Rows &rows_;
+		size_t capacity_;
+	};
+}
+#endif
+
+bool jp::visx::uasf::isInstrumented(void) {
+#ifdef JP_VISX_INSTRUMENT
+	return true;
+#else
+	return false;
+#endif
+}
+
+void jp::visx::uasf::getInstrumentationStats(InstrumentationStats *stats_dest) {
+	if (!stats_dest) return;
+	memset(stats_dest, 0, sizeof(*stats_dest));
+#ifdef JP_VISX_INSTRUMENT
+	instrumentationRegistry().get((u64 *)stats_dest);
+#endif
+}
+
+void jp::visx::uasf::resetInstrumentationStats(void) {
+#ifdef JP_VISX_INSTRUMENT
+	instrumentationRegistry().resetCounts();
+#endif
+}
+
 // The invalid element has type UOPERATION_INVALID, and values NaN.
 const UncertaintyTableElement UncertaintyTableElement::invalid_element = UncertaintyTableElement{UOPERATION_INVALID, NAN, NAN, NAN, NAN};
 
@@ -46,6 +233,7 @@ void UncertaintyTableElement::compute(UncertaintyPair *result_dest) const {
 	if (!result_dest) {
 		return;
 	}
+	INSTRUMENT(RowTimer timer(type_));
 	double value_b, uncertainty_b;
 	simplifyUncertainty(value_, uncertainty_, &value_b, &uncertainty_b);
 	switch (type_) {
@@ -269,7 +457,9 @@ void UncertaintyTableElement::setNotType(const UncertaintyTableElement &value) {
 }
 
 UncertaintyTable::UncertaintyTable(size_t starting_capacity) : UncertaintyTable(starting_capacity, 0.0, 0.0) {}
-UncertaintyTable::UncertaintyTable(size_t starting_capacity, double value, double uncertainty) {
+UncertaintyTable::UncertaintyTable(size_t starting_capacity, double value, double uncertainty) : UncertaintyTable(starting_capacity, value, uncertainty, nullptr) {}
+UncertaintyTable::UncertaintyTable(size_t starting_capacity, double value, double uncertainty, jp::visx::MemoryResource *resource) : elements_(jp::visx::ResourceAllocator<UncertaintyTableElement>(resource)), batch_depth_(0), dirty_row_(SIZE_MAX), stale_row_(SIZE_MAX), compute_pool_(nullptr) {
+	INSTRUMENT_ALLOCATION(elements_);
 	// Reserve `starting_capacity` elements.
 	elements_.reserve(starting_capacity);
 	// Add the starting value to the table.
@@ -277,15 +467,100 @@ UncertaintyTable::UncertaintyTable(size_t starting_capacity, double value, doubl
 	this->compute(0);
 }
 
-// The second constructor calls the first constructor with default value `10`
-// as starting capacity.
-UncertaintyTable::UncertaintyTable(void) : UncertaintyTable(10) {}
+// The second constructor calls the first constructor with the inline rows as
+// starting capacity.
+UncertaintyTable::UncertaintyTable(void) : UncertaintyTable(inline_rows) {}
+
+// The observers, the snapshots and the batches stay with the table (see
+// Features). The rows which its batches did not compute yet are computed.
+UncertaintyTable::UncertaintyTable(const UncertaintyTable &table) : elements_(table.elements_), result_(table.result_), batch_depth_(0), dirty_row_(SIZE_MAX), stale_row_(table.stale_row_), compute_pool_(table.compute_pool_), features_(table.features_ ? new Features(*table.features_) : nullptr) {
+	if (table.dirty_row_ < elements_.size()) this->compute(table.dirty_row_, false);
+}
+
+// Other threads may be reading the snapshot of the table, so it is only taken
+// with an atomic operation.
+UncertaintyTable::UncertaintyTable(UncertaintyTable &&table) : elements_(std::move(table.elements_)), result_(table.result_), batch_depth_(table.batch_depth_), dirty_row_(table.dirty_row_), stale_row_(table.stale_row_), snapshot_(std::atomic_exchange(&table.snapshot_, std::shared_ptr<const UncertaintyTableSnapshot>())), compute_pool_(table.compute_pool_), features_(std::move(table.features_)) {
+	table.batch_depth_ = 0;
+	table.dirty_row_ = SIZE_MAX;
+	table.clear();
+}
+
+UncertaintyTable &UncertaintyTable::operator=(const UncertaintyTable &table) {
+	if (this != &table) this->take(UncertaintyTable(table));
+	return *this;
+}
+
+UncertaintyTable &UncertaintyTable::operator=(UncertaintyTable &&table) {
+	if (this == &table) return *this;
+	this->take(std::move(table));
+	table.dirty_row_ = SIZE_MAX;
+	table.clear();
+	return *this;
+}
+
+void UncertaintyTable::take(UncertaintyTable &&table) {
+	elements_ = std::move(table.elements_);
+	result_ = table.result_;
+	stale_row_ = table.stale_row_;
+	compute_pool_ = table.compute_pool_;
+	// The batches stay with this table. The rows which the batches of table did
+	// not compute yet are computed now, or when the batches of this table end.
+	size_t pending_row = table.dirty_row_ < elements_.size() ? table.dirty_row_ : elements_.size();
+	if (table.features_) {
+		Features &own = this->features(), &other = *table.features_;
+		own.handles = std::move(other.handles);
+		own.optimizing = other.optimizing;
+		own.plan = std::move(other.plan);
+		own.plan_rows = other.plan_rows;
+		own.plan_evaluated = other.plan_evaluated;
+		// The table is left without handles and plan.
+		other.handles = OrderIndex();
+		other.plan.clear();
+		other.plan_rows = 0;
+		other.plan_evaluated = 0;
+	} else if (features_) {
+		features_->handles = OrderIndex();
+		features_->optimizing = false;
+		features_->plan.clear();
+		features_->plan_rows = 0;
+		features_->plan_evaluated = 0;
+	}
+	// Every row changed, for the observers and the next snapshot, which is
+	// published by compute like after any other change.
+	if (features_) {
+		if (!features_->observers.empty()) features_->changed_row = 0;
+		features_->published_row = 0;
+	}
+	this->compute(pending_row, false);
+}
+
+UncertaintyTable::Features::Features(void) : publishing(false), publish_pending(false), version(0), published_row(SIZE_MAX), optimizing(false), plan_rows(0), plan_evaluated(0), next_observer(1), changed_row(SIZE_MAX), coalescing(false), notifying(false) {}
+
+UncertaintyTable::Features::Features(const Features &features) : publishing(false), publish_pending(false), version(0), published_row(SIZE_MAX), handles(features.handles), optimizing(features.optimizing), plan(features.plan), plan_rows(features.plan_rows), plan_evaluated(features.plan_evaluated), next_observer(1), changed_row(SIZE_MAX), coalescing(false), notifying(false) {}
+
+UncertaintyTable::Features &UncertaintyTable::features(void) {
+	if (!features_) features_.reset(new Features());
+	return *features_;
+}
+
+jp::visx::OrderIndex *UncertaintyTable::handles(void) {
+	return features_ && features_->handles.count() ? &features_->handles : nullptr;
+}
+
+jp::visx::MemoryResource *UncertaintyTable::getMemoryResource(void) const {
+	return elements_.get_allocator().getResource();
+}
 
 size_t UncertaintyTable::getCapacity(void) const {
 	// Return the capacity.
 	return elements_.capacity();
 }
 
+void UncertaintyTable::reserve(size_t capacity) {
+	INSTRUMENT_ALLOCATION(elements_);
+	elements_.reserve(capacity);
+}
+
 void UncertaintyTable::getValue(size_t row, UncertaintyPair *result_dest) const {
 	// If result_dest is invalid, return.
 	if (!result_dest) return;
@@ -315,56 +590,86 @@ double UncertaintyTable::getUncertainty(size_t row) const {
 const UncertaintyTableElement &UncertaintyTable::getElement(size_t row) const {
 	// If the row is invalid, return an invalid_element.
 	if (row >= elements_.size()) return UncertaintyTableElement::invalid_element;
+	// If the result came from the cache or the plan, compute the cumulatives now.
+	if (row > stale_row_) this->computeCumulatives();
 	// Otherwise, return the element.
 	return elements_[row];
 }
 
 void UncertaintyTable::add(UncertaintyTableElementType type, double value, double uncertainty) {
+	INSTRUMENT_ALLOCATION(elements_);
 	// Add the value to the table.
 	elements_.emplace_back(type, value, uncertainty);
+	if (OrderIndex *index = this->handles()) index->insert(elements_.size() - 1);
 	// Compute the table.
 	this->compute(elements_.size() - 2);
 }
 
 void UncertaintyTable::add(UncertaintyTableElementType type, const UncertaintyPair *value) {
+	INSTRUMENT_ALLOCATION(elements_);
 	// Add the value to the table.
 	elements_.emplace_back(type, value);
+	if (OrderIndex *index = this->handles()) index->insert(elements_.size() - 1);
 	// Compute the table.
 	this->compute(elements_.size() - 2);
 }
 
+void UncertaintyTable::addRows(const UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count) {
+	if (!count || !types || !values || !uncertainties) return;
+	INSTRUMENT_ALLOCATION(elements_);
+	size_t first_row = elements_.size();
+	// Grow by at least half, so that adding blocks of rows does not copy the
+	// table for every block.
+	if (first_row + count > elements_.capacity()) {
+		size_t capacity = elements_.capacity() + elements_.capacity() / 2;
+		elements_.reserve(capacity > first_row + count ? capacity : first_row + count);
+	}
+	for (size_t i = 0; i < count; ++i) {
+		elements_.emplace_back(types[i], values[i], uncertainties[i]);
+		if (OrderIndex *index = this->handles()) index->insert(first_row + i);
+	}
+	this->compute(first_row - 1);
+}
+
 void UncertaintyTable::remove(size_t row) {
 	// If the row is not zero and it is a valid row, remove the row from the table.
 	if (row < elements_.size() && row) {
 		elements_.erase(elements_.begin() + row);
+		if (OrderIndex *index = this->handles()) index->erase(row);
 		this->compute(row - 1);
 	}
 }
 
 void UncertaintyTable::addAt(size_t row, UncertaintyTableElementType type, double value, double uncertainty) {
+	INSTRUMENT_ALLOCATION(elements_);
 	// If the row is zero, return.
 	if (!row) return;
 	// Otherwise, if the row is a valid row, add a row at that position.
 	else if (row < elements_.size()) {
 		elements_.insert(elements_.begin() + row, UncertaintyTableElement{type, value, uncertainty});
+		if (OrderIndex *index = this->handles()) index->insert(row);
 		this->compute(row - 1);
 	// Otherwise, add a row to the end of the table.
 	} else {
 		elements_.push_back(UncertaintyTableElement{type, value, uncertainty});
+		if (OrderIndex *index = this->handles()) index->insert(elements_.size() - 1);
 		this->compute(elements_.size() - 2);
 	}
 }
 
 void UncertaintyTable::addAt(size_t row, UncertaintyTableElementType type, const UncertaintyPair *value) {
+	INSTRUMENT_ALLOCATION(elements_);
 	// If the row is zero, return.
 	if (!row) return;
 	// Otherwise, if the row is a valid row, add a row at that position.
 	else if (row < elements_.size()) {
 		elements_.insert(elements_.begin() + row, UncertaintyTableElement{type, value});
+		if (OrderIndex *index = this->handles()) index->insert(row);
 		this->compute(row - 1);
 	// Otherwise, add a row to the end of the table.
 	} else {
 		elements_.push_back(UncertaintyTableElement{type, value});
+		if (OrderIndex *index = this->handles()) index->insert(elements_.size() - 1);
 		this->compute(elements_.size() - 2);
 	}
 }
@@ -378,6 +683,8 @@ void UncertaintyTable::swap(size_t row1, size_t row2) {
 	elements_[row1] = elements_[row2];
 	// Copy the original value of the first row into the second row.
 	elements_[row2] = el;
+	// The handles follow the rows.
+	if (OrderIndex *index = this->handles()) index->swap(row1, row2);
 	// Compute the new resulting value. (Start from the lowest of the two rows).
 	this->compute(row1 < row2 ? row1 - 1 : row2 - 1);
 }
@@ -435,7 +742,33 @@ void UncertaintyTable::setStartingValue(double value) {
 }
 
 void UncertaintyTable::recompute(void) {
-	this->compute(0);
+	// The rows did not change, so the plan is kept.
+	this->compute(0, false);
+}
+
+void UncertaintyTable::assign(std::vector<UncertaintyTableElement> &&elements, bool cumulatives_valid) {
+	INSTRUMENT_ALLOCATION(elements_);
+	// An empty table still needs its starting row.
+	if (elements.empty()) {
+		this->clear();
+		return;
+	}
+	// The elements are moved one by one into the memory of the table.
+	elements_.assign(std::make_move_iterator(elements.begin()), std::make_move_iterator(elements.end()));
+	elements.clear();
+	stale_row_ = SIZE_MAX;
+	// Every row changed, even if only the last one is computed.
+	if (features_) {
+		if (!features_->observers.empty()) features_->changed_row = 0;
+		features_->published_row = 0;
+	}
+	// Every row is new, so the old handles become invalid.
+	if (OrderIndex *index = this->handles()) index->reset(elements_.size());
+	this->truncatePlan(0);
+	// The first row is always the starting value.
+	elements_.front().setType(UOPERATION_NUL);
+	// If the cumulatives are trusted, only the last row must be computed to get the result.
+	this->compute(cumulatives_valid ? elements_.size() - 1 : 0);
 }
 
 void UncertaintyTable::setStartingValue(const UncertaintyPair *value) {
@@ -467,6 +800,22 @@ void UncertaintyTable::getStartingValue(UncertaintyPair *value_dest) const {
 	this->elements_.front().getValue(value_dest);
 }
 
+u64 UncertaintyTable::getHandle(size_t row) {
+	if (row >= elements_.size()) return jp::visx::OrderIndex::invalid_handle;
+	// The handles are only kept from the first time one is asked for.
+	OrderIndex &handles = this->features().handles;
+	if (!handles.count()) handles.reset(elements_.size());
+	return handles.getHandle(row);
+}
+
+size_t UncertaintyTable::findRow(u64 handle) const {
+	return features_ ? features_->handles.find(handle) : SIZE_MAX;
+}
+
+void UncertaintyTable::releaseHandles(void) {
+	if (features_) features_->handles.reset(0);
+}
+
 size_t UncertaintyTable::count(void) const {
 	// Return the number of elements. (the starting value counts as an element.)
 	return elements_.size();
@@ -480,41 +829,51 @@ UncertaintyTableElementType UncertaintyTable::getType(size_t row) const {
 }
 
 void UncertaintyTable::add(const UncertaintyTableElement &element) {
+	INSTRUMENT_ALLOCATION(elements_);
 	// Add the element to the back of the table and recompute.
 	elements_.push_back(element);
+	if (OrderIndex *index = this->handles()) index->insert(elements_.size() - 1);
 	this->compute(elements_.size() - 2);
 }
 
 void UncertaintyTable::add(UncertaintyTableElement &&element) {
+	INSTRUMENT_ALLOCATION(elements_);
 	// Add the element to the back of the table and recompute.
 	elements_.push_back(element);
+	if (OrderIndex *index = this->handles()) index->insert(elements_.size() - 1);
 	this->compute(elements_.size() - 2);
 }
 
 void UncertaintyTable::addAt(size_t row, const UncertaintyTableElement &element) {
+	INSTRUMENT_ALLOCATION(elements_);
 	// If the row is zero, return.
 	if (!row) return;
 	// Otherwise, if the row is valid, add the element at that position and recompute.
 	if (row < elements_.size()) {
 		elements_.insert(elements_.begin() + row, element);
+		if (OrderIndex *index = this->handles()) index->insert(row);
 		this->compute(row - 1);
 	// Otherwise, add the element to the back of the table and recompute.
 	} else {
 		elements_.push_back(element);
+		if (OrderIndex *index = this->handles()) index->insert(elements_.size() - 1);
 		this->compute(elements_.size() - 2);
 	}
 }
 
 void UncertaintyTable::addAt(size_t row, UncertaintyTableElement &&element) {
+	INSTRUMENT_ALLOCATION(elements_);
 	// If the row is zero, return.
 	if (!row) return;
 	// Otherwise, if the row is valid, add the element at that position and recompute.
 	if (row < elements_.size()) {
 		elements_.insert(elements_.begin() + row, element);
+		if (OrderIndex *index = this->handles()) index->insert(row);
 		this->compute(row - 1);
 	// Otherwise, add the element to the back of the table and recompute.
 	} else {
 		elements_.push_back(element);
+		if (OrderIndex *index = this->handles()) index->insert(elements_.size() - 1);
 		this->compute(elements_.size() - 2);
 	}
 }
@@ -526,8 +885,8 @@ void UncertaintyTable::set(size_t row, UncertaintyTableElement &&element) {
 	elements_[row] = element;
 	// If the row is the first row, set the operation to NUL.
 	if (!row) elements_[row++].setType(UOPERATION_NUL);
-	// Compute.
-	this->compute(row);
+	// Compute from the row before, since the cumulatives of the row are not set.
+	this->compute(row - 1);
 }
 
 void UncertaintyTable::set(size_t row, const UncertaintyTableElement &element) {
@@ -540,21 +899,95 @@ void UncertaintyTable::set(size_t row, const UncertaintyTableElement &element) {
 	this->compute(row - 1);
 }
 
-void UncertaintyTable::compute(size_t starting_row) {
+void UncertaintyTable::compute(size_t starting_row, bool rows_changed) {
+	if (rows_changed) this->truncatePlan(starting_row);
+	if (features_) {
+		// The change is only remembered if someone is told about it.
+		if (!features_->observers.empty() && starting_row < features_->changed_row) features_->changed_row = starting_row;
+		if (starting_row < features_->published_row) features_->published_row = starting_row;
+	}
+	// If a batch is open, remember the row and compute when the batch ends.
+	if (batch_depth_) {
+		if (starting_row < dirty_row_) dirty_row_ = starting_row;
+		return;
+	}
+	INSTRUMENT(addCounter(counter_computes, 1));
+	// If the cumulatives were not computed, the rows from stale_row_ can not be
+	// trusted either.
+	if (starting_row > stale_row_) starting_row = stale_row_;
+	// The plan is always evaluated, since it computes its steps from the first
+	// changed one. The cumulatives of the rows are computed when they are read.
+	if (features_ && features_->optimizing) {
+		this->computePlan();
+		stale_row_ = starting_row;
+	// If the row is invalid, there is nothing to compute.
+	} else if (starting_row < count()) {
+		// If every row is computed, the result may already be in the cache. The
+		// cumulatives are then only computed if they are read (see getElement).
+		ResultCache &cache = ResultCache::global();
+		if (!starting_row && cache.isEnabled()) {
+			ResultKey key = ResultCache::hashTable(*this);
+			if (cache.find(key, &result_)) {
+				stale_row_ = 0;
+			} else {
+				this->computeRows(0);
+				cache.insert(key, result_);
+			}
+		} else {
+			this->computeRows(starting_row);
+		}
+	}
+	// The table is complete, so it may be published.
+	if (!features_) return;
+	if (features_->publishing || features_->publish_pending) this->publish();
+	if (features_->changed_row != SIZE_MAX && !features_->coalescing) this->flushChanges();
+}
+
+namespace {
+	// The number of rows of a chunk computed in parallel, and the number of rows
+	// from which the rows are computed in parallel.
+	const size_t parallel_chunk_rows = 1 << 14,
+				 parallel_minimum_rows = 4 * parallel_chunk_rows;
+
+	struct Chunk {
+		// The rows of the chunk.
+		size_t begin,
+			   end;
+		// The cumulative after the last row, and the row before which it became NaN
+		// (SIZE_MAX if it did not).
+		UncertaintyPair output;
+		size_t nan_row;
+	};
+
+	bool same(const UncertaintyPair &a, const UncertaintyPair &b) {
+		return a.value == b.value && a.uncertainty == b.uncertainty;
+	}
+}
+
+size_t UncertaintyTable::computeRows(size_t starting_row, size_t ending_row) const {
 	// Declare an UncertaintyPair which will contain the current cumulative.
 	UncertaintyPair current_cumulative;
-	// If the row is invalid, return.
-	if (starting_row >= count()) return;
+	// The rows before starting_row were computed, and the ones after it are now.
+	stale_row_ = SIZE_MAX;
+	if (ending_row > elements_.size()) ending_row = elements_.size();
+	// If there are enough rows, compute them in parallel.
+	if (compute_pool_ && ending_row == elements_.size() && starting_row + parallel_minimum_rows <= ending_row) {
+		this->computeRowsParallel(starting_row);
+		INSTRUMENT(addComputedRows(elements_.size() - starting_row));
+		return elements_.size();
+	}
 	// Otherwise, get the first element and the end of the array.
-	auto begin = elements_.begin() + starting_row, end = elements_.end();
+	auto begin = elements_.begin() + starting_row, end = elements_.end(), last = elements_.begin() + ending_row;
 	// If the first element is greater than or equal to the end, return.
-	if (begin >= end) return;
+	if (begin >= end) return elements_.size();
+	if (begin >= last) return starting_row;
 	// Compute the first element.
 	begin->compute(&current_cumulative);
 	for (begin = begin + 1; begin < end; ++begin) {
 		// If the UncertaintyPair contains an invalid value, set the remaining cumulatives,
 		// as well as the result, to NaN.
 		if (isnan(current_cumulative.uncertainty) || isnan(current_cumulative.value)) {
+			INSTRUMENT(addCounter(counter_nan_short_circuits, 1));
 			for ( ; begin < end; ++begin) {
 				begin->setNotType(UncertaintyTableElement::invalid_element);
 			}
@@ -562,11 +995,448 @@ void UncertaintyTable::compute(size_t starting_row) {
 		}
 		// Otherwise, set the cumulatives,
 		begin->setCumulative(&current_cumulative);
+		// If this is the row after the last one to compute, stop. Its cumulatives
+		// are set, so the computation can continue from it.
+		if (begin == last) {
+			INSTRUMENT(addComputedRows(ending_row - starting_row));
+			return ending_row;
+		}
 		// and compute.
 		begin->compute(&current_cumulative);
 	}
 	// Set the result.
 	result_ = current_cumulative;
+	INSTRUMENT(addComputedRows(elements_.size() - starting_row));
+	return elements_.size();
+}
+
+void UncertaintyTable::computeRowsParallel(size_t starting_row) const {
+	size_t count = elements_.size(), threads = compute_pool_->getThreadCount() + 1;
+	// Use a few chunks per thread, so that they are shared evenly.
+	size_t chunk_count = (count - starting_row) / parallel_chunk_rows;
+	if (chunk_count > 4 * threads) chunk_count = 4 * threads;
+	std::vector<Chunk> chunks(chunk_count);
+	for (size_t i = 0; i < chunk_count; ++i) {
+		chunks[i].begin = starting_row + (count - starting_row) * i / chunk_count;
+		chunks[i].end = starting_row + (count - starting_row) * (i + 1) / chunk_count;
+		chunks[i].nan_row = SIZE_MAX;
+	}
+	// Compute every chunk from the cumulatives stored in its first row. The rows
+	// are not set to NaN here, since the chunk may have started from the wrong
+	// cumulatives.
+	compute_pool_->parallelFor(chunk_count, 1, [this, &chunks](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			Chunk &chunk = chunks[i];
+			UncertaintyPair cumulative;
+			elements_[chunk.begin].compute(&cumulative);
+			for (size_t row = chunk.begin + 1; row < chunk.end; ++row) {
+				if (isnan(cumulative.uncertainty) || isnan(cumulative.value)) {
+					chunk.nan_row = row;
+					break;
+				}
+				elements_[row].setCumulative(&cumulative);
+				elements_[row].compute(&cumulative);
+			}
+			chunk.output = cumulative;
+		}
+	});
+	// Check the chunks in order. The first one started from the right cumulatives.
+	UncertaintyPair cumulative;
+	size_t nan_row = SIZE_MAX;
+	for (size_t i = 0; i < chunk_count && nan_row == SIZE_MAX; ++i) {
+		Chunk &chunk = chunks[i];
+		size_t row = chunk.begin;
+		if (i) {
+			// Like in computeRows, the rows after a NaN cumulative are set to NaN.
+			if (isnan(cumulative.uncertainty) || isnan(cumulative.value)) {
+				nan_row = row;
+				break;
+			}
+			// If the chunk started from the right cumulatives, it is done.
+			UncertaintyTableElement &first = elements_[row];
+			UncertaintyPair expected;
+			simplifyUncertainty(cumulative.value, fabs(cumulative.uncertainty), &expected.value, &expected.uncertainty);
+			if (!same(expected, UncertaintyPair{first.getCumulative(), first.getCumulativeUncertainty()})) {
+				// Otherwise, compute it again until the cumulatives match the ones it was
+				// computed with.
+				first.setCumulative(&cumulative);
+				first.compute(&cumulative);
+				for (++row; row < chunk.end; ++row) {
+					if (isnan(cumulative.uncertainty) || isnan(cumulative.value)) {
+						nan_row = row;
+						break;
+					}
+					UncertaintyTableElement &element = elements_[row];
+					simplifyUncertainty(cumulative.value, fabs(cumulative.uncertainty), &expected.value, &expected.uncertainty);
+					if (row < chunk.nan_row && same(expected, UncertaintyPair{element.getCumulative(), element.getCumulativeUncertainty()})) break;
+					element.setCumulative(&cumulative);
+					element.compute(&cumulative);
+				}
+				if (nan_row != SIZE_MAX) break;
+				// If every row was computed again, the output of the chunk changed.
+				if (row == chunk.end) {
+					chunk.output = cumulative;
+					chunk.nan_row = SIZE_MAX;
+				}
+			}
+		}
+		cumulative = chunk.output;
+		nan_row = chunk.nan_row;
+	}
+	if (nan_row != SIZE_MAX) {
+		INSTRUMENT(addCounter(counter_nan_short_circuits, 1));
+		for (size_t row = nan_row; row < count; ++row) {
+			elements_[row].setNotType(UncertaintyTableElement::invalid_element);
+		}
+	}
+	result_ = cumulative;
+}
+
+namespace {
+	// This function folds a row into a step of the plan. It returns false if the
+	// row can not be folded.
+	bool foldRow(UncertaintyTableElementType type, double value, double uncertainty, double *scale, double *offset, double *uncertainty_scale, double *uncertainty_offset) {
+		switch (type) {
+		case UOPERATION_ADD:
+			*offset += value;
+			*uncertainty_offset += uncertainty;
+			return true;
+		case UOPERATION_SUB:
+			*offset -= value;
+			*uncertainty_offset += uncertainty;
+			return true;
+		// The uncertainty of the value is ignored by MULC and DIVC.
+		case UOPERATION_MULC:
+			*scale *= value;
+			*offset *= value;
+			*uncertainty_scale *= fabs(value);
+			*uncertainty_offset *= fabs(value);
+			return true;
+		case UOPERATION_DIVC:
+			if (value == 0.0) return false;
+			*scale /= value;
+			*offset /= value;
+			*uncertainty_scale /= fabs(value);
+			*uncertainty_offset /= fabs(value);
+			return true;
+		// A MUL or DIV by an exact 1 does not change the cumulative.
+		case UOPERATION_MUL:
+		case UOPERATION_DIV:
+			return value == 1.0 && uncertainty == 0.0;
+		default:
+			return false;
+		}
+	}
+
+	bool foldable(UncertaintyTableElementType type) {
+		return type == UOPERATION_ADD || type == UOPERATION_SUB || type == UOPERATION_MULC || type == UOPERATION_DIVC || type == UOPERATION_MUL || type == UOPERATION_DIV;
+	}
+}
+
+void UncertaintyTable::computeCumulatives(void) const {
+	// The result of the plan may differ from the one of the rows.
+	UncertaintyPair result = result_;
+	this->computeRows(stale_row_);
+	if (features_ && features_->optimizing) result_ = result;
+}
+
+void UncertaintyTable::truncatePlan(size_t row) {
+	if (!features_) return;
+	std::vector<PlanStep> &plan = features_->plan;
+	while (!plan.empty() && plan.back().first_row + plan.back().row_count > row) {
+		plan.pop_back();
+	}
+	features_->plan_rows = plan.empty() ? 0 : plan.back().first_row + plan.back().row_count;
+	if (features_->plan_evaluated > plan.size()) features_->plan_evaluated = plan.size();
+}
+
+void UncertaintyTable::computePlan(void) {
+	// Build the steps of the rows which are not in the plan. The first row is the
+	// starting row, which is never folded.
+	std::vector<PlanStep> &plan = features_->plan;
+	size_t count = elements_.size();
+	for (size_t row = features_->plan_rows; row < count; ) {
+		PlanStep step{row, 0, false, 1.0, 0.0, 1.0, 0.0, UncertaintyPair{NAN, NAN}};
+		for ( ; row < count && row && foldable(elements_[row].getType()); ++row, ++step.row_count) {
+			const UncertaintyTableElement &element = elements_[row];
+			double value, uncertainty;
+			simplifyUncertainty(element.getValue(), element.getUncertainty(), &value, &uncertainty);
+			if (!foldRow(element.getType(), value, uncertainty, &step.scale, &step.offset, &step.uncertainty_scale, &step.uncertainty_offset)) break;
+		}
+		if (step.row_count) {
+			step.folded = true;
+		} else {
+			// The row is computed like in computeRows.
+			step.row_count = 1;
+			++row;
+		}
+		plan.push_back(step);
+	}
+	features_->plan_rows = count;
+	// Evaluate the steps from the last one which is up to date.
+	size_t i = features_->plan_evaluated ? features_->plan_evaluated - 1 : 0;
+	UncertaintyPair cumulative = plan[i].input;
+	for ( ; i < plan.size(); ++i) {
+		PlanStep &step = plan[i];
+		step.input = cumulative;
+		features_->plan_evaluated = i + 1;
+		// Like in computeRows, the result stays NaN once the cumulative is NaN.
+		if (i && (isnan(cumulative.uncertainty) || isnan(cumulative.value))) {
+			INSTRUMENT(addCounter(counter_nan_short_circuits, 1));
+			break;
+		}
+		if (step.folded) {
+			UncertaintyPair input;
+			simplifyUncertainty(cumulative.value, fabs(cumulative.uncertainty), &input.value, &input.uncertainty);
+			cumulative.value = input.value * step.scale + step.offset;
+			cumulative.uncertainty = fabs(input.uncertainty * step.uncertainty_scale + step.uncertainty_offset);
+			simplifyUncertainty(cumulative.value, cumulative.uncertainty, &cumulative.value, &cumulative.uncertainty);
+		} else {
+			UncertaintyTableElement element = elements_[step.first_row];
+			if (i) element.setCumulative(&cumulative);
+			element.compute(&cumulative);
+		}
+	}
+	INSTRUMENT(addComputedRows(count));
+	result_ = cumulative;
+}
+
+void UncertaintyTable::setOptimizing(bool optimizing) {
+	if (optimizing == this->isOptimizing()) return;
+	Features &features = this->features();
+	features.optimizing = optimizing;
+	features.plan.clear();
+	features.plan_rows = 0;
+	features.plan_evaluated = 0;
+	this->compute(0, false);
+}
+
+bool UncertaintyTable::isOptimizing(void) const {
+	return features_ && features_->optimizing;
+}
+
+size_t UncertaintyTable::getPlanStepCount(void) const {
+	return features_ ? features_->plan.size() : 0;
+}
+
+void UncertaintyTable::setComputePool(jp::visx::ThreadPool *pool) {
+	compute_pool_ = pool;
+}
+
+jp::visx::ThreadPool *UncertaintyTable::getComputePool(void) const {
+	return compute_pool_;
+}
+
+void UncertaintyTable::beginBatch(void) {
+	++batch_depth_;
+}
+
+void UncertaintyTable::endBatch(void) {
+	// If no batch is open, or this is not the outermost batch, return.
+	if (!batch_depth_ || --batch_depth_) return;
+	size_t row = dirty_row_;
+	dirty_row_ = SIZE_MAX;
+	this->compute(row);
+}
+
+bool UncertaintyTable::inBatch(void) const {
+	return batch_depth_ != 0;
+}
+
+size_t UncertaintyTable::getPendingRow(void) const {
+	// If the cumulatives came from the cache or the plan, the rows must be
+	// computed from the stale ones.
+	if (dirty_row_ != SIZE_MAX && stale_row_ < dirty_row_) return stale_row_;
+	return dirty_row_;
+}
+
+bool UncertaintyTable::computePending(size_t max_rows) {
+	size_t row = this->getPendingRow();
+	if (row >= elements_.size()) {
+		dirty_row_ = SIZE_MAX;
+		return true;
+	}
+	size_t next = this->computeRows(row, max_rows < elements_.size() - row ? row + max_rows : SIZE_MAX);
+	dirty_row_ = next < elements_.size() ? next : SIZE_MAX;
+	return dirty_row_ == SIZE_MAX;
+}
+
+void UncertaintyTable::publish(void) {
+	// The rows may be half computed while a batch is open.
+	Features &features = this->features();
+	if (batch_depth_) {
+		features.publish_pending = true;
+		return;
+	}
+	features.publish_pending = false;
+	// The snapshot has every cumulative, even if the result came from the cache.
+	if (stale_row_ != SIZE_MAX) this->computeCumulatives();
+	// The chunks whose rows are all before the first changed row did not change
+	// since the last snapshot, so they are shared with it.
+	typedef UncertaintyTableSnapshot::Chunk Chunk;
+	const size_t chunk_rows = UncertaintyTableSnapshot::chunk_rows;
+	std::shared_ptr<const UncertaintyTableSnapshot> last = std::atomic_load(&snapshot_);
+	size_t count = elements_.size(), shared = 0;
+	if (last) {
+		shared = features.published_row < count ? features.published_row : count;
+		if (shared > last->count_) shared = last->count_;
+		shared /= chunk_rows;
+	}
+	std::vector<std::shared_ptr<const Chunk>> chunks((count + chunk_rows - 1) / chunk_rows);
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		if (i < shared) {
+			chunks[i] = last->chunks_[i];
+		} else {
+			auto begin = elements_.begin() + i * chunk_rows, end = i + 1 < chunks.size() ? begin + chunk_rows : elements_.end();
+			chunks[i] = std::shared_ptr<const Chunk>(new Chunk(begin, end));
+		}
+	}
+	features.published_row = SIZE_MAX;
+	std::shared_ptr<const UncertaintyTableSnapshot> snapshot(new UncertaintyTableSnapshot(std::move(chunks), count, result_, ++features.version));
+	std::atomic_store(&snapshot_, snapshot);
+}
+
+void UncertaintyTable::setPublishing(bool publishing) {
+	if (publishing || features_) this->features().publishing = publishing;
+}
+
+bool UncertaintyTable::isPublishing(void) const {
+	return features_ && features_->publishing;
+}
+
+std::shared_ptr<const UncertaintyTableSnapshot> UncertaintyTable::getSnapshot(void) const {
+	return std::atomic_load(&snapshot_);
+}
+
+u64 UncertaintyTable::subscribe(ChangeCallback callback) {
+	Features &features = this->features();
+	u64 id = features.next_observer++;
+	features.observers.emplace_back(id, std::move(callback));
+	return id;
+}
+
+void UncertaintyTable::unsubscribe(u64 id) {
+	if (!features_) return;
+	std::vector<std::pair<u64, ChangeCallback>> &observers = features_->observers;
+	for (auto it = observers.begin(); it != observers.end(); ++it) {
+		if (it->first == id) {
+			observers.erase(it);
+			break;
+		}
+	}
+	if (observers.empty()) features_->changed_row = SIZE_MAX;
+}
+
+void UncertaintyTable::setCoalescing(bool coalescing) {
+	if (coalescing || features_) this->features().coalescing = coalescing;
+}
+
+bool UncertaintyTable::isCoalescing(void) const {
+	return features_ && features_->coalescing;
+}
+
+void UncertaintyTable::flushChanges(void) {
+	// The rows may be half computed while a batch is open, and a change made by
+	// a callback is reported when the callbacks return. The features are read
+	// through features_ every time, since a callback may assign the table.
+	if (!this->hasPendingChange() || batch_depth_ || features_->notifying) return;
+	features_->notifying = true;
+	do {
+		UncertaintyTableChange change;
+		// The table may have lost rows since the change.
+		change.first_row = features_->changed_row < elements_.size() ? features_->changed_row : elements_.size();
+		change.row_count = elements_.size() - change.first_row;
+		change.result = result_;
+		features_->changed_row = SIZE_MAX;
+		// The callbacks may change the observers, so they are called from a copy.
+		std::vector<std::pair<u64, ChangeCallback>> observers(features_->observers);
+		for (auto &observer : observers) {
+			observer.second(*this, change);
+		}
+	} while (features_->changed_row != SIZE_MAX && !features_->coalescing);
+	features_->notifying = false;
+}
+
+bool UncertaintyTable::hasPendingChange(void) const {
+	return features_ && features_->changed_row != SIZE_MAX;
+}
+
+UncertaintyTableSnapshot::UncertaintyTableSnapshot(std::vector<std::shared_ptr<const Chunk>> &&chunks, size_t count, const UncertaintyPair &result, u64 version) : chunks_(std::move(chunks)), count_(count), result_(result), version_(version) {}
+
+size_t UncertaintyTableSnapshot::count(void) const {
+	return count_;
+}
+
+UncertaintyTableElementType UncertaintyTableSnapshot::getType(size_t row) const {
+	return this->getElement(row).getType();
+}
+
+double UncertaintyTableSnapshot::getValue(size_t row) const {
+	return this->getElement(row).getValue();
+}
+
+double UncertaintyTableSnapshot::getUncertainty(size_t row) const {
+	return this->getElement(row).getUncertainty();
+}
+
+const UncertaintyTableElement &UncertaintyTableSnapshot::getElement(size_t row) const {
+	if (row >= count_) return UncertaintyTableElement::invalid_element;
+	return (*chunks_[row / chunk_rows])[row % chunk_rows];
+}
+
+double UncertaintyTableSnapshot::getStartingValue(void) const {
+	return chunks_.front()->front().getValue();
+}
+
+double UncertaintyTableSnapshot::getStartingUncertainty(void) const {
+	return chunks_.front()->front().getUncertainty();
+}
+
+double UncertaintyTableSnapshot::getResult(void) const {
+	return result_.value;
+}
+
+void UncertaintyTableSnapshot::getResult(UncertaintyPair *result_dest) const {
+	if (!result_dest) return;
+	*result_dest = result_;
+}
+
+double UncertaintyTableSnapshot::getResultingUncertainty(void) const {
+	return result_.uncertainty;
+}
+
+u64 UncertaintyTableSnapshot::getVersion(void) const {
+	return version_;
+}
+
+UncertaintyTableArena::UncertaintyTableArena(size_t block_size) : arena_(block_size) {}
+
+UncertaintyTableArena::~UncertaintyTableArena(void) {
+	this->reset();
+}
+
+UncertaintyTable *UncertaintyTableArena::create(size_t starting_capacity, double starting_value, double starting_uncertainty) {
+	void *p = arena_.allocate(sizeof(UncertaintyTable), alignof(UncertaintyTable));
+	UncertaintyTable *table = new (p) UncertaintyTable(starting_capacity, starting_value, starting_uncertainty, &arena_);
+	tables_.push_back(table);
+	return table;
+}
+
+void UncertaintyTableArena::reset(void) {
+	// The destructors give back the snapshots, which are not in the arena.
+	for (UncertaintyTable *table : tables_) {
+		table->~UncertaintyTable();
+	}
+	tables_.clear();
+	arena_.reset();
+}
+
+size_t UncertaintyTableArena::count(void) const {
+	return tables_.size();
+}
+
+jp::visx::MonotonicArena &UncertaintyTableArena::getArena(void) {
+	return arena_;
 }
 
 void UncertaintyTable::getResult(UncertaintyPair *result_dest) const {
@@ -591,10 +1461,195 @@ void UncertaintyTable::clear(void) {
 	// Clear the table and add a first element.
 	elements_.clear();
 	elements_.emplace_back(UOPERATION_NUL, 0.0, 0.0);
+	if (OrderIndex *index = this->handles()) index->reset(1);
 	this->compute(0);
 }
 
+UncertaintyChain::UncertaintyChain(double starting_value, double starting_uncertainty) {
+	// The starting value is computed like the NUL row of a table.
+	UncertaintyTableElement{UOPERATION_NUL, starting_value, starting_uncertainty}.compute(&cumulative_);
+}
+
+void UncertaintyChain::step(UncertaintyTableElementType type, double value, double uncertainty, UncertaintyPair *cumulative) {
+	// Once the cumulative is invalid, the remaining rows are not computed (see
+	// UncertaintyTable::compute).
+	if (isnan(cumulative->uncertainty) || isnan(cumulative->value)) return;
+	UncertaintyTableElement{type, value, uncertainty, cumulative->value, cumulative->uncertainty}.compute(cumulative);
+}
+
+void UncertaintyChain::add(UncertaintyTableElementType type, double value, double uncertainty) {
+	step(type, value, uncertainty, &cumulative_);
+}
+
+void UncertaintyChain::addRows(const UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count) {
+	if (!types || !values || !uncertainties) return;
+	for (size_t i = 0; i < count && !isnan(cumulative_.uncertainty) && !isnan(cumulative_.value); ++i) {
+		step(types[i], values[i], uncertainties[i], &cumulative_);
+	}
+}
+
+double UncertaintyChain::getResult(void) const {
+	return cumulative_.value;
+}
+
+void UncertaintyChain::getResult(UncertaintyPair *result_dest) const {
+	if (!result_dest) return;
+	*result_dest = cumulative_;
+}
+
+double UncertaintyChain::getResultingUncertainty(void) const {
+	return cumulative_.uncertainty;
+}
+
+namespace {
+	// The names of the operations, starting at UOPERATION_NUL.
+	const char *const operation_names[] = {"NUL", "ADD", "SUB", "SUBO", "MUL", "DIV", "DIVO", "POW", "POWO", "MULC", "MULCO", "DIVC", "DIVCO"};
+}
+
+UncertaintyTableElementType jp::visx::uasf::parseOperation(const char *s, size_t length) {
+	if (!s) return UOPERATION_INVALID;
+	for (size_t i = 0; i < NELS(operation_names); ++i) {
+		const char *name = operation_names[i];
+		size_t j = 0;
+		// Compare without case. The names only contain upper case letters.
+		for ( ; j < length && name[j] && (s[j] == name[j] || s[j] == name[j] - 'A' + 'a'); ++j);
+		if (j == length && !name[j]) return (UncertaintyTableElementType)(i + UOPERATION_NUL);
+	}
+	return UOPERATION_INVALID;
+}
+
+const char *jp::visx::uasf::getOperationName(UncertaintyTableElementType type) {
+	if (type < UOPERATION_NUL || type >= UOPERATION_INVALID) return "INVALID";
+	return operation_names[type - UOPERATION_NUL];
+}
+
+UncertaintyTableElementType jp::visx::uasf::getOperation(int type) {
+	if (type < UOPERATION_NUL || type >= UOPERATION_INVALID) return UOPERATION_INVALID;
+	return (UncertaintyTableElementType)type;
+}
+
+namespace {
+	// The number of results in the cache of every thread (a power of two).
+	const size_t simplify_cache_size = 1024;
+
+	std::atomic<bool> simplify_cache_enabled(true);
+
+	// The counters of the cache (see SimplifyCacheStats).
+	const size_t simplify_counter_count = 2,
+				 simplify_counter_hits = 0,
+				 simplify_counter_misses = 1;
+
+	CounterRegistry<simplify_counter_count> &simplifyRegistry(void) {
+		static CounterRegistry<simplify_counter_count> *registry = new CounterRegistry<simplify_counter_count>{};
+		return *registry;
+	}
+
+	/* The cache of a thread. It is direct-mapped: the bits of the value and the
+	 * uncertainty choose the only entry which may hold their result.
+	 */
+	class SimplifyCache {
+	public:
+		SimplifyCache(void) : entries_(new Entry[simplify_cache_size]), counters_(simplifyRegistry()) {
+			// The inputs are never NaN (see simplifyUncertainty), so no entry matches
+			// until it is set.
+			const u64 nan_bits = 0x7FF8000000000000ULL;
+			for (size_t i = 0; i < simplify_cache_size; ++i) {
+				entries_[i].value = entries_[i].uncertainty = nan_bits;
+			}
+		}
+
+		bool find(u64 value, u64 uncertainty, double *value_dest, double *uncertainty_dest) {
+			const Entry &entry = entries_[index(value, uncertainty)];
+			if (entry.value != value || entry.uncertainty != uncertainty) {
+				counters_.add(simplify_counter_misses, 1);
+				return false;
+			}
+			*value_dest = entry.result.value;
+			*uncertainty_dest = entry.result.uncertainty;
+			counters_.add(simplify_counter_hits, 1);
+			return true;
+		}
+
+		void insert(u64 value, u64 uncertainty, double result_value, double result_uncertainty) {
+			entries_[index(value, uncertainty)] = Entry{value, uncertainty, UncertaintyPair{result_value, result_uncertainty}};
+		}
+	private:
+		struct Entry {
+			u64 value,
+				uncertainty;
+			UncertaintyPair result;
+		};
+
+		static size_t index(u64 value, u64 uncertainty) {
+			// Mix the bits, so that values which only differ in their low bits use
+			// different entries.
+			u64 x = (value ^ (uncertainty * 0x9E3779B97F4A7C15ULL)) * 0xBF58476D1CE4E5B9ULL;
+			return (size_t)(x >> 54) & (simplify_cache_size - 1);
+		}
+
+		std::unique_ptr<Entry[]> entries_;
+		ThreadCounters<simplify_counter_count> counters_;
+	};
+
+	thread_local SimplifyCache simplify_cache;
+
+	/* A lookup in the cache of the thread. If the result is not found, it is
+	 * inserted when the lookup is destroyed, once simplifyUncertainty has put it
+	 * into the destinations. Values which are not finite and zero uncertainties
+	 * are quick to simplify, so they do not use the cache.
+	 */
+	class SimplifyLookup {
+	public:
+		SimplifyLookup(double value, double uncertainty, double *value_dest, double *uncertainty_dest) : cache_(nullptr), found_(false), value_dest_(value_dest), uncertainty_dest_(uncertainty_dest) {
+			if (isinf(value) || isnan(value) || isinf(uncertainty) || isnan(uncertainty) || uncertainty == 0.0 || !simplify_cache_enabled.load(std::memory_order_relaxed)) return;
+			memcpy(&value_, &value, 8);
+			memcpy(&uncertainty_, &uncertainty, 8);
+			SimplifyCache &cache = simplify_cache;
+			found_ = cache.find(value_, uncertainty_, value_dest, uncertainty_dest);
+			if (!found_) cache_ = &cache;
+		}
+
+		~SimplifyLookup(void) {
+			if (cache_) cache_->insert(value_, uncertainty_, *value_dest_, *uncertainty_dest_);
+		}
+
+		bool found(void) const {
+			return found_;
+		}
+	private:
+		SimplifyCache *cache_;
+		bool found_;
+		u64 value_,
+			uncertainty_;
+		double *value_dest_,
+			   *uncertainty_dest_;
+	};
+}
+
+void jp::visx::uasf::setSimplifyCacheEnabled(bool enabled) {
+	simplify_cache_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool jp::visx::uasf::isSimplifyCacheEnabled(void) {
+	return simplify_cache_enabled.load(std::memory_order_relaxed);
+}
+
+void jp::visx::uasf::getSimplifyCacheStats(SimplifyCacheStats *stats_dest) {
+	if (!stats_dest) return;
+	u64 counts[simplify_counter_count];
+	simplifyRegistry().get(counts);
+	stats_dest->hits = counts[simplify_counter_hits];
+	stats_dest->misses = counts[simplify_counter_misses];
+}
+
+void jp::visx::uasf::resetSimplifyCacheStats(void) {
+	simplifyRegistry().resetCounts();
+}
+
 void jp::visx::uasf::simplifyUncertainty(double value, double uncertainty, double *value_dest, double *uncertainty_dest) {
+	INSTRUMENT(addCounter(counter_simplifications, 1));
+	SimplifyLookup lookup(value, uncertainty, value_dest, uncertainty_dest);
+	if (lookup.found()) return;
 	// I don't know how this works. I copied it over from some old code.
 	// The comments I put on are what I think it does lol.
 
@@ -671,6 +1726,26 @@ void jp::visx::uasf::simplifyUncertainty(double value, double uncertainty, doubl
 	*uncertainty_dest = fabs(*uncertainty_dest);
 }
 
+size_t jp::visx::uasf::formatUncertainty(double value, double uncertainty, const char *separator, char *dest, size_t size) {
+	if (!separator) separator = " +/- ";
+	simplifyUncertainty(value, uncertainty, &value, &uncertainty);
+	int length;
+	if (isnan(value)) {
+		length = snprintf(dest, size, "nan");
+	// Without an uncertainty, every digit of the value is significant.
+	} else if (uncertainty == 0.0) {
+		length = snprintf(dest, size, "%." JP_STRMACRO(DBL_DIG) "g", value);
+	} else {
+		// The uncertainty has one significant figure, and the value has been rounded
+		// to the same place. Write both to that place.
+		char uncertainty_str[14] = "";
+		sprintf(uncertainty_str, "%.0e", uncertainty);
+		int exponent = atoi(uncertainty_str + 2), decimals = exponent < 0 ? -exponent : 0;
+		length = snprintf(dest, size, "%.*f%s%.*f", decimals, value, separator, decimals, uncertainty);
+	}
+	return length < 0 ? 0 : (size_t)length;
+}
+
 u64 jp::visx::uasf::sigFigCount(const char *s) {
 	// This function is also imported from old code,
 	// but I should be able to figure it out.
@@ -717,24 +1792,20 @@ u64 jp::visx::uasf::sigFigCount(const std::string &s) {
 // Also works: set CMake value JP_CCOMPAT to true.
 #ifdef JP_CCOMPAT
 
-extern "C" {
+#include <jp/visx/uasf/elementtype.h>
 
-typedef enum {
-	JP_VISX_UASF_UOPERATION_NUL = -1,
-	JP_VISX_UASF_UOPERATION_ADD,
-	JP_VISX_UASF_UOPERATION_SUB,
-	JP_VISX_UASF_UOPERATION_SUBO,
-	JP_VISX_UASF_UOPERATION_MUL,
-	JP_VISX_UASF_UOPERATION_DIV,
-	JP_VISX_UASF_UOPERATION_DIVO,
-	JP_VISX_UASF_UOPERATION_POW,
-	JP_VISX_UASF_UOPERATION_POWO,
-	JP_VISX_UASF_UOPERATION_MULC,
-	JP_VISX_UASF_UOPERATION_DIVC,
-	JP_VISX_UASF_UOPERATION_INVALID,
-} jp_visx_uasf_UncertaintyTableElementType;
+// The types are converted by value (see getOperation), so the two enums must
+// agree on every value.
+static_assert((int)JP_VISX_UASF_UOPERATION_NUL == (int)UOPERATION_NUL && (int)JP_VISX_UASF_UOPERATION_POWO == (int)UOPERATION_POWO, "The C and C++ operations differ");
+static_assert((int)JP_VISX_UASF_UOPERATION_MULCO == (int)UOPERATION_MULCO && (int)JP_VISX_UASF_UOPERATION_DIVCO == (int)UOPERATION_DIVCO, "The C and C++ operations differ");
+static_assert((int)JP_VISX_UASF_UOPERATION_INVALID == (int)UOPERATION_INVALID, "The C and C++ operations differ");
+
+extern "C" {
 
 typedef UncertaintyTable jp_visx_uasf_UncertaintyTable;
+typedef std::shared_ptr<const UncertaintyTableSnapshot> jp_visx_uasf_UncertaintyTableSnapshot;
+typedef UncertaintyTableArena jp_visx_uasf_UncertaintyTableArena;
+typedef void (*jp_visx_uasf_UncertaintyTable_ChangeCallback)(jp_visx_uasf_UncertaintyTable *table, size_t first_row, size_t row_count, double result, double resulting_uncertainty, void *user_data);
 
 }
 
@@ -762,14 +1833,110 @@ extern "C" size_t jp_visx_uasf_UncertaintyTable_count(jp_visx_uasf_UncertaintyTa
 extern "C" double jp_visx_uasf_UncertaintyTable_getResult(jp_visx_uasf_UncertaintyTable *table);
 extern "C" double jp_visx_uasf_UncertaintyTable_getResultingUncertainty(jp_visx_uasf_UncertaintyTable *table);
 extern "C" void jp_visx_uasf_UncertaintyTable_recompute(jp_visx_uasf_UncertaintyTable *table);
+extern "C" u64 jp_visx_uasf_UncertaintyTable_getHandle(jp_visx_uasf_UncertaintyTable *table, size_t row);
+extern "C" size_t jp_visx_uasf_UncertaintyTable_findRow(jp_visx_uasf_UncertaintyTable *table, u64 handle);
+extern "C" void jp_visx_uasf_UncertaintyTable_releaseHandles(jp_visx_uasf_UncertaintyTable *table);
+extern "C" void jp_visx_uasf_UncertaintyTable_addRows(jp_visx_uasf_UncertaintyTable *table, const jp_visx_uasf_UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count);
+extern "C" void jp_visx_uasf_UncertaintyTable_assignRows(jp_visx_uasf_UncertaintyTable *table, const jp_visx_uasf_UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count);
+extern "C" size_t jp_visx_uasf_UncertaintyTable_getRows(jp_visx_uasf_UncertaintyTable *table, size_t starting_row, size_t count, jp_visx_uasf_UncertaintyTableElementType *types_dest, double *values_dest, double *uncertainties_dest);
+extern "C" size_t jp_visx_uasf_UncertaintyTable_getCumulatives(jp_visx_uasf_UncertaintyTable *table, size_t starting_row, size_t count, double *cumulatives_dest, double *cumulative_uncertainties_dest);
 extern "C" void jp_visx_uasf_UncertaintyTable_free(jp_visx_uasf_UncertaintyTable *table);
+extern "C" void jp_visx_uasf_UncertaintyTable_publish(jp_visx_uasf_UncertaintyTable *table);
+extern "C" void jp_visx_uasf_UncertaintyTable_setPublishing(jp_visx_uasf_UncertaintyTable *table, bool publishing);
+extern "C" jp_visx_uasf_UncertaintyTableSnapshot *jp_visx_uasf_UncertaintyTable_getSnapshot(jp_visx_uasf_UncertaintyTable *table);
+extern "C" u64 jp_visx_uasf_UncertaintyTable_subscribe(jp_visx_uasf_UncertaintyTable *table, jp_visx_uasf_UncertaintyTable_ChangeCallback callback, void *user_data);
+extern "C" void jp_visx_uasf_UncertaintyTable_unsubscribe(jp_visx_uasf_UncertaintyTable *table, u64 id);
+extern "C" void jp_visx_uasf_UncertaintyTable_setCoalescing(jp_visx_uasf_UncertaintyTable *table, bool coalescing);
+extern "C" void jp_visx_uasf_UncertaintyTable_flushChanges(jp_visx_uasf_UncertaintyTable *table);
+extern "C" size_t jp_visx_uasf_UncertaintyTableSnapshot_count(jp_visx_uasf_UncertaintyTableSnapshot *snapshot);
+extern "C" jp_visx_uasf_UncertaintyTableElementType jp_visx_uasf_UncertaintyTableSnapshot_getType(jp_visx_uasf_UncertaintyTableSnapshot *snapshot, size_t row);
+extern "C" double jp_visx_uasf_UncertaintyTableSnapshot_getValue(jp_visx_uasf_UncertaintyTableSnapshot *snapshot, size_t row);
+extern "C" double jp_visx_uasf_UncertaintyTableSnapshot_getUncertainty(jp_visx_uasf_UncertaintyTableSnapshot *snapshot, size_t row);
+extern "C" double jp_visx_uasf_UncertaintyTableSnapshot_getResult(jp_visx_uasf_UncertaintyTableSnapshot *snapshot);
+extern "C" double jp_visx_uasf_UncertaintyTableSnapshot_getResultingUncertainty(jp_visx_uasf_UncertaintyTableSnapshot *snapshot);
+extern "C" u64 jp_visx_uasf_UncertaintyTableSnapshot_getVersion(jp_visx_uasf_UncertaintyTableSnapshot *snapshot);
+extern "C" void jp_visx_uasf_UncertaintyTableSnapshot_free(jp_visx_uasf_UncertaintyTableSnapshot *snapshot);
+extern "C" jp_visx_uasf_UncertaintyTableArena *jp_visx_uasf_UncertaintyTableArena_new(size_t block_size);
+extern "C" jp_visx_uasf_UncertaintyTable *jp_visx_uasf_UncertaintyTableArena_newTable(jp_visx_uasf_UncertaintyTableArena *arena, size_t starting_capacity, double starting_value, double starting_uncertainty);
+extern "C" size_t jp_visx_uasf_UncertaintyTableArena_count(jp_visx_uasf_UncertaintyTableArena *arena);
+extern "C" void jp_visx_uasf_UncertaintyTableArena_reset(jp_visx_uasf_UncertaintyTableArena *arena);
+extern "C" void jp_visx_uasf_UncertaintyTableArena_free(jp_visx_uasf_UncertaintyTableArena *arena);
 extern "C" u64 jp_visx_uasf_sigFigCount(const char *);
 extern "C" void jp_visx_uasf_simplifyUncertainty(double value, double uncertainty, double *value_dest, double *uncertainty_dest);
+extern "C" size_t jp_visx_uasf_formatUncertainty(double value, double uncertainty, const char *separator, char *dest, size_t size);
+extern "C" void jp_visx_uasf_setSimplifyCacheEnabled(bool enabled);
+extern "C" bool jp_visx_uasf_isSimplifyCacheEnabled(void);
+extern "C" void jp_visx_uasf_getSimplifyCacheStats(u64 *hits_dest, u64 *misses_dest);
+extern "C" void jp_visx_uasf_resetSimplifyCacheStats(void);
+extern "C" bool jp_visx_uasf_isInstrumented(void);
+extern "C" void jp_visx_uasf_getInstrumentationCounters(u64 *computes_dest, u64 *computed_rows_dest, u64 *simplifications_dest, u64 *nan_short_circuits_dest, u64 *allocations_dest);
+extern "C" void jp_visx_uasf_getInstrumentationRowsHistogram(u64 *buckets_dest);
+extern "C" void jp_visx_uasf_getInstrumentationTimeHistogram(jp_visx_uasf_UncertaintyTableElementType type, u64 *buckets_dest);
+extern "C" void jp_visx_uasf_resetInstrumentationStats(void);
 
 void jp_visx_uasf_simplifyUncertainty(double value, double uncertainty, double *value_dest, double *uncertainty_dest) {
 	::jp::visx::uasf::simplifyUncertainty(value, uncertainty, value_dest, uncertainty_dest);
 }
 
+size_t jp_visx_uasf_formatUncertainty(double value, double uncertainty, const char *separator, char *dest, size_t size) {
+	return ::jp::visx::uasf::formatUncertainty(value, uncertainty, separator, dest, size);
+}
+
+void jp_visx_uasf_setSimplifyCacheEnabled(bool enabled) {
+	::jp::visx::uasf::setSimplifyCacheEnabled(enabled);
+}
+
+bool jp_visx_uasf_isSimplifyCacheEnabled(void) {
+	return ::jp::visx::uasf::isSimplifyCacheEnabled();
+}
+
+void jp_visx_uasf_getSimplifyCacheStats(u64 *hits_dest, u64 *misses_dest) {
+	SimplifyCacheStats stats;
+	::jp::visx::uasf::getSimplifyCacheStats(&stats);
+	if (hits_dest) *hits_dest = stats.hits;
+	if (misses_dest) *misses_dest = stats.misses;
+}
+
+void jp_visx_uasf_resetSimplifyCacheStats(void) {
+	::jp::visx::uasf::resetSimplifyCacheStats();
+}
+
+bool jp_visx_uasf_isInstrumented(void) {
+	return ::jp::visx::uasf::isInstrumented();
+}
+
+void jp_visx_uasf_getInstrumentationCounters(u64 *computes_dest, u64 *computed_rows_dest, u64 *simplifications_dest, u64 *nan_short_circuits_dest, u64 *allocations_dest) {
+	InstrumentationStats stats;
+	::jp::visx::uasf::getInstrumentationStats(&stats);
+	if (computes_dest) *computes_dest = stats.computes;
+	if (computed_rows_dest) *computed_rows_dest = stats.computed_rows;
+	if (simplifications_dest) *simplifications_dest = stats.simplifications;
+	if (nan_short_circuits_dest) *nan_short_circuits_dest = stats.nan_short_circuits;
+	if (allocations_dest) *allocations_dest = stats.allocations;
+}
+
+void jp_visx_uasf_getInstrumentationRowsHistogram(u64 *buckets_dest) {
+	if (!buckets_dest) return;
+	InstrumentationStats stats;
+	::jp::visx::uasf::getInstrumentationStats(&stats);
+	memcpy(buckets_dest, stats.rows_histogram, sizeof(stats.rows_histogram));
+}
+
+void jp_visx_uasf_getInstrumentationTimeHistogram(jp_visx_uasf_UncertaintyTableElementType type, u64 *buckets_dest) {
+	if (!buckets_dest) return;
+	// A type which is not an operation gets the histogram of the invalid rows,
+	// like a row of that type (see RowTimer).
+	UncertaintyTableElementType operation = getOperation(type);
+	size_t histogram = operation == UOPERATION_INVALID ? instrumentation_invalid_histogram : (size_t)(operation - UOPERATION_NUL);
+	InstrumentationStats stats;
+	::jp::visx::uasf::getInstrumentationStats(&stats);
+	memcpy(buckets_dest, stats.time_histograms[histogram], sizeof(stats.time_histograms[0]));
+}
+
+void jp_visx_uasf_resetInstrumentationStats(void) {
+	::jp::visx::uasf::resetInstrumentationStats();
+}
+
 u64 jp_visx_uasf_sigFigCount(const char *c) {
 	return jp::visx::uasf::sigFigCount(c);
 }
@@ -803,7 +1970,7 @@ jp_visx_uasf_UncertaintyTableElementType jp_visx_uasf_UncertaintyTable_getType(U
 }
 
 void jp_visx_uasf_UncertaintyTable_add(jp_visx_uasf_UncertaintyTable *table, jp_visx_uasf_UncertaintyTableElementType type, double value, double uncertainty) {
-	table->add((UncertaintyTableElementType) type, value, uncertainty);
+	table->add(getOperation(type), value, uncertainty);
 }
 
 void jp_visx_uasf_UncertaintyTable_remove(UncertaintyTable *table, size_t row) {
@@ -815,7 +1982,7 @@ void jp_visx_uasf_UncertaintyTable_clear(UncertaintyTable *table) {
 }
 
 void jp_visx_uasf_UncertaintyTable_addAt(jp_visx_uasf_UncertaintyTable *table, size_t row, jp_visx_uasf_UncertaintyTableElementType type, double value, double uncertainty) {
-	table->addAt(row, (UncertaintyTableElementType) type, value, uncertainty);
+	table->addAt(row, getOperation(type), value, uncertainty);
 }
 
 void jp_visx_uasf_UncertaintyTable_swap(jp_visx_uasf_UncertaintyTable *table, size_t row1, size_t row2) {
@@ -862,10 +2029,146 @@ void jp_visx_uasf_UncertaintyTable_recompute(UncertaintyTable *table) {
 	table->recompute();
 }
 
+u64 jp_visx_uasf_UncertaintyTable_getHandle(UncertaintyTable *table, size_t row) {
+	return table->getHandle(row);
+}
+
+size_t jp_visx_uasf_UncertaintyTable_findRow(UncertaintyTable *table, u64 handle) {
+	return table->findRow(handle);
+}
+
+void jp_visx_uasf_UncertaintyTable_releaseHandles(UncertaintyTable *table) {
+	table->releaseHandles();
+}
+
+void jp_visx_uasf_UncertaintyTable_addRows(UncertaintyTable *table, const jp_visx_uasf_UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count) {
+	if (!count || !types) return;
+	std::vector<UncertaintyTableElementType> operations(count);
+	for (size_t i = 0; i < count; ++i) operations[i] = getOperation(types[i]);
+	table->addRows(operations.data(), values, uncertainties, count);
+}
+
+void jp_visx_uasf_UncertaintyTable_assignRows(UncertaintyTable *table, const jp_visx_uasf_UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count) {
+	if (count && (!types || !values || !uncertainties)) return;
+	std::vector<UncertaintyTableElement> elements;
+	elements.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		elements.emplace_back(getOperation(types[i]), values[i], uncertainties[i]);
+	}
+	table->assign(std::move(elements), false);
+}
+
+size_t jp_visx_uasf_UncertaintyTable_getRows(UncertaintyTable *table, size_t starting_row, size_t count, jp_visx_uasf_UncertaintyTableElementType *types_dest, double *values_dest, double *uncertainties_dest) {
+	if (starting_row >= table->count()) return 0;
+	if (count > table->count() - starting_row) count = table->count() - starting_row;
+	for (size_t i = 0; i < count; ++i) {
+		size_t row = starting_row + i;
+		if (types_dest) types_dest[i] = (jp_visx_uasf_UncertaintyTableElementType)table->getType(row);
+		if (values_dest) values_dest[i] = table->getValue(row);
+		if (uncertainties_dest) uncertainties_dest[i] = table->getUncertainty(row);
+	}
+	return count;
+}
+
+size_t jp_visx_uasf_UncertaintyTable_getCumulatives(UncertaintyTable *table, size_t starting_row, size_t count, double *cumulatives_dest, double *cumulative_uncertainties_dest) {
+	if (starting_row >= table->count()) return 0;
+	if (count > table->count() - starting_row) count = table->count() - starting_row;
+	for (size_t i = 0; i < count; ++i) {
+		const UncertaintyTableElement &element = table->getElement(starting_row + i);
+		if (cumulatives_dest) cumulatives_dest[i] = element.getCumulative();
+		if (cumulative_uncertainties_dest) cumulative_uncertainties_dest[i] = element.getCumulativeUncertainty();
+	}
+	return count;
+}
+
 void jp_visx_uasf_UncertaintyTable_free(UncertaintyTable *table) {
 	delete table;
 }
 
+void jp_visx_uasf_UncertaintyTable_publish(UncertaintyTable *table) {
+	table->publish();
+}
+
+void jp_visx_uasf_UncertaintyTable_setPublishing(UncertaintyTable *table, bool publishing) {
+	table->setPublishing(publishing);
+}
+
+jp_visx_uasf_UncertaintyTableSnapshot *jp_visx_uasf_UncertaintyTable_getSnapshot(UncertaintyTable *table) {
+	std::shared_ptr<const UncertaintyTableSnapshot> snapshot = table->getSnapshot();
+	return snapshot ? new std::shared_ptr<const UncertaintyTableSnapshot>(std::move(snapshot)) : nullptr;
+}
+
+u64 jp_visx_uasf_UncertaintyTable_subscribe(UncertaintyTable *table, jp_visx_uasf_UncertaintyTable_ChangeCallback callback, void *user_data) {
+	if (!callback) return 0;
+	return table->subscribe([callback, user_data](const UncertaintyTable &table, const UncertaintyTableChange &change) {
+		callback(const_cast<UncertaintyTable *>(&table), change.first_row, change.row_count, change.result.value, change.result.uncertainty, user_data);
+	});
+}
+
+void jp_visx_uasf_UncertaintyTable_unsubscribe(UncertaintyTable *table, u64 id) {
+	table->unsubscribe(id);
+}
+
+void jp_visx_uasf_UncertaintyTable_setCoalescing(UncertaintyTable *table, bool coalescing) {
+	table->setCoalescing(coalescing);
+}
+
+void jp_visx_uasf_UncertaintyTable_flushChanges(UncertaintyTable *table) {
+	table->flushChanges();
+}
+
+size_t jp_visx_uasf_UncertaintyTableSnapshot_count(jp_visx_uasf_UncertaintyTableSnapshot *snapshot) {
+	return (*snapshot)->count();
+}
+
+jp_visx_uasf_UncertaintyTableElementType jp_visx_uasf_UncertaintyTableSnapshot_getType(jp_visx_uasf_UncertaintyTableSnapshot *snapshot, size_t row) {
+	return (jp_visx_uasf_UncertaintyTableElementType)(*snapshot)->getType(row);
+}
+
+double jp_visx_uasf_UncertaintyTableSnapshot_getValue(jp_visx_uasf_UncertaintyTableSnapshot *snapshot, size_t row) {
+	return (*snapshot)->getValue(row);
+}
+
+double jp_visx_uasf_UncertaintyTableSnapshot_getUncertainty(jp_visx_uasf_UncertaintyTableSnapshot *snapshot, size_t row) {
+	return (*snapshot)->getUncertainty(row);
+}
+
+double jp_visx_uasf_UncertaintyTableSnapshot_getResult(jp_visx_uasf_UncertaintyTableSnapshot *snapshot) {
+	return (*snapshot)->getResult();
+}
+
+double jp_visx_uasf_UncertaintyTableSnapshot_getResultingUncertainty(jp_visx_uasf_UncertaintyTableSnapshot *snapshot) {
+	return (*snapshot)->getResultingUncertainty();
+}
+
+u64 jp_visx_uasf_UncertaintyTableSnapshot_getVersion(jp_visx_uasf_UncertaintyTableSnapshot *snapshot) {
+	return (*snapshot)->getVersion();
+}
+
+void jp_visx_uasf_UncertaintyTableSnapshot_free(jp_visx_uasf_UncertaintyTableSnapshot *snapshot) {
+	delete snapshot;
+}
+
+jp_visx_uasf_UncertaintyTableArena *jp_visx_uasf_UncertaintyTableArena_new(size_t block_size) {
+	return new UncertaintyTableArena(block_size ? block_size : 64 * 1024);
+}
+
+UncertaintyTable *jp_visx_uasf_UncertaintyTableArena_newTable(jp_visx_uasf_UncertaintyTableArena *arena, size_t starting_capacity, double starting_value, double starting_uncertainty) {
+	return arena->create(starting_capacity, starting_value, starting_uncertainty);
+}
+
+size_t jp_visx_uasf_UncertaintyTableArena_count(jp_visx_uasf_UncertaintyTableArena *arena) {
+	return arena->count();
+}
+
+void jp_visx_uasf_UncertaintyTableArena_reset(jp_visx_uasf_UncertaintyTableArena *arena) {
+	arena->reset();
+}
+
+void jp_visx_uasf_UncertaintyTableArena_free(jp_visx_uasf_UncertaintyTableArena *arena) {
+	delete arena;
+}
+
 jp_visx_uasf_UncertaintyTable *jp_visx_uasf_UncertaintyTable_new3(size_t starting_capacity, double starting_value, double starting_uncertainty) {
 	return new UncertaintyTable(starting_capacity, starting_value, starting_uncertainty);
 }
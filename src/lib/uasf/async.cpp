@@ -0,0 +1,237 @@
+/* src/lib/uasf/async.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <utility>
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+namespace {
+	// The number of rows computed while the lock is held.
+	const size_t slice_rows = 512;
+}
+
+AsyncUncertaintyTable::AsyncUncertaintyTable(ThreadPool *pool) : AsyncUncertaintyTable(0.0, 0.0, pool) {}
+
+AsyncUncertaintyTable::AsyncUncertaintyTable(double starting_value, double starting_uncertainty, ThreadPool *pool) : pool_(pool ? *pool : ThreadPool::global()), waiting_(0), table_(0, starting_value, starting_uncertainty), step_size_(16384), running_(false), stopping_(false) {
+	table_.setPublishing(true);
+	table_.publish();
+	table_.beginBatch();
+}
+
+AsyncUncertaintyTable::~AsyncUncertaintyTable(void) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	stopping_ = true;
+	if (!running_) return;
+	// A task which did not start may be queued behind the thread which destroys
+	// the table, so it is cancelled instead of waited for.
+	{
+		std::lock_guard<std::mutex> task_lock(task_->mutex);
+		if (!task_->started) {
+			task_->cancelled = true;
+			return;
+		}
+	}
+	idle_.wait(lock, [this](void) {
+		return !running_;
+	});
+}
+
+void AsyncUncertaintyTable::add(UncertaintyTableElementType type, double value, double uncertainty) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	table_.add(type, value, uncertainty);
+	this->schedule();
+}
+
+void AsyncUncertaintyTable::addAt(size_t row, UncertaintyTableElementType type, double value, double uncertainty) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	table_.addAt(row, type, value, uncertainty);
+	this->schedule();
+}
+
+void AsyncUncertaintyTable::remove(size_t row) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	table_.remove(row);
+	this->schedule();
+}
+
+void AsyncUncertaintyTable::clear(void) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	table_.clear();
+	this->schedule();
+}
+
+void AsyncUncertaintyTable::swap(size_t row1, size_t row2) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	table_.swap(row1, row2);
+	this->schedule();
+}
+
+void AsyncUncertaintyTable::set(size_t row, double value) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	table_.set(row, value);
+	this->schedule();
+}
+
+void AsyncUncertaintyTable::set(size_t row, double value, double uncertainty) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	table_.set(row, value, uncertainty);
+	this->schedule();
+}
+
+void AsyncUncertaintyTable::setUncertainty(size_t row, double uncertainty) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	table_.setUncertainty(row, uncertainty);
+	this->schedule();
+}
+
+void AsyncUncertaintyTable::setStartingValue(double value, double uncertainty) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	table_.setStartingValue(value, uncertainty);
+	this->schedule();
+}
+
+void AsyncUncertaintyTable::assign(std::vector<UncertaintyTableElement> &&elements) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	table_.assign(std::move(elements), false);
+	this->schedule();
+}
+
+void AsyncUncertaintyTable::modify(const std::function<void(UncertaintyTable &)> &fn) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	fn(table_);
+	this->schedule();
+}
+
+size_t AsyncUncertaintyTable::count(void) const {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	return table_.count();
+}
+
+std::shared_future<UncertaintyPair> AsyncUncertaintyTable::getResult(void) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	if (!promise_) {
+		promise_.reset(new std::promise<UncertaintyPair>());
+		future_ = promise_->get_future().share();
+		// If every row is computed, the result is known.
+		if (table_.getPendingRow() == SIZE_MAX) {
+			UncertaintyPair result;
+			table_.getResult(&result);
+			promise_->set_value(result);
+			promise_.reset();
+		}
+	}
+	return future_;
+}
+
+std::shared_ptr<const UncertaintyTableSnapshot> AsyncUncertaintyTable::getSnapshot(void) const {
+	return table_.getSnapshot();
+}
+
+bool AsyncUncertaintyTable::isReady(void) const {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	return table_.getPendingRow() == SIZE_MAX;
+}
+
+void AsyncUncertaintyTable::wait(void) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	idle_.wait(lock, [this](void) {
+		return !running_;
+	});
+}
+
+void AsyncUncertaintyTable::setProgressCallback(ProgressCallback callback) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	progress_ = std::move(callback);
+}
+
+void AsyncUncertaintyTable::setStepSize(size_t rows) {
+	std::unique_lock<std::mutex> lock = this->lockTable();
+	step_size_ = rows ? rows : 1;
+}
+
+std::unique_lock<std::mutex> AsyncUncertaintyTable::lockTable(void) const {
+	++waiting_;
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (!--waiting_) unblocked_.notify_all();
+	return lock;
+}
+
+void AsyncUncertaintyTable::schedule(void) {
+	if (running_ || table_.getPendingRow() == SIZE_MAX) return;
+	running_ = true;
+	task_ = std::make_shared<Task>();
+	task_->started = false;
+	task_->cancelled = false;
+	std::shared_ptr<Task> task = task_;
+	pool_.submit([this, task](void) {
+		{
+			std::lock_guard<std::mutex> lock(task->mutex);
+			if (task->cancelled) return;
+			task->started = true;
+		}
+		this->run();
+	});
+}
+
+void AsyncUncertaintyTable::run(void) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	// The table may be changed while the callback runs, so the lock is released
+	// for it, and the rows are checked again afterwards.
+	while (!stopping_ && table_.getPendingRow() != SIZE_MAX) {
+		// The step is computed in slices. Between them, the threads which wait for
+		// the lock go first, and may change the rows which are left.
+		bool done = false;
+		for (size_t rows = 0; !stopping_ && rows < step_size_; ) {
+			size_t slice = step_size_ - rows < slice_rows ? step_size_ - rows : slice_rows;
+			if ((done = table_.computePending(slice))) break;
+			rows += slice;
+			if (waiting_) {
+				unblocked_.wait(lock, [this](void) {
+					return !waiting_;
+				});
+			}
+		}
+		if (stopping_) break;
+		size_t count = table_.count(), row = done ? count : table_.getPendingRow();
+		if (done) {
+			// End the batch to publish the snapshot. Every row is computed, so nothing
+			// is computed again.
+			table_.endBatch();
+			table_.beginBatch();
+			UncertaintyPair result;
+			table_.getResult(&result);
+			if (promise_) {
+				promise_->set_value(result);
+				promise_.reset();
+			}
+		}
+		ProgressCallback progress = progress_;
+		if (!progress) continue;
+		lock.unlock();
+		progress(row, count);
+		lock.lock();
+	}
+	running_ = false;
+	idle_.notify_all();
+}
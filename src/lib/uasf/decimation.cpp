@@ -0,0 +1,137 @@
+/* src/lib/uasf/decimation.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <jp/visx.hpp>
+#include <math.h>
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+namespace {
+	const ResultExtent empty_extent = {NAN, NAN, NAN, NAN};
+
+	// fmin and fmax leave out NaN.
+	inline void merge(ResultExtent *extent, const ResultExtent &other) {
+		extent->low = fmin(extent->low, other.low);
+		extent->high = fmax(extent->high, other.high);
+		extent->band_low = fmin(extent->band_low, other.band_low);
+		extent->band_high = fmax(extent->band_high, other.band_high);
+	}
+}
+
+ResultDecimation::ResultDecimation(const UncertaintyTable *table) : table_(table), count_(0) {
+	this->update(0);
+}
+
+void ResultDecimation::update(size_t first_row) {
+	count_ = table_->count();
+	if (first_row > count_) first_row = count_;
+	// The size of every level follows the number of rows.
+	size_t size = (count_ + leaf_rows - 1) / leaf_rows, level = 0;
+	for ( ; size; ++level, size = size > 1 ? (size + 1) / 2 : 0) {
+		if (level == levels_.size()) levels_.emplace_back();
+		levels_[level].resize(size);
+	}
+	levels_.resize(level);
+	if (levels_.empty()) return;
+	// The leaves of the changed rows are built from the rows, and the nodes above
+	// them from the nodes below.
+	size_t first = first_row / leaf_rows;
+	std::vector<ResultExtent> &leaves = levels_[0];
+	for (size_t i = first; i < leaves.size(); ++i) {
+		leaves[i] = empty_extent;
+		size_t end = (i + 1) * leaf_rows;
+		this->addRows(i * leaf_rows, end < count_ ? end : count_, &leaves[i]);
+	}
+	for (size_t k = 1; k < levels_.size(); ++k) {
+		first /= 2;
+		const std::vector<ResultExtent> &below = levels_[k - 1];
+		std::vector<ResultExtent> &nodes = levels_[k];
+		for (size_t i = first; i < nodes.size(); ++i) {
+			nodes[i] = below[2 * i];
+			if (2 * i + 1 < below.size()) merge(&nodes[i], below[2 * i + 1]);
+		}
+	}
+}
+
+size_t ResultDecimation::count(void) const {
+	return count_;
+}
+
+void ResultDecimation::getExtent(size_t first_row, size_t row_count, ResultExtent *extent_dest) const {
+	if (!extent_dest) return;
+	*extent_dest = empty_extent;
+	if (first_row >= count_) return;
+	size_t end_row = row_count < count_ - first_row ? first_row + row_count : count_;
+	// The leaves which are entirely in the range.
+	size_t left = (first_row + leaf_rows - 1) / leaf_rows,
+		   right = end_row / leaf_rows;
+	if (left >= right) {
+		this->addRows(first_row, end_row, extent_dest);
+		return;
+	}
+	// The rows before and after them are read from the table.
+	this->addRows(first_row, left * leaf_rows, extent_dest);
+	this->addRows(right * leaf_rows, end_row, extent_dest);
+	// The nodes which cover the leaves are taken bottom up, like in a segment
+	// tree: a node at an odd end of the range is taken, and the rest of the
+	// range is covered by the level above.
+	for (size_t k = 0; left < right; ++k, left /= 2, right /= 2) {
+		const std::vector<ResultExtent> &nodes = levels_[k];
+		if (left & 1) merge(extent_dest, nodes[left++]);
+		if (right & 1) merge(extent_dest, nodes[--right]);
+	}
+}
+
+void ResultDecimation::decimate(size_t first_row, size_t row_count, size_t buckets, ResultExtent *extents_dest) const {
+	if (!buckets || !extents_dest) return;
+	// When the buckets cover many leaves, the boundaries between them are moved
+	// to the nearest leaf, so that their rows are read from the nodes only. Every
+	// row is still in exactly one bucket.
+	bool snap = row_count / buckets >= 8 * leaf_rows;
+	auto boundary = [=](size_t i) {
+		size_t row = first_row + (size_t)((u64)row_count * i / buckets);
+		if (snap && i && i < buckets) row = (row + leaf_rows / 2) / leaf_rows * leaf_rows;
+		return row;
+	};
+	size_t begin = boundary(0);
+	for (size_t i = 0; i < buckets; ++i) {
+		size_t end = boundary(i + 1);
+		this->getExtent(begin, end - begin, &extents_dest[i]);
+		begin = end;
+	}
+}
+
+void ResultDecimation::addRows(size_t first_row, size_t end_row, ResultExtent *extent) const {
+	for (size_t row = first_row; row < end_row; ++row) {
+		// The result of a row is the cumulative of the next one, or the result of
+		// the table for the last row.
+		UncertaintyPair result;
+		if (row + 1 < count_) {
+			table_->getElement(row + 1).getCumulative(&result);
+		} else {
+			table_->getResult(&result);
+		}
+		merge(extent, ResultExtent{result.value, result.value, result.value - result.uncertainty, result.value + result.uncertainty});
+	}
+}
@@ -0,0 +1,367 @@
+/* src/lib/uasf/fit.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <jp/visx.hpp>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+namespace {
+	const size_t max_terms = max_fit_degree + 1,
+				 max_powers = 2 * max_fit_degree + 1;
+
+	// The number of points read by a task, and the number of points whose
+	// weights and powers are computed together (which stay in the cache).
+	const size_t task_points = 1 << 15,
+				 block_points = 256;
+
+	// The number of times a fit is repeated at most to find the effective
+	// uncertainties, and the change of the parameters at which it stops.
+	const size_t max_iterations = 8;
+	const double convergence = 1e-10;
+
+	// The range of the x, and whether any point has an uncertainty.
+	struct Range {
+		double low,
+			   high;
+		bool x_uncertain,
+			 y_uncertain;
+	};
+
+	// The sums of the normal equations, in the scaled x (u).
+	struct Sums {
+		// The sum of w * u^k and of w * y * u^k.
+		double powers[max_powers],
+			   moments[max_terms];
+		// The points which were added, and the points which were left out because
+		// their effective uncertainty is zero or infinite.
+		size_t points,
+			   rejected;
+	};
+
+	// How the points of a pass are weighted and scaled.
+	struct Pass {
+		const UncertaintyPair *x,
+							  *y;
+		size_t terms;
+		double center,
+			   scale;
+		// Whether the points are weighted, and the coefficients of the slope dq/du
+		// of the last fit (NULL for the first one).
+		bool weighted;
+		const double *slope;
+	};
+
+	// Reduce count points in tasks of task_points on the pool. The results of the
+	// tasks are merged in order.
+	template <typename T, typename F, typename M>
+	T reduce(size_t count, ThreadPool *pool, const T &initial, const F &fn, const M &merge) {
+		if (count <= task_points) {
+			T result = initial;
+			fn(0, count, &result);
+			return result;
+		}
+		std::vector<T> parts((count + task_points - 1) / task_points, initial);
+		pool->parallelFor(count, task_points, [&](size_t begin, size_t end) {
+			fn(begin, end, &parts[begin / task_points]);
+		});
+		T result = initial;
+		for (const T &part : parts) {
+			merge(&result, part);
+		}
+		return result;
+	}
+
+	void findRange(const UncertaintyPair *x, const UncertaintyPair *y, size_t begin, size_t end, Range *range) {
+		for (size_t i = begin; i < end; ++i) {
+			if (isnan(x[i].value) || isnan(y[i].value)) continue;
+			range->low = fmin(range->low, x[i].value);
+			range->high = fmax(range->high, x[i].value);
+			if (x[i].uncertainty != 0.0) range->x_uncertain = true;
+			if (y[i].uncertainty != 0.0) range->y_uncertain = true;
+		}
+	}
+
+	// Find the scaled x and the weight of point i. It returns false if the point
+	// has no value, and the weight is 0 if its effective uncertainty is zero or
+	// infinite.
+	inline bool weigh(const Pass &pass, size_t i, double *scaled, double *weight) {
+		const UncertaintyPair &x = pass.x[i], &y = pass.y[i];
+		if (isnan(x.value) || isnan(y.value)) return false;
+		*scaled = (x.value - pass.center) * pass.scale;
+		*weight = 1.0;
+		if (pass.weighted) {
+			double variance = y.uncertainty * y.uncertainty;
+			if (pass.slope) {
+				// The slope dq/du times du/dx is dy/dx.
+				double slope = 0.0;
+				for (size_t k = pass.terms - 1; k-- > 0; ) slope = slope * *scaled + pass.slope[k];
+				slope *= pass.scale * x.uncertainty;
+				variance += slope * slope;
+			}
+			*weight = variance > 0.0 && !isinf(variance) ? 1.0 / variance : 0.0;
+		}
+		return true;
+	}
+
+	// Add the terms of the points to the sums, a block at a time: the scaled x,
+	// the weights and the weighted y of the block are computed first, then every
+	// power is added for the whole block in four lanes.
+	void addPoints(const Pass &pass, size_t begin, size_t end, Sums *sums) {
+		double u[block_points], w[block_points], wy[block_points];
+		size_t powers = 2 * pass.terms - 1;
+		for (size_t block = begin; block < end; ) {
+			size_t n = 0;
+			for ( ; block < end && n < block_points; ++block) {
+				double scaled, weight;
+				if (!weigh(pass, block, &scaled, &weight)) continue;
+				if (weight == 0.0) {
+					++sums->rejected;
+					continue;
+				}
+				u[n] = scaled;
+				w[n] = weight;
+				wy[n] = weight * pass.y[block].value;
+				++n;
+			}
+			sums->points += n;
+			// w * u^k, and w * y * u^k for the first terms.
+			for (size_t k = 0; k < powers; ++k) {
+				double lane[4] = {0.0, 0.0, 0.0, 0.0}, moment[4] = {0.0, 0.0, 0.0, 0.0};
+				bool with_moment = k < pass.terms;
+				size_t j = 0;
+				for ( ; j + 4 <= n; j += 4) {
+					for (size_t l = 0; l < 4; ++l) {
+						lane[l] += w[j + l];
+						w[j + l] *= u[j + l];
+						if (with_moment) {
+							moment[l] += wy[j + l];
+							wy[j + l] *= u[j + l];
+						}
+					}
+				}
+				for ( ; j < n; ++j) {
+					lane[0] += w[j];
+					w[j] *= u[j];
+					if (with_moment) {
+						moment[0] += wy[j];
+						wy[j] *= u[j];
+					}
+				}
+				sums->powers[k] += (lane[0] + lane[1]) + (lane[2] + lane[3]);
+				if (with_moment) sums->moments[k] += (moment[0] + moment[1]) + (moment[2] + moment[3]);
+			}
+		}
+	}
+
+	// Add w * (y - q(u))^2 of the points to chi_squared. The residuals are
+	// computed directly, since expanding the square into the sums loses every
+	// digit when the y are far from 0.
+	void addResiduals(const Pass &pass, const double *q, size_t begin, size_t end, double *chi_squared) {
+		for (size_t i = begin; i < end; ++i) {
+			double scaled, weight;
+			if (!weigh(pass, i, &scaled, &weight) || weight == 0.0) continue;
+			double fitted = 0.0;
+			for (size_t k = pass.terms; k-- > 0; ) fitted = fitted * scaled + q[k];
+			double residual = pass.y[i].value - fitted;
+			*chi_squared += weight * residual * residual;
+		}
+	}
+
+	// Decompose the symmetric matrix a (n by n) into l * l^T. It returns false if
+	// a is not positive definite.
+	bool cholesky(const double *a, size_t n, double *l) {
+		memset(l, 0, n * n * sizeof(double));
+		for (size_t i = 0; i < n; ++i) {
+			for (size_t j = 0; j <= i; ++j) {
+				double sum = a[i * n + j];
+				for (size_t k = 0; k < j; ++k) sum -= l[i * n + k] * l[j * n + k];
+				if (i == j) {
+					// A pivot much smaller than its entry means the columns are
+					// dependent.
+					if (!(sum > 1e-14 * a[i * n + i])) return false;
+					l[i * n + i] = sqrt(sum);
+				} else {
+					l[i * n + j] = sum / l[j * n + j];
+				}
+			}
+		}
+		return true;
+	}
+
+	// Solve l * l^T * x = b.
+	void solve(const double *l, size_t n, const double *b, double *x) {
+		for (size_t i = 0; i < n; ++i) {
+			double sum = b[i];
+			for (size_t k = 0; k < i; ++k) sum -= l[i * n + k] * x[k];
+			x[i] = sum / l[i * n + i];
+		}
+		for (size_t i = n; i-- > 0; ) {
+			double sum = x[i];
+			for (size_t k = i + 1; k < n; ++k) sum -= l[k * n + i] * x[k];
+			x[i] = sum / l[i * n + i];
+		}
+	}
+}
+
+bool jp::visx::uasf::fitPolynomial(const UncertaintyPair *x, const UncertaintyPair *y, size_t count, size_t degree, UncertaintyPair *parameters_dest, double *covariance_dest, FitStatistics *statistics_dest, ThreadPool *pool) {
+	if (!x || !y || !parameters_dest || degree > max_fit_degree) return false;
+	size_t terms = degree + 1;
+	if (!pool) pool = &ThreadPool::global();
+	Range range = reduce(count, pool, Range{NAN, NAN, false, false}, [x, y](size_t begin, size_t end, Range *range) {
+		findRange(x, y, begin, end, range);
+	}, [](Range *range, const Range &part) {
+		range->low = fmin(range->low, part.low);
+		range->high = fmax(range->high, part.high);
+		range->x_uncertain = range->x_uncertain || part.x_uncertain;
+		range->y_uncertain = range->y_uncertain || part.y_uncertain;
+	});
+	if (isnan(range.low)) return false;
+	// The x are mapped to [-1, 1], so the powers stay close to 1.
+	double half_width = (range.high - range.low) / 2.0;
+	Pass pass{x, y, terms, (range.low + range.high) / 2.0, half_width > 0.0 ? 1.0 / half_width : 1.0, range.x_uncertain || range.y_uncertain, nullptr};
+	// Without uncertainties of y, the first fit has the same weights, and gives
+	// the slopes for the next.
+	bool first_unweighted = pass.weighted && !range.y_uncertain;
+	double a[max_terms * max_terms], l[max_terms * max_terms], q[max_terms], slope[max_terms], previous[max_terms];
+	Sums sums;
+	Pass current;
+	for (size_t iteration = 0; ; ++iteration) {
+		current = pass;
+		if (iteration == 0 && first_unweighted) current.weighted = false;
+		Sums initial;
+		memset(&initial, 0, sizeof(initial));
+		sums = reduce(count, pool, initial, [&current](size_t begin, size_t end, Sums *sums) {
+			addPoints(current, begin, end, sums);
+		}, [](Sums *sums, const Sums &part) {
+			for (size_t k = 0; k < max_powers; ++k) sums->powers[k] += part.powers[k];
+			for (size_t k = 0; k < max_terms; ++k) sums->moments[k] += part.moments[k];
+			sums->points += part.points;
+			sums->rejected += part.rejected;
+		});
+		if (sums.points <= terms) return false;
+		for (size_t i = 0; i < terms; ++i) {
+			for (size_t j = 0; j < terms; ++j) a[i * terms + j] = sums.powers[i + j];
+		}
+		if (!cholesky(a, terms, l)) return false;
+		solve(l, terms, sums.moments, q);
+		// The fit is done unless the effective uncertainties depend on it.
+		if (!range.x_uncertain || !pass.weighted || iteration + 1 == max_iterations) break;
+		if (iteration) {
+			double change = 0.0, size = 0.0;
+			for (size_t k = 0; k < terms; ++k) {
+				change = fmax(change, fabs(q[k] - previous[k]));
+				size = fmax(size, fabs(q[k]));
+			}
+			if (change <= convergence * size) break;
+		}
+		memcpy(previous, q, terms * sizeof(double));
+		for (size_t k = 1; k < terms; ++k) slope[k - 1] = k * q[k];
+		pass.slope = slope;
+	}
+	// The covariance of the scaled parameters is the inverse of a.
+	double covariance[max_terms * max_terms], column[max_terms];
+	for (size_t j = 0; j < terms; ++j) {
+		double unit[max_terms] = {0.0};
+		unit[j] = 1.0;
+		solve(l, terms, unit, column);
+		for (size_t i = 0; i < terms; ++i) covariance[i * terms + j] = column[i];
+	}
+	// chi^2 = sum of w * (y - q(u))^2, with the weights of the last fit.
+	double chi_squared = reduce(count, pool, 0.0, [&current, &q](size_t begin, size_t end, double *chi_squared) {
+		addResiduals(current, q, begin, end, chi_squared);
+	}, [](double *chi_squared, double part) {
+		*chi_squared += part;
+	});
+	size_t degrees_of_freedom = sums.points - terms;
+	// Without uncertainties, the scatter of the points gives the uncertainties.
+	if (!current.weighted) {
+		double variance = chi_squared / degrees_of_freedom;
+		for (size_t i = 0; i < terms * terms; ++i) covariance[i] *= variance;
+	}
+	// The polynomial in u = (x - center) * scale is expanded into a polynomial in
+	// x: p = t * q, where t[m][k] = C(k, m) * scale^m * (-center * scale)^(k - m).
+	double t[max_terms * max_terms] = {0.0}, offset = -pass.center * pass.scale;
+	for (size_t k = 0; k < terms; ++k) {
+		double binomial = 1.0;
+		for (size_t m = 0; m <= k; ++m) {
+			t[m * terms + k] = binomial * pow(pass.scale, (double)m) * pow(offset, (double)(k - m));
+			binomial = binomial * (k - m) / (m + 1);
+		}
+	}
+	double product[max_terms * max_terms];
+	// The covariance of p is t * covariance * t^T.
+	for (size_t i = 0; i < terms; ++i) {
+		for (size_t j = 0; j < terms; ++j) {
+			double sum = 0.0;
+			for (size_t k = 0; k < terms; ++k) sum += t[i * terms + k] * covariance[k * terms + j];
+			product[i * terms + j] = sum;
+		}
+	}
+	for (size_t i = 0; i < terms; ++i) {
+		double value = 0.0;
+		for (size_t k = 0; k < terms; ++k) value += t[i * terms + k] * q[k];
+		for (size_t j = 0; j < terms; ++j) {
+			double sum = 0.0;
+			for (size_t k = 0; k < terms; ++k) sum += product[i * terms + k] * t[j * terms + k];
+			if (covariance_dest) covariance_dest[i * terms + j] = sum;
+			if (i == j) parameters_dest[i] = UncertaintyPair{value, sqrt(sum)};
+		}
+	}
+	if (statistics_dest) *statistics_dest = FitStatistics{chi_squared, sums.points, degrees_of_freedom, sums.rejected};
+	return true;
+}
+
+bool jp::visx::uasf::fitLine(const UncertaintyPair *x, const UncertaintyPair *y, size_t count, UncertaintyPair *intercept_dest, UncertaintyPair *slope_dest, FitStatistics *statistics_dest, ThreadPool *pool) {
+	UncertaintyPair parameters[2];
+	if (!fitPolynomial(x, y, count, 1, parameters, nullptr, statistics_dest, pool)) return false;
+	if (intercept_dest) *intercept_dest = parameters[0];
+	if (slope_dest) *slope_dest = parameters[1];
+	return true;
+}
+
+// If want C compatibility.
+// Also works: set CMake value JP_CCOMPAT to true.
+#ifdef JP_CCOMPAT
+
+extern "C" bool jp_visx_uasf_fitPolynomial(const double *x, const double *y, size_t count, size_t degree, double *values_dest, double *uncertainties_dest, double *chi_squared_dest);
+
+bool jp_visx_uasf_fitPolynomial(const double *x, const double *y, size_t count, size_t degree, double *values_dest, double *uncertainties_dest, double *chi_squared_dest) {
+	// The pairs have the layout of UncertaintyPair.
+	static_assert(sizeof(UncertaintyPair) == 2 * sizeof(double), "UncertaintyPair is not two doubles");
+	if (degree > max_fit_degree) return false;
+	UncertaintyPair parameters[max_terms];
+	FitStatistics statistics;
+	if (!fitPolynomial((const UncertaintyPair *)x, (const UncertaintyPair *)y, count, degree, parameters, nullptr, &statistics)) return false;
+	for (size_t i = 0; i <= degree; ++i) {
+		if (values_dest) values_dest[i] = parameters[i].value;
+		if (uncertainties_dest) uncertainties_dest[i] = parameters[i].uncertainty;
+	}
+	if (chi_squared_dest) *chi_squared_dest = statistics.chi_squared;
+	return true;
+}
+
+#endif
@@ -0,0 +1,476 @@
+/* src/lib/uasf/ingest.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+namespace {
+	// The longest line read from a file. A longer line (or a file without line
+	// feeds) stops the ingestion instead of filling the memory.
+	const size_t max_line_size = 1 << 20;
+
+	// A piece of the input which ends at a line boundary. If the piece was read
+	// from a file, storage owns its bytes.
+	struct Chunk {
+		std::shared_ptr<std::vector<char>> storage;
+		const char *data;
+		size_t size;
+	};
+
+	// The rows parsed from one chunk.
+	struct Rows {
+		std::vector<UncertaintyTableElementType> types;
+		std::vector<double> values,
+							uncertainties;
+		// The number of lines in the chunk, and the line (starting at one) of the
+		// first invalid row, or zero if there is none.
+		size_t lines,
+			   error_line;
+	};
+
+	// The source of the chunks.
+	class Source {
+	public:
+		virtual ~Source(void) {}
+		// Get the next chunk. It returns false at the end of the input, or if the
+		// input could not be read (in which case failed returns true).
+		virtual bool next(Chunk *chunk) = 0;
+		virtual bool failed(void) const { return false; }
+		// This returns whether the input stopped at a line longer than
+		// max_line_size.
+		virtual bool lineTooLong(void) const { return false; }
+	};
+
+	// A source which cuts a buffer which is entirely in memory.
+	class BufferSource : public Source {
+	public:
+		BufferSource(const char *data, size_t size, size_t chunk_size) : data_(data), end_(data + size), chunk_size_(chunk_size) {}
+
+		bool next(Chunk *chunk) override {
+			if (data_ >= end_) return false;
+			const char *end = (size_t)(end_ - data_) > chunk_size_ ? data_ + chunk_size_ : end_;
+			// Extend the chunk to the end of its last line.
+			if (end < end_) {
+				const char *newline = (const char *)memchr(end, '\n', end_ - end);
+				end = newline ? newline + 1 : end_;
+			}
+			chunk->storage.reset();
+			chunk->data = data_;
+			chunk->size = end - data_;
+			data_ = end;
+			return true;
+		}
+	private:
+		const char *data_, *end_;
+		size_t chunk_size_;
+	};
+
+	// A source which reads a file in chunks.
+	class FileSource : public Source {
+	public:
+		FileSource(FILE *file, size_t chunk_size) : file_(file), chunk_size_(chunk_size), failed_(false), line_too_long_(false) {}
+
+		bool next(Chunk *chunk) override {
+			std::shared_ptr<std::vector<char>> storage = std::make_shared<std::vector<char>>();
+			// Start with the end of the last line of the previous chunk.
+			storage->swap(carry_);
+			size_t newline = SIZE_MAX;
+			bool eof = false;
+			// Read until the chunk contains the end of a line (or the file ends).
+			while (newline == SIZE_MAX && !eof) {
+				size_t old_size = storage->size();
+				storage->resize(old_size + chunk_size_);
+				size_t n = fread(storage->data() + old_size, 1, chunk_size_, file_);
+				storage->resize(old_size + n);
+				if (n < chunk_size_) {
+					eof = true;
+					if (ferror(file_)) {
+						failed_ = true;
+						return false;
+					}
+				}
+				for (size_t i = storage->size(); i > old_size; --i) {
+					if ((*storage)[i - 1] == '\n') {
+						newline = i - 1;
+						break;
+					}
+				}
+				// Without a line feed, the whole storage is one line.
+				if (newline == SIZE_MAX && storage->size() > max_line_size) {
+					failed_ = line_too_long_ = true;
+					return false;
+				}
+			}
+			if (storage->empty()) return false;
+			// Keep the unfinished line for the next chunk.
+			if (!eof && newline != SIZE_MAX) {
+				carry_.assign(storage->begin() + newline + 1, storage->end());
+				storage->resize(newline + 1);
+			}
+			chunk->data = storage->data();
+			chunk->size = storage->size();
+			chunk->storage = std::move(storage);
+			return true;
+		}
+
+		bool failed(void) const override {
+			return failed_;
+		}
+
+		bool lineTooLong(void) const override {
+			return line_too_long_;
+		}
+	private:
+		FILE *file_;
+		size_t chunk_size_;
+		std::vector<char> carry_;
+		bool failed_,
+			 line_too_long_;
+	};
+
+	bool isSpace(char c) {
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	// Remove the spaces around [*begin, *end). Tabs are only removed if they are
+	// not the delimiter.
+	void trim(const char **begin, const char **end, char delimiter) {
+		while (*begin < *end && isSpace(**begin) && **begin != delimiter) ++*begin;
+		while (*end > *begin && isSpace((*end)[-1]) && (*end)[-1] != delimiter) --*end;
+	}
+
+	// Parse a number which fills [begin, end).
+	bool parseDouble(const char *begin, const char *end, double *value_dest) {
+		// strtod needs a terminated string, and the input is not terminated.
+		char buffer[64];
+		size_t length = end - begin;
+		if (!length || length >= sizeof(buffer)) return false;
+		memcpy(buffer, begin, length);
+		buffer[length] = '\0';
+		char *parse_end;
+		*value_dest = strtod(buffer, &parse_end);
+		return parse_end == buffer + length;
+	}
+
+	// Parse one line (without its line feed). It returns false if the line is not
+	// a valid row, and sets *empty if the line has no row.
+	bool parseLine(const char *begin, const char *end, char delimiter, UncertaintyTableElementType *type, double *value, double *uncertainty, bool *empty) {
+		trim(&begin, &end, '\0');
+		*empty = begin == end || *begin == '#';
+		if (*empty) return true;
+		const char *fields[3][2];
+		size_t field_count = 0;
+		for (const char *field = begin; ; ) {
+			const char *field_end = (const char *)memchr(field, delimiter, end - field);
+			if (!field_end) field_end = end;
+			// There may not be more than three columns.
+			if (field_count == 3) return false;
+			fields[field_count][0] = field;
+			fields[field_count][1] = field_end;
+			trim(&fields[field_count][0], &fields[field_count][1], delimiter);
+			++field_count;
+			if (field_end == end) break;
+			field = field_end + 1;
+		}
+		if (field_count < 2) return false;
+		*type = parseOperation(fields[0][0], fields[0][1] - fields[0][0]);
+		if (*type == UOPERATION_INVALID || !parseDouble(fields[1][0], fields[1][1], value)) return false;
+		*uncertainty = 0.0;
+		// The uncertainty may be left out (or left empty).
+		if (field_count == 3 && fields[2][0] != fields[2][1]) {
+			return parseDouble(fields[2][0], fields[2][1], uncertainty);
+		}
+		return true;
+	}
+
+	// Parse every line of a chunk. If skip_header is true and the first line is
+	// not a valid row, it is skipped.
+	void parseChunk(const Chunk &chunk, char delimiter, bool skip_header, Rows *rows) {
+		const char *data = chunk.data, *end = chunk.data + chunk.size;
+		rows->lines = 0;
+		rows->error_line = 0;
+		// Most lines are more than 16 bytes long.
+		rows->types.reserve(chunk.size / 16);
+		rows->values.reserve(chunk.size / 16);
+		rows->uncertainties.reserve(chunk.size / 16);
+		while (data < end) {
+			const char *newline = (const char *)memchr(data, '\n', end - data);
+			const char *line_end = newline ? newline : end;
+			++rows->lines;
+			UncertaintyTableElementType type;
+			double value, uncertainty;
+			bool empty;
+			if (!parseLine(data, line_end, delimiter, &type, &value, &uncertainty, &empty)) {
+				if (!(skip_header && rows->lines == 1)) {
+					rows->error_line = rows->lines;
+					return;
+				}
+			} else if (!empty) {
+				rows->types.push_back(type);
+				rows->values.push_back(value);
+				rows->uncertainties.push_back(uncertainty);
+			}
+			data = newline ? newline + 1 : end;
+		}
+	}
+
+	// Guess the delimiter from the first line of a chunk.
+	char detectDelimiter(const Chunk &chunk) {
+		const char *newline = (const char *)memchr(chunk.data, '\n', chunk.size);
+		size_t length = newline ? (size_t)(newline - chunk.data) : chunk.size;
+		return memchr(chunk.data, '\t', length) ? '\t' : ',';
+	}
+
+	// A chunk which is parsed by a worker of the pool, or by the thread which
+	// needs its rows first. Whoever claims it first parses it.
+	struct Job {
+		Chunk chunk;
+		char delimiter;
+		bool skip_header;
+		Rows rows;
+		std::atomic<bool> claimed;
+		std::promise<void> done;
+		std::future<void> future;
+
+		Job(const Chunk &chunk, char delimiter, bool skip_header) : chunk(chunk), delimiter(delimiter), skip_header(skip_header), claimed(false), future(done.get_future()) {}
+
+		// Parse the chunk if nobody claimed it yet.
+		void run(void) {
+			if (claimed.exchange(true)) return;
+			parseChunk(chunk, delimiter, skip_header, &rows);
+			done.set_value();
+		}
+
+		// Parse the chunk on this thread if no worker started it, or wait for the
+		// worker which did. This never waits for a job which is only queued, so
+		// it does not deadlock when it is called from a worker of the pool.
+		void finish(void) {
+			this->run();
+			future.wait();
+		}
+	};
+
+	// Parse the chunks of source on the pool and pass their rows to consume, in
+	// order. It returns false if the input could not be read or has an invalid row.
+	bool run(Source &source, char delimiter, ThreadPool &pool, const std::function<void(const Rows &)> &consume, size_t *row_count, size_t *error_line) {
+		std::deque<std::shared_ptr<Job>> jobs;
+		size_t max_jobs = 2 * pool.getThreadCount(), lines = 0;
+		bool first = true, ok = true, more = true;
+		*row_count = 0;
+		*error_line = 0;
+		while (ok && (more || !jobs.empty())) {
+			// Keep the pool busy, but do not read too far ahead.
+			while (more && jobs.size() < max_jobs) {
+				Chunk chunk;
+				if (!(more = source.next(&chunk))) break;
+				if (!delimiter) delimiter = detectDelimiter(chunk);
+				std::shared_ptr<Job> job = std::make_shared<Job>(chunk, delimiter, first);
+				jobs.push_back(job);
+				pool.submit([job](void) { job->run(); });
+				first = false;
+			}
+			if (jobs.empty()) break;
+			// Use the oldest chunk once it is parsed.
+			jobs.front()->finish();
+			const Rows &rows = jobs.front()->rows;
+			consume(rows);
+			*row_count += rows.types.size();
+			if (rows.error_line) {
+				*error_line = lines + rows.error_line;
+				ok = false;
+			}
+			lines += rows.lines;
+			jobs.pop_front();
+		}
+		// The chunks may point into the caller's memory, so the remaining jobs are
+		// claimed (or waited for) before returning.
+		for (std::shared_ptr<Job> &job : jobs) {
+			if (!job->claimed.exchange(true)) continue;
+			job->future.wait();
+		}
+		// A line which is too long is reported like an invalid row.
+		if (ok && source.lineTooLong()) *error_line = lines + 1;
+		return ok && !source.failed();
+	}
+
+	// Pass the rows to the end of a table.
+	std::function<void(const Rows &)> tableConsumer(UncertaintyTable *table) {
+		return [table](const Rows &rows) {
+			table->addRows(rows.types.data(), rows.values.data(), rows.uncertainties.data(), rows.types.size());
+		};
+	}
+
+	// Pass the rows to a chain.
+	std::function<void(const Rows &)> chainConsumer(UncertaintyChain *chain) {
+		return [chain](const Rows &rows) {
+			chain->addRows(rows.types.data(), rows.values.data(), rows.uncertainties.data(), rows.types.size());
+		};
+	}
+
+	// Run the rows of the file at path through consume, reading it in chunks or
+	// mapping it.
+	bool runFile(const char *path, bool map_file, size_t chunk_size, char delimiter, ThreadPool &pool, const std::function<void(const Rows &)> &consume, size_t *row_count, size_t *error_line) {
+		if (map_file) {
+			MappedFile file;
+			if (!file.open(path)) return false;
+			BufferSource source((const char *)file.getData(), file.getSize(), chunk_size);
+			return run(source, delimiter, pool, consume, row_count, error_line);
+		}
+		FILE *file = fopen(path, "rb");
+		if (!file) return false;
+		FileSource source(file, chunk_size);
+		bool ok = run(source, delimiter, pool, consume, row_count, error_line);
+		fclose(file);
+		return ok;
+	}
+}
+
+TableIngestor::TableIngestor(void) : delimiter_('\0'), chunk_size_(4 << 20), pool_(nullptr), map_files_(false), row_count_(0), error_line_(0) {}
+
+void TableIngestor::setDelimiter(char delimiter) {
+	delimiter_ = delimiter;
+}
+
+void TableIngestor::setChunkSize(size_t bytes) {
+	chunk_size_ = bytes ? bytes : 1;
+}
+
+void TableIngestor::setThreadPool(ThreadPool *pool) {
+	pool_ = pool;
+}
+
+void TableIngestor::setMapFiles(bool map_files) {
+	map_files_ = map_files;
+}
+
+bool TableIngestor::ingestFile(const char *path, UncertaintyTable *table) {
+	row_count_ = error_line_ = 0;
+	if (!path || !table) return false;
+	// The table is computed once, after the last row.
+	table->beginBatch();
+	bool ok = runFile(path, map_files_, chunk_size_, delimiter_, pool_ ? *pool_ : ThreadPool::global(), tableConsumer(table), &row_count_, &error_line_);
+	table->endBatch();
+	return ok;
+}
+
+bool TableIngestor::ingestBuffer(const char *data, size_t size, UncertaintyTable *table) {
+	row_count_ = error_line_ = 0;
+	if ((!data && size) || !table) return false;
+	BufferSource source(data, size, chunk_size_);
+	table->beginBatch();
+	bool ok = run(source, delimiter_, pool_ ? *pool_ : ThreadPool::global(), tableConsumer(table), &row_count_, &error_line_);
+	table->endBatch();
+	return ok;
+}
+
+bool TableIngestor::evaluateFile(const char *path, UncertaintyPair *result_dest) {
+	row_count_ = error_line_ = 0;
+	if (!path || !result_dest) return false;
+	UncertaintyChain chain;
+	bool ok = runFile(path, map_files_, chunk_size_, delimiter_, pool_ ? *pool_ : ThreadPool::global(), chainConsumer(&chain), &row_count_, &error_line_);
+	chain.getResult(result_dest);
+	return ok;
+}
+
+bool TableIngestor::evaluateBuffer(const char *data, size_t size, UncertaintyPair *result_dest) {
+	row_count_ = error_line_ = 0;
+	if ((!data && size) || !result_dest) return false;
+	BufferSource source(data, size, chunk_size_);
+	UncertaintyChain chain;
+	bool ok = run(source, delimiter_, pool_ ? *pool_ : ThreadPool::global(), chainConsumer(&chain), &row_count_, &error_line_);
+	chain.getResult(result_dest);
+	return ok;
+}
+
+size_t TableIngestor::getRowCount(void) const {
+	return row_count_;
+}
+
+size_t TableIngestor::getErrorLine(void) const {
+	return error_line_;
+}
+
+bool jp::visx::uasf::parseRow(const char *line, size_t length, char delimiter, UncertaintyTableElementType *type, double *value, double *uncertainty, bool *empty) {
+	if ((!line && length) || !delimiter || !type || !value || !uncertainty || !empty) return false;
+	return parseLine(line, line + length, delimiter, type, value, uncertainty, empty);
+}
+
+namespace {
+	const char *skipSpaces(const char *s) {
+		while (isSpace(*s)) ++s;
+		return s;
+	}
+
+	// Parse an operand of an expression ("value", "value+/-uncertainty" or
+	// "value±uncertainty"). It returns the end of the operand, or NULL if there
+	// is none.
+	const char *parseOperand(const char *s, double *value, double *uncertainty) {
+		char *end;
+		*value = strtod(s, &end);
+		if (end == s) return nullptr;
+		s = skipSpaces(end);
+		*uncertainty = 0.0;
+		if (!strncmp(s, "+/-", 3) || !strncmp(s, "\xc2\xb1", 2)) {
+			s = skipSpaces(s + (*s == '+' ? 3 : 2));
+			*uncertainty = strtod(s, &end);
+			if (end == s) return nullptr;
+			s = skipSpaces(end);
+		}
+		return s;
+	}
+}
+
+bool jp::visx::uasf::parseExpression(const char *s, std::vector<UncertaintyTableElement> *elements_dest) {
+	if (!s || !elements_dest) return false;
+	s = skipSpaces(s);
+	if (!*s || *s == '#') return true;
+	size_t old_size = elements_dest->size();
+	double value, uncertainty;
+	if (!(s = parseOperand(s, &value, &uncertainty))) return false;
+	elements_dest->emplace_back(UOPERATION_NUL, value, uncertainty);
+	while (*s) {
+		UncertaintyTableElementType type;
+		switch (*s) {
+		case '+': type = UOPERATION_ADD; break;
+		case '-': type = UOPERATION_SUB; break;
+		case '*': type = UOPERATION_MUL; break;
+		case '/': type = UOPERATION_DIV; break;
+		case '^': type = UOPERATION_POW; break;
+		default: type = UOPERATION_INVALID; break;
+		}
+		if (type == UOPERATION_INVALID || !(s = parseOperand(s + 1, &value, &uncertainty))) {
+			elements_dest->erase(elements_dest->begin() + old_size, elements_dest->end());
+			return false;
+		}
+		elements_dest->emplace_back(type, value, uncertainty);
+	}
+	return true;
+}
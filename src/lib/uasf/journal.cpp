@@ -0,0 +1,540 @@
+/* src/lib/uasf/journal.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <utility>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx::uasf;
+
+namespace {
+	const char journal_magic[8] = {'V', 'I', 'S', 'X', 'J', 'N', 'L', '\0'};
+	const u32 journal_version = 1;
+	const u32 journal_byte_order = 0x01020304;
+	// magic, version, byte order, sequence.
+	const size_t journal_header_size = 8 + 4 + 4 + 8;
+	// Every group starts with its payload size and the CRC-32 of its payload.
+	const size_t group_header_size = 4 + 4;
+
+	// The kinds of records. The setters of the starting value are recorded as
+	// setters of row zero, which do the same thing.
+	enum {
+		RECORD_ADD = 1,
+		RECORD_ADDAT,
+		RECORD_REMOVE,
+		RECORD_CLEAR,
+		RECORD_SWAP,
+		RECORD_SET1,
+		RECORD_SET2,
+		RECORD_SETUNCERTAINTY
+	};
+
+	// The lookup table of the standard (IEEE 802.3) CRC-32.
+	struct Crc32Table {
+		u32 entries[256];
+
+		Crc32Table(void) {
+			for (u32 i = 0; i < 256; ++i) {
+				u32 c = i;
+				for (int k = 0; k < 8; ++k) {
+					c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+				}
+				entries[i] = c;
+			}
+		}
+	};
+
+	u32 crc32(const u8 *data, size_t size) {
+		static const Crc32Table table;
+		u32 crc = 0xFFFFFFFF;
+		for (size_t i = 0; i < size; ++i) {
+			crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return crc ^ 0xFFFFFFFF;
+	}
+
+	// These functions wrap the file operations which differ between platforms.
+#ifdef _WIN32
+	int fileOpen(const char *path) {
+		return _open(path, _O_RDWR | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+	}
+
+	void fileClose(int fd) {
+		_close(fd);
+	}
+
+	bool fileSync(int fd) {
+		return !_commit(fd);
+	}
+
+	bool fileTruncate(int fd, u64 size) {
+		return !_chsize_s(fd, (__int64)size);
+	}
+
+	bool fileSeek(int fd, u64 offset) {
+		return _lseeki64(fd, (__int64)offset, SEEK_SET) >= 0;
+	}
+
+	long long fileWrite(int fd, const void *data, size_t size) {
+		return _write(fd, data, (unsigned int)size);
+	}
+
+	long long fileRead(int fd, void *data, size_t size) {
+		return _read(fd, data, (unsigned int)size);
+	}
+#else
+	int fileOpen(const char *path) {
+		return ::open(path, O_RDWR | O_CREAT, 0644);
+	}
+
+	void fileClose(int fd) {
+		::close(fd);
+	}
+
+	bool fileSync(int fd) {
+		return !fsync(fd);
+	}
+
+	bool fileTruncate(int fd, u64 size) {
+		return !ftruncate(fd, (off_t)size);
+	}
+
+	bool fileSeek(int fd, u64 offset) {
+		return lseek(fd, (off_t)offset, SEEK_SET) >= 0;
+	}
+
+	long long fileWrite(int fd, const void *data, size_t size) {
+		return ::write(fd, data, size);
+	}
+
+	long long fileRead(int fd, void *data, size_t size) {
+		return ::read(fd, data, size);
+	}
+#endif
+
+	bool writeAll(int fd, const u8 *data, size_t size) {
+		while (size) {
+			long long n = fileWrite(fd, data, size);
+			if (n <= 0) return false;
+			data += n;
+			size -= (size_t)n;
+		}
+		return true;
+	}
+
+	// Read the whole file into data.
+	bool readAll(int fd, std::vector<u8> *data) {
+		u8 block[65536];
+		data->clear();
+		if (!fileSeek(fd, 0)) return false;
+		for (;;) {
+			long long n = fileRead(fd, block, sizeof(block));
+			if (n < 0) return false;
+			if (!n) return true;
+			data->insert(data->end(), block, block + n);
+		}
+	}
+
+	// A cursor over the payload of a group.
+	struct Reader {
+		const u8 *data, *end;
+
+		bool getRow(u64 *row) {
+			// Rows are stored as little-endian base-128 numbers.
+			*row = 0;
+			for (int shift = 0; shift < 64; shift += 7) {
+				if (data >= end) return false;
+				u8 b = *data++;
+				*row |= (u64)(b & 0x7F) << shift;
+				if (!(b & 0x80)) return true;
+			}
+			return false;
+		}
+
+		bool getType(UncertaintyTableElementType *type) {
+			if (data >= end) return false;
+			i8 t = (i8)*data++;
+			*type = t >= UOPERATION_NUL && t < UOPERATION_INVALID ? (UncertaintyTableElementType)t : UOPERATION_INVALID;
+			return true;
+		}
+
+		bool getDouble(double *value) {
+			if ((size_t)(end - data) < sizeof(double)) return false;
+			memcpy(value, data, sizeof(double));
+			data += sizeof(double);
+			return true;
+		}
+	};
+
+	// Decode the records of one group. If table is not NULL, the records are also
+	// applied to it. It returns false if a record could not be decoded.
+	bool replayGroup(UncertaintyTable *table, const u8 *data, size_t size) {
+		Reader reader{data, data + size};
+		while (reader.data < reader.end) {
+			u8 kind = *reader.data++;
+			u64 row, row2;
+			UncertaintyTableElementType type;
+			double value, uncertainty;
+			switch (kind) {
+			case RECORD_ADD:
+				if (!reader.getType(&type) || !reader.getDouble(&value) || !reader.getDouble(&uncertainty)) return false;
+				if (table) table->add(type, value, uncertainty);
+				break;
+			case RECORD_ADDAT:
+				if (!reader.getRow(&row) || !reader.getType(&type) || !reader.getDouble(&value) || !reader.getDouble(&uncertainty)) return false;
+				if (table) table->addAt((size_t)row, type, value, uncertainty);
+				break;
+			case RECORD_REMOVE:
+				if (!reader.getRow(&row)) return false;
+				if (table) table->remove((size_t)row);
+				break;
+			case RECORD_CLEAR:
+				if (table) table->clear();
+				break;
+			case RECORD_SWAP:
+				if (!reader.getRow(&row) || !reader.getRow(&row2)) return false;
+				if (table) table->swap((size_t)row, (size_t)row2);
+				break;
+			case RECORD_SET1:
+				if (!reader.getRow(&row) || !reader.getDouble(&value)) return false;
+				if (table) table->set((size_t)row, value);
+				break;
+			case RECORD_SET2:
+				if (!reader.getRow(&row) || !reader.getDouble(&value) || !reader.getDouble(&uncertainty)) return false;
+				if (table) table->set((size_t)row, value, uncertainty);
+				break;
+			case RECORD_SETUNCERTAINTY:
+				if (!reader.getRow(&row) || !reader.getDouble(&uncertainty)) return false;
+				if (table) table->setUncertainty((size_t)row, uncertainty);
+				break;
+			default:
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+JournaledUncertaintyTable::JournaledUncertaintyTable(void) : journal_fd_(-1), sequence_(0), journal_size_(0), compaction_threshold_((u64)64 << 20), commit_threshold_(64 << 10), buffer_(group_header_size) {}
+
+JournaledUncertaintyTable::~JournaledUncertaintyTable(void) {
+	this->close();
+}
+
+bool JournaledUncertaintyTable::open(const char *snapshot_path, const char *journal_path) {
+	this->close();
+	table_.clear();
+	sequence_ = 0;
+	buffer_.resize(group_header_size);
+	if (!snapshot_path || !journal_path) return false;
+
+	// Load the snapshot, if there is one.
+	FILE *existing = fopen(snapshot_path, "rb");
+	if (existing) {
+		fclose(existing);
+		MappedUncertaintyTable snapshot;
+		if (!snapshot.open(snapshot_path) || !snapshot.copyTo(&table_)) return false;
+		sequence_ = snapshot.getSequence();
+	}
+
+	int fd = fileOpen(journal_path);
+	if (fd < 0) {
+		table_.clear();
+		return false;
+	}
+	snapshot_path_ = snapshot_path;
+	journal_path_ = journal_path;
+	journal_fd_ = fd;
+
+	std::vector<u8> journal;
+	if (!readAll(fd, &journal)) {
+		this->close();
+		table_.clear();
+		return false;
+	}
+	bool replayable = false;
+	if (journal.size() >= journal_header_size) {
+		u32 version, byte_order;
+		u64 sequence;
+		memcpy(&version, journal.data() + 8, sizeof(version));
+		memcpy(&byte_order, journal.data() + 12, sizeof(byte_order));
+		memcpy(&sequence, journal.data() + 16, sizeof(sequence));
+		// If the file is not a journal of this version, it can not be replayed.
+		if (memcmp(journal.data(), journal_magic, sizeof(journal_magic)) || version != journal_version || byte_order != journal_byte_order) {
+			this->close();
+			table_.clear();
+			return false;
+		}
+		// If the journal belongs to an older snapshot, the snapshot already contains
+		// its changes (the process stopped while compacting).
+		replayable = sequence == sequence_;
+	}
+	// Otherwise, the journal is new (or its header was never completely written).
+	if (!replayable) {
+		if (!this->resetJournal()) {
+			this->close();
+			return false;
+		}
+		return true;
+	}
+	size_t valid = this->replay(journal.data() + journal_header_size, journal.size() - journal_header_size);
+	journal_size_ = journal_header_size + valid;
+	// Drop the incomplete group at the end of the journal.
+	if (journal_size_ < journal.size()) {
+		fileTruncate(journal_fd_, journal_size_);
+		fileSync(journal_fd_);
+	}
+	return true;
+}
+
+void JournaledUncertaintyTable::close(void) {
+	if (journal_fd_ < 0) return;
+	this->commit();
+	fileClose(journal_fd_);
+	journal_fd_ = -1;
+	journal_size_ = 0;
+}
+
+bool JournaledUncertaintyTable::isOpen(void) const {
+	return journal_fd_ >= 0;
+}
+
+const UncertaintyTable &JournaledUncertaintyTable::getTable(void) const {
+	return table_;
+}
+
+void JournaledUncertaintyTable::add(UncertaintyTableElementType type, double value, double uncertainty) {
+	table_.add(type, value, uncertainty);
+	this->beginRecord(RECORD_ADD);
+	this->putType(type);
+	this->putDouble(value);
+	this->putDouble(uncertainty);
+	this->endRecord();
+}
+
+void JournaledUncertaintyTable::addAt(size_t row, UncertaintyTableElementType type, double value, double uncertainty) {
+	table_.addAt(row, type, value, uncertainty);
+	this->beginRecord(RECORD_ADDAT);
+	this->putRow(row);
+	this->putType(type);
+	this->putDouble(value);
+	this->putDouble(uncertainty);
+	this->endRecord();
+}
+
+void JournaledUncertaintyTable::remove(size_t row) {
+	table_.remove(row);
+	this->beginRecord(RECORD_REMOVE);
+	this->putRow(row);
+	this->endRecord();
+}
+
+void JournaledUncertaintyTable::clear(void) {
+	table_.clear();
+	this->beginRecord(RECORD_CLEAR);
+	this->endRecord();
+}
+
+void JournaledUncertaintyTable::swap(size_t row1, size_t row2) {
+	table_.swap(row1, row2);
+	this->beginRecord(RECORD_SWAP);
+	this->putRow(row1);
+	this->putRow(row2);
+	this->endRecord();
+}
+
+void JournaledUncertaintyTable::set(size_t row, double value) {
+	table_.set(row, value);
+	this->beginRecord(RECORD_SET1);
+	this->putRow(row);
+	this->putDouble(value);
+	this->endRecord();
+}
+
+void JournaledUncertaintyTable::set(size_t row, double value, double uncertainty) {
+	table_.set(row, value, uncertainty);
+	this->beginRecord(RECORD_SET2);
+	this->putRow(row);
+	this->putDouble(value);
+	this->putDouble(uncertainty);
+	this->endRecord();
+}
+
+void JournaledUncertaintyTable::setUncertainty(size_t row, double uncertainty) {
+	table_.setUncertainty(row, uncertainty);
+	this->beginRecord(RECORD_SETUNCERTAINTY);
+	this->putRow(row);
+	this->putDouble(uncertainty);
+	this->endRecord();
+}
+
+void JournaledUncertaintyTable::setStartingValue(double value, double uncertainty) {
+	table_.setStartingValue(value, uncertainty);
+	this->beginRecord(RECORD_SET2);
+	this->putRow(0);
+	this->putDouble(value);
+	this->putDouble(uncertainty);
+	this->endRecord();
+}
+
+void JournaledUncertaintyTable::setStartingValue(double value) {
+	table_.setStartingValue(value);
+	this->beginRecord(RECORD_SET1);
+	this->putRow(0);
+	this->putDouble(value);
+	this->endRecord();
+}
+
+void JournaledUncertaintyTable::setStartingUncertainty(double uncertainty) {
+	table_.setStartingUncertainty(uncertainty);
+	this->beginRecord(RECORD_SETUNCERTAINTY);
+	this->putRow(0);
+	this->putDouble(uncertainty);
+	this->endRecord();
+}
+
+bool JournaledUncertaintyTable::commit(void) {
+	if (journal_fd_ < 0) return false;
+	size_t payload = buffer_.size() - group_header_size;
+	if (payload) {
+		// Fill in the group header.
+		u32 size = (u32)payload, crc = crc32(buffer_.data() + group_header_size, payload);
+		memcpy(buffer_.data(), &size, sizeof(size));
+		memcpy(buffer_.data() + 4, &crc, sizeof(crc));
+		// Write the whole group with one write and one flush.
+		if (!fileSeek(journal_fd_, journal_size_) || !writeAll(journal_fd_, buffer_.data(), buffer_.size()) || !fileSync(journal_fd_)) {
+			// Remove whatever part of the group made it to the file.
+			fileTruncate(journal_fd_, journal_size_);
+			return false;
+		}
+		journal_size_ += buffer_.size();
+		buffer_.resize(group_header_size);
+	}
+	if (compaction_threshold_ && journal_size_ >= compaction_threshold_) {
+		return this->compact();
+	}
+	return true;
+}
+
+bool JournaledUncertaintyTable::compact(void) {
+	if (journal_fd_ < 0) return false;
+	// saveTable replaces the old snapshot only once the new one is written.
+	if (!saveTable(table_, snapshot_path_.c_str(), TABLEFILE_CUMULATIVES, sequence_ + 1)) return false;
+	// The snapshot now contains every change, including the pending ones.
+	++sequence_;
+	buffer_.resize(group_header_size);
+	return this->resetJournal();
+}
+
+void JournaledUncertaintyTable::setCommitThreshold(size_t bytes) {
+	commit_threshold_ = bytes;
+}
+
+void JournaledUncertaintyTable::setCompactionThreshold(u64 bytes) {
+	compaction_threshold_ = bytes;
+}
+
+u64 JournaledUncertaintyTable::getJournalSize(void) const {
+	return journal_size_;
+}
+
+size_t JournaledUncertaintyTable::getPendingSize(void) const {
+	return buffer_.size() - group_header_size;
+}
+
+void JournaledUncertaintyTable::beginRecord(u8 kind) {
+	buffer_.push_back(kind);
+}
+
+void JournaledUncertaintyTable::putRow(u64 row) {
+	// Rows are stored as little-endian base-128 numbers, so small rows take one byte.
+	while (row >= 0x80) {
+		buffer_.push_back((u8)(row | 0x80));
+		row >>= 7;
+	}
+	buffer_.push_back((u8)row);
+}
+
+void JournaledUncertaintyTable::putType(UncertaintyTableElementType type) {
+	buffer_.push_back((u8)(i8)type);
+}
+
+void JournaledUncertaintyTable::putDouble(double value) {
+	u8 bytes[sizeof(double)];
+	memcpy(bytes, &value, sizeof(double));
+	buffer_.insert(buffer_.end(), bytes, bytes + sizeof(double));
+}
+
+void JournaledUncertaintyTable::endRecord(void) {
+	// If the files are not open, there is nowhere to write the record.
+	if (journal_fd_ < 0) {
+		buffer_.resize(group_header_size);
+		return;
+	}
+	if (commit_threshold_ && this->getPendingSize() >= commit_threshold_) {
+		this->commit();
+	}
+}
+
+size_t JournaledUncertaintyTable::replay(const u8 *data, size_t size) {
+	size_t valid = 0;
+	// Apply every group in one batch, so the table is computed once.
+	table_.beginBatch();
+	while (size - valid >= group_header_size) {
+		u32 payload, crc;
+		memcpy(&payload, data + valid, sizeof(payload));
+		memcpy(&crc, data + valid + 4, sizeof(crc));
+		const u8 *group = data + valid + group_header_size;
+		// Stop at the first group which was not completely written.
+		if (payload > size - valid - group_header_size || crc32(group, payload) != crc) break;
+		// A group with a valid checksum but an unknown record was not written by
+		// this version. Check the whole group before applying any of it.
+		if (!replayGroup(nullptr, group, payload)) break;
+		replayGroup(&table_, group, payload);
+		valid += group_header_size + payload;
+	}
+	table_.endBatch();
+	return valid;
+}
+
+bool JournaledUncertaintyTable::resetJournal(void) {
+	u8 header[journal_header_size];
+	memcpy(header, journal_magic, sizeof(journal_magic));
+	memcpy(header + 8, &journal_version, sizeof(journal_version));
+	memcpy(header + 12, &journal_byte_order, sizeof(journal_byte_order));
+	memcpy(header + 16, &sequence_, sizeof(sequence_));
+	if (!fileTruncate(journal_fd_, 0) || !fileSeek(journal_fd_, 0) || !writeAll(journal_fd_, header, sizeof(header)) || !fileSync(journal_fd_)) {
+		return false;
+	}
+	journal_size_ = journal_header_size;
+	return true;
+}
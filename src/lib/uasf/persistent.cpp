@@ -0,0 +1,431 @@
+/* src/lib/uasf/persistent.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <atomic>
+#include <utility>
+#include <math.h>
+#include <string.h>
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx::uasf;
+
+struct PersistentUncertaintyTable::Node {
+	struct Row {
+		double value,
+			   uncertainty;
+		UncertaintyTableElementType type;
+	};
+
+	Node(bool is_leaf) : leaf(is_leaf), count(0), memo_valid(false) {
+		memo_lock.clear();
+	}
+
+	// This method returns the number of rows of a leaf, or of children of another
+	// node.
+	size_t size(void) const {
+		return leaf ? rows.size() : children.size();
+	}
+
+	// This method puts the cumulative after the last row into output_dest, if the
+	// node was last computed from input.
+	bool findMemo(const UncertaintyPair &input, UncertaintyPair *output_dest) const {
+		while (memo_lock.test_and_set(std::memory_order_acquire));
+		bool found = memo_valid && !memcmp(&memo_input, &input, sizeof(input));
+		if (found) *output_dest = memo_output;
+		memo_lock.clear(std::memory_order_release);
+		return found;
+	}
+
+	void setMemo(const UncertaintyPair &input, const UncertaintyPair &output) const {
+		while (memo_lock.test_and_set(std::memory_order_acquire));
+		memo_valid = true;
+		memo_input = input;
+		memo_output = output;
+		memo_lock.clear(std::memory_order_release);
+	}
+
+	const bool leaf;
+	// The number of rows under the node.
+	size_t count;
+	// The rows of a leaf, or the children of another node.
+	std::vector<Row> rows;
+	std::vector<std::shared_ptr<const Node>> children;
+	// The cumulative the node was last computed from, and the cumulative after its
+	// last row. The node is shared by every version which has it, and they may be
+	// computed by different threads, so the memo is guarded by a spin lock.
+	mutable std::atomic_flag memo_lock;
+	mutable bool memo_valid;
+	mutable UncertaintyPair memo_input,
+							memo_output;
+};
+
+namespace {
+	typedef PersistentUncertaintyTable::Node Node;
+	typedef Node::Row Row;
+	typedef std::shared_ptr<const Node> NodePointer;
+
+	// The largest and smallest number of rows of a leaf, and of children of the
+	// other nodes. Only the root may have fewer.
+	const size_t leaf_max = 64,
+				 leaf_min = leaf_max / 2,
+				 branch_max = 16,
+				 branch_min = branch_max / 2;
+
+	NodePointer makeNode(std::vector<Row> &&rows) {
+		std::shared_ptr<Node> node = std::make_shared<Node>(true);
+		node->count = rows.size();
+		node->rows = std::move(rows);
+		return node;
+	}
+
+	NodePointer makeNode(std::vector<NodePointer> &&children) {
+		std::shared_ptr<Node> node = std::make_shared<Node>(false);
+		for (const NodePointer &child : children) {
+			node->count += child->count;
+		}
+		node->children = std::move(children);
+		return node;
+	}
+
+	// Make a node of the items and append it to dest. If there are more than max
+	// items (at most twice as many), they are split between two nodes.
+	template <typename T>
+	void putNodes(std::vector<T> &&items, size_t max, std::vector<NodePointer> *dest) {
+		if (items.size() <= max) {
+			dest->push_back(makeNode(std::move(items)));
+			return;
+		}
+		auto middle = items.begin() + items.size() / 2;
+		dest->push_back(makeNode(std::vector<T>(std::make_move_iterator(items.begin()), std::make_move_iterator(middle))));
+		dest->push_back(makeNode(std::vector<T>(std::make_move_iterator(middle), std::make_move_iterator(items.end()))));
+	}
+
+	// Return the child which has the row, and make the row relative to the child. If
+	// inserting is true, the row may be one past the last row of the child.
+	size_t findChild(const Node &node, size_t *row, bool inserting) {
+		size_t i = 0;
+		for ( ; i + 1 < node.children.size(); ++i) {
+			size_t count = node.children[i]->count;
+			if (*row < count || (inserting && *row == count)) break;
+			*row -= count;
+		}
+		return i;
+	}
+
+	// Insert the row into the node, and append the new node (or nodes, if it was
+	// split) to dest.
+	void insertRow(const Node &node, size_t row, const Row &value, std::vector<NodePointer> *dest) {
+		if (node.leaf) {
+			std::vector<Row> rows;
+			rows.reserve(node.rows.size() + 1);
+			rows.insert(rows.end(), node.rows.begin(), node.rows.begin() + row);
+			rows.push_back(value);
+			rows.insert(rows.end(), node.rows.begin() + row, node.rows.end());
+			putNodes(std::move(rows), leaf_max, dest);
+			return;
+		}
+		size_t i = findChild(node, &row, true);
+		std::vector<NodePointer> children;
+		children.reserve(node.children.size() + 1);
+		children.insert(children.end(), node.children.begin(), node.children.begin() + i);
+		insertRow(*node.children[i], row, value, &children);
+		children.insert(children.end(), node.children.begin() + i + 1, node.children.end());
+		putNodes(std::move(children), branch_max, dest);
+	}
+
+	// Merge two neighbouring nodes of the same height, and append the new node (or
+	// nodes, if they had too many rows together) to dest.
+	void merge(const Node &left, const Node &right, std::vector<NodePointer> *dest) {
+		if (left.leaf) {
+			std::vector<Row> rows(left.rows);
+			rows.insert(rows.end(), right.rows.begin(), right.rows.end());
+			putNodes(std::move(rows), leaf_max, dest);
+		} else {
+			std::vector<NodePointer> children(left.children);
+			children.insert(children.end(), right.children.begin(), right.children.end());
+			putNodes(std::move(children), branch_max, dest);
+		}
+	}
+
+	// Return a copy of the node without the row. The copy may have too few rows or
+	// children; its parent merges it with a neighbour.
+	NodePointer eraseRow(const Node &node, size_t row) {
+		if (node.leaf) {
+			std::vector<Row> rows(node.rows);
+			rows.erase(rows.begin() + row);
+			return makeNode(std::move(rows));
+		}
+		size_t i = findChild(node, &row, false);
+		std::vector<NodePointer> children(node.children);
+		children[i] = eraseRow(*children[i], row);
+		if (children[i]->size() < (children[i]->leaf ? leaf_min : branch_min) && children.size() > 1) {
+			size_t left = i ? i - 1 : i;
+			std::vector<NodePointer> merged;
+			merge(*children[left], *children[left + 1], &merged);
+			children.erase(children.begin() + left, children.begin() + left + 2);
+			children.insert(children.begin() + left, merged.begin(), merged.end());
+		}
+		return makeNode(std::move(children));
+	}
+
+	// Return a copy of the node with the row replaced.
+	NodePointer replaceRow(const Node &node, size_t row, const Row &value) {
+		if (node.leaf) {
+			std::vector<Row> rows(node.rows);
+			rows[row] = value;
+			return makeNode(std::move(rows));
+		}
+		size_t i = findChild(node, &row, false);
+		std::vector<NodePointer> children(node.children);
+		children[i] = replaceRow(*children[i], row, value);
+		return makeNode(std::move(children));
+	}
+
+	const Row *findRow(const NodePointer &root, size_t row) {
+		if (row >= root->count) return nullptr;
+		const Node *node = root.get();
+		while (!node->leaf) {
+			node = node->children[findChild(*node, &row, false)].get();
+		}
+		return &node->rows[row];
+	}
+
+	// Return the cumulative after the last row of the node, starting from input.
+	UncertaintyPair evaluate(const Node &node, const UncertaintyPair &input) {
+		if (isnan(input.uncertainty) || isnan(input.value)) return input;
+		UncertaintyPair output;
+		if (node.findMemo(input, &output)) return output;
+		output = input;
+		if (node.leaf) {
+			for (const Row &row : node.rows) {
+				UncertaintyChain::step(row.type, row.value, row.uncertainty, &output);
+			}
+		} else {
+			for (const NodePointer &child : node.children) {
+				output = evaluate(*child, output);
+			}
+		}
+		node.setMemo(input, output);
+		return output;
+	}
+
+	// Build a tree of the rows, with every node as full as the others.
+	NodePointer build(std::vector<Row> &&rows) {
+		std::vector<NodePointer> level;
+		size_t leaves = (rows.size() + leaf_max - 1) / leaf_max;
+		for (size_t i = 0, begin = 0; i < leaves; ++i) {
+			size_t end = rows.size() * (i + 1) / leaves;
+			level.push_back(makeNode(std::vector<Row>(rows.begin() + begin, rows.begin() + end)));
+			begin = end;
+		}
+		while (level.size() > 1) {
+			std::vector<NodePointer> parents;
+			size_t count = (level.size() + branch_max - 1) / branch_max;
+			for (size_t i = 0, begin = 0; i < count; ++i) {
+				size_t end = level.size() * (i + 1) / count;
+				parents.push_back(makeNode(std::vector<NodePointer>(level.begin() + begin, level.begin() + end)));
+				begin = end;
+			}
+			level = std::move(parents);
+		}
+		return level.front();
+	}
+}
+
+PersistentUncertaintyTable::PersistentUncertaintyTable(void) : PersistentUncertaintyTable(0.0, 0.0) {}
+
+PersistentUncertaintyTable::PersistentUncertaintyTable(double starting_value, double starting_uncertainty) : root_(makeNode(std::vector<Row>{Row{starting_value, fabs(starting_uncertainty), UOPERATION_NUL}})) {}
+
+PersistentUncertaintyTable::PersistentUncertaintyTable(const UncertaintyTable &table) {
+	std::vector<Row> rows;
+	rows.reserve(table.count());
+	for (size_t i = 0; i < table.count(); ++i) {
+		rows.push_back(Row{table.getValue(i), table.getUncertainty(i), table.getType(i)});
+	}
+	root_ = build(std::move(rows));
+}
+
+size_t PersistentUncertaintyTable::count(void) const {
+	return root_->count;
+}
+
+UncertaintyTableElementType PersistentUncertaintyTable::getType(size_t row) const {
+	const Row *found = findRow(root_, row);
+	return found ? found->type : UOPERATION_INVALID;
+}
+
+double PersistentUncertaintyTable::getValue(size_t row) const {
+	const Row *found = findRow(root_, row);
+	return found ? found->value : NAN;
+}
+
+double PersistentUncertaintyTable::getUncertainty(size_t row) const {
+	const Row *found = findRow(root_, row);
+	return found ? found->uncertainty : NAN;
+}
+
+double PersistentUncertaintyTable::getStartingValue(void) const {
+	return this->getValue(0);
+}
+
+double PersistentUncertaintyTable::getStartingUncertainty(void) const {
+	return this->getUncertainty(0);
+}
+
+void PersistentUncertaintyTable::add(UncertaintyTableElementType type, double value, double uncertainty) {
+	this->addAt(root_->count, type, value, uncertainty);
+}
+
+void PersistentUncertaintyTable::addAt(size_t row, UncertaintyTableElementType type, double value, double uncertainty) {
+	// The first row is always the starting value.
+	if (!row) return;
+	if (row > root_->count) row = root_->count;
+	std::vector<NodePointer> nodes;
+	insertRow(*root_, row, Row{value, fabs(uncertainty), type}, &nodes);
+	root_ = nodes.size() == 1 ? nodes.front() : makeNode(std::move(nodes));
+}
+
+void PersistentUncertaintyTable::remove(size_t row) {
+	if (!row || row >= root_->count) return;
+	root_ = eraseRow(*root_, row);
+	// A root with one child is replaced by its child.
+	while (!root_->leaf && root_->children.size() == 1) {
+		root_ = root_->children.front();
+	}
+}
+
+void PersistentUncertaintyTable::set(size_t row, double value, double uncertainty) {
+	this->set(row, this->getType(row), value, uncertainty);
+}
+
+void PersistentUncertaintyTable::set(size_t row, UncertaintyTableElementType type, double value, double uncertainty) {
+	if (row >= root_->count) return;
+	// The first row is always NUL.
+	if (!row) type = UOPERATION_NUL;
+	root_ = replaceRow(*root_, row, Row{value, fabs(uncertainty), type});
+}
+
+void PersistentUncertaintyTable::setStartingValue(double value, double uncertainty) {
+	this->set(0, UOPERATION_NUL, value, uncertainty);
+}
+
+double PersistentUncertaintyTable::getResult(void) const {
+	return evaluate(*root_, UncertaintyPair{0.0, 0.0}).value;
+}
+
+void PersistentUncertaintyTable::getResult(UncertaintyPair *result_dest) const {
+	if (!result_dest) return;
+	*result_dest = evaluate(*root_, UncertaintyPair{0.0, 0.0});
+}
+
+double PersistentUncertaintyTable::getResultingUncertainty(void) const {
+	return evaluate(*root_, UncertaintyPair{0.0, 0.0}).uncertainty;
+}
+
+UncertaintyTableElement PersistentUncertaintyTable::getElement(size_t row) const {
+	if (row >= root_->count) return UncertaintyTableElement::invalid_element;
+	// Compute the nodes before the row, which are usually remembered.
+	UncertaintyPair cumulative{0.0, 0.0};
+	const Node *node = root_.get();
+	while (!node->leaf) {
+		size_t i = 0;
+		for ( ; row >= node->children[i]->count; ++i) {
+			cumulative = evaluate(*node->children[i], cumulative);
+			row -= node->children[i]->count;
+		}
+		node = node->children[i].get();
+	}
+	for (size_t i = 0; i < row; ++i) {
+		UncertaintyChain::step(node->rows[i].type, node->rows[i].value, node->rows[i].uncertainty, &cumulative);
+	}
+	const Row &found = node->rows[row];
+	return UncertaintyTableElement{found.type, found.value, found.uncertainty, cumulative.value, cumulative.uncertainty};
+}
+
+void PersistentUncertaintyTable::toTable(UncertaintyTable *table) const {
+	if (!table) return;
+	std::vector<UncertaintyTableElement> elements;
+	elements.reserve(root_->count);
+	// Visit the leaves in order.
+	std::vector<std::pair<const Node *, size_t>> stack{{root_.get(), 0}};
+	while (!stack.empty()) {
+		const Node *node = stack.back().first;
+		if (node->leaf) {
+			for (const Row &row : node->rows) {
+				elements.emplace_back(row.type, row.value, row.uncertainty);
+			}
+			stack.pop_back();
+		} else if (stack.back().second < node->children.size()) {
+			stack.emplace_back(node->children[stack.back().second++].get(), 0);
+		} else {
+			stack.pop_back();
+		}
+	}
+	table->assign(std::move(elements), false);
+}
+
+bool PersistentUncertaintyTable::isSameVersion(const PersistentUncertaintyTable &other) const {
+	return root_ == other.root_;
+}
+
+UncertaintyTableHistory::UncertaintyTableHistory(void) {}
+
+UncertaintyTableHistory::UncertaintyTableHistory(const PersistentUncertaintyTable &table) : current_(table) {}
+
+const PersistentUncertaintyTable &UncertaintyTableHistory::getCurrent(void) const {
+	return current_;
+}
+
+void UncertaintyTableHistory::commit(const PersistentUncertaintyTable &table) {
+	undo_.push_back(current_);
+	current_ = table;
+	redo_.clear();
+}
+
+bool UncertaintyTableHistory::undo(void) {
+	if (undo_.empty()) return false;
+	redo_.push_back(std::move(current_));
+	current_ = std::move(undo_.back());
+	undo_.pop_back();
+	return true;
+}
+
+bool UncertaintyTableHistory::redo(void) {
+	if (redo_.empty()) return false;
+	undo_.push_back(std::move(current_));
+	current_ = std::move(redo_.back());
+	redo_.pop_back();
+	return true;
+}
+
+bool UncertaintyTableHistory::canUndo(void) const {
+	return !undo_.empty();
+}
+
+bool UncertaintyTableHistory::canRedo(void) const {
+	return !redo_.empty();
+}
+
+void UncertaintyTableHistory::clear(void) {
+	undo_.clear();
+	redo_.clear();
+}
@@ -0,0 +1,381 @@
+/* src/lib/uasf/quantiles.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <algorithm>
+#include <math.h>
+#include <utility>
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+namespace {
+	// The smallest capacity of a level, and the ratio of the capacities of two
+	// levels.
+	const size_t min_capacity = 8;
+	const double capacity_ratio = 2.0 / 3.0;
+
+	// The most parts a stream is split into by sketch and sketchRowSets, and the
+	// fewest values or sets in a part.
+	const size_t max_parts = 64,
+				 min_part_size = 1 << 12;
+
+	// A step of the SplitMix64 generator.
+	inline u64 nextRandom(u64 *state) {
+		u64 x = (*state += 0x9E3779B97F4A7C15ULL);
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+		return x ^ (x >> 31);
+	}
+
+	// Split count elements into parts for the pool. It returns the size of a
+	// part.
+	size_t partSize(size_t count) {
+		size_t parts = (count + min_part_size - 1) / min_part_size;
+		if (parts > max_parts) parts = max_parts;
+		if (!parts) parts = 1;
+		return (count + parts - 1) / parts;
+	}
+}
+
+const size_t QuantileSketch::default_k;
+
+QuantileSketch::QuantileSketch(size_t k, u64 seed) : k_(k < min_capacity ? min_capacity : k), state_(seed), levels_(1) {
+	this->reset();
+}
+
+void QuantileSketch::add(double value) {
+	if (isnan(value)) {
+		++nan_count_;
+		return;
+	}
+	++count_;
+	if (value < min_) min_ = value;
+	if (value > max_) max_ = value;
+	levels_[0].push_back(value);
+	if (++retained_ >= max_retained_) this->compress();
+}
+
+void QuantileSketch::add(const double *values, size_t count) {
+	if (!values) return;
+	for (size_t i = 0; i < count; ++i) {
+		this->add(values[i]);
+	}
+}
+
+void QuantileSketch::merge(const QuantileSketch &other) {
+	if (&other == this) {
+		QuantileSketch copy(other);
+		this->merge(copy);
+		return;
+	}
+	count_ += other.count_;
+	nan_count_ += other.nan_count_;
+	if (other.min_ < min_) min_ = other.min_;
+	if (other.max_ > max_) max_ = other.max_;
+	if (other.levels_.size() > levels_.size()) levels_.resize(other.levels_.size());
+	for (size_t h = 0; h < other.levels_.size(); ++h) {
+		std::vector<double> &level = levels_[h];
+		size_t size = level.size();
+		level.insert(level.end(), other.levels_[h].begin(), other.levels_[h].end());
+		if (h) std::inplace_merge(level.begin(), level.begin() + size, level.end());
+	}
+	retained_ += other.retained_;
+	this->updateCapacities();
+	if (retained_ >= max_retained_) this->compress();
+}
+
+void QuantileSketch::reset(void) {
+	count_ = 0;
+	nan_count_ = 0;
+	min_ = INFINITY;
+	max_ = -INFINITY;
+	levels_.assign(1, std::vector<double>());
+	retained_ = 0;
+	this->updateCapacities();
+}
+
+size_t QuantileSketch::getK(void) const {
+	return k_;
+}
+
+u64 QuantileSketch::count(void) const {
+	return count_;
+}
+
+u64 QuantileSketch::countNaN(void) const {
+	return nan_count_;
+}
+
+size_t QuantileSketch::getRetained(void) const {
+	return retained_;
+}
+
+double QuantileSketch::getMin(void) const {
+	return count_ ? min_ : NAN;
+}
+
+double QuantileSketch::getMax(void) const {
+	return count_ ? max_ : NAN;
+}
+
+double QuantileSketch::getQuantile(double q) const {
+	double quantile;
+	this->getQuantiles(&q, 1, &quantile);
+	return quantile;
+}
+
+void QuantileSketch::getQuantiles(const double *qs, size_t count, double *quantiles_dest) const {
+	if (!qs || !quantiles_dest) return;
+	std::vector<double> values;
+	std::vector<u64> weights;
+	if (count_) this->sortedView(&values, &weights);
+	for (size_t i = 0; i < count; ++i) {
+		double q = qs[i];
+		if (!count_ || !(q >= 0.0 && q <= 1.0)) {
+			quantiles_dest[i] = NAN;
+		} else if (q == 0.0) {
+			quantiles_dest[i] = min_;
+		} else if (q == 1.0) {
+			quantiles_dest[i] = max_;
+		} else {
+			// The first value whose cumulative weight reaches the rank.
+			double rank = q * count_;
+			size_t j = std::lower_bound(weights.begin(), weights.end(), rank, [](u64 weight, double rank) {
+				return weight < rank;
+			}) - weights.begin();
+			quantiles_dest[i] = values[j < values.size() ? j : values.size() - 1];
+		}
+	}
+}
+
+double QuantileSketch::getRank(double value) const {
+	if (!count_ || isnan(value)) return NAN;
+	u64 weight = 0;
+	for (size_t h = 0; h < levels_.size(); ++h) {
+		for (double x : levels_[h]) {
+			if (x <= value) weight += (u64)1 << h;
+		}
+	}
+	return (double)weight / count_;
+}
+
+double QuantileSketch::getRankError(void) const {
+	return 2.296 / pow((double)k_, 0.9723);
+}
+
+QuantileSketch QuantileSketch::sketch(const double *values, size_t count, size_t k, ThreadPool *pool) {
+	QuantileSketch sketch(k);
+	if (!values) return sketch;
+	size_t part_size = partSize(count);
+	if (count <= part_size) {
+		sketch.add(values, count);
+		return sketch;
+	}
+	// Every part has a sketch with its own seed, and they are merged in order.
+	std::vector<QuantileSketch> parts;
+	for (size_t i = 0; i * part_size < count; ++i) {
+		parts.emplace_back(k, i + 1);
+	}
+	if (!pool) pool = &ThreadPool::global();
+	pool->parallelFor(count, part_size, [&](size_t begin, size_t end) {
+		parts[begin / part_size].add(values + begin, end - begin);
+	});
+	for (const QuantileSketch &part : parts) {
+		sketch.merge(part);
+	}
+	return sketch;
+}
+
+void QuantileSketch::updateCapacities(void) {
+	capacities_.resize(levels_.size());
+	max_retained_ = 0;
+	for (size_t h = 0; h < levels_.size(); ++h) {
+		size_t depth = levels_.size() - 1 - h, capacity = (size_t)ceil(k_ * pow(capacity_ratio, (double)depth));
+		capacities_[h] = capacity < min_capacity ? min_capacity : capacity;
+		max_retained_ += capacities_[h];
+	}
+}
+
+void QuantileSketch::compress(void) {
+	while (retained_ >= max_retained_) {
+		// Since the sketch holds at least the sum of the capacities, a level is full.
+		size_t h = 0;
+		while (levels_[h].size() < capacities_[h]) ++h;
+		if (h + 1 == levels_.size()) {
+			levels_.emplace_back();
+			this->updateCapacities();
+		}
+		std::vector<double> &level = levels_[h], &above = levels_[h + 1];
+		// The levels above the first are kept sorted, so only the first is sorted
+		// here, and the values moved up are merged with the level above.
+		if (!h) std::sort(level.begin(), level.end());
+		// With an odd number of values, the lowest stays on the level.
+		size_t kept = level.size() & 1, moved = (level.size() - kept) / 2;
+		merged_.resize(above.size() + moved);
+		double *out = merged_.data();
+		const double *a = above.data(), *a_end = a + above.size();
+		for (size_t i = kept + (nextRandom(&state_) >> 63); i < level.size(); i += 2) {
+			while (a != a_end && *a < level[i]) *out++ = *a++;
+			*out++ = level[i];
+		}
+		while (a != a_end) *out++ = *a++;
+		above.swap(merged_);
+		level.resize(kept);
+		retained_ -= moved;
+	}
+}
+
+void QuantileSketch::sortedView(std::vector<double> *values_dest, std::vector<u64> *weights_dest) const {
+	std::vector<std::pair<double, u64>> items;
+	items.reserve(retained_);
+	for (size_t h = 0; h < levels_.size(); ++h) {
+		for (double x : levels_[h]) items.emplace_back(x, (u64)1 << h);
+	}
+	std::sort(items.begin(), items.end(), [](const std::pair<double, u64> &a, const std::pair<double, u64> &b) {
+		return a.first < b.first;
+	});
+	values_dest->resize(items.size());
+	weights_dest->resize(items.size());
+	u64 weight = 0;
+	for (size_t i = 0; i < items.size(); ++i) {
+		weight += items[i].second;
+		(*values_dest)[i] = items[i].first;
+		(*weights_dest)[i] = weight;
+	}
+}
+
+void jp::visx::uasf::sketchRowSets(const UncertaintyTableElementType *types, const double *values, const double *uncertainties, const size_t *counts, size_t set_count, QuantileSketch *values_dest, QuantileSketch *uncertainties_dest, ResultCache *cache, ThreadPool *pool) {
+	if (!set_count || !counts || (!values_dest && !uncertainties_dest)) return;
+	std::vector<size_t> offsets;
+	if (!findRowSetOffsets(types, values, uncertainties, counts, set_count, &offsets)) return;
+	size_t part_size = partSize(set_count);
+	std::vector<QuantileSketch> value_parts, uncertainty_parts;
+	for (size_t i = 0; i * part_size < set_count; ++i) {
+		value_parts.emplace_back(values_dest ? values_dest->getK() : QuantileSketch::default_k, 2 * i + 1);
+		uncertainty_parts.emplace_back(uncertainties_dest ? uncertainties_dest->getK() : QuantileSketch::default_k, 2 * i + 2);
+	}
+	auto evaluate = [&](size_t begin, size_t end) {
+		QuantileSketch &value_part = value_parts[begin / part_size], &uncertainty_part = uncertainty_parts[begin / part_size];
+		for (size_t i = begin; i < end; ++i) {
+			size_t o = offsets[i];
+			UncertaintyPair result;
+			evaluateRows(types + o, values + o, uncertainties + o, counts[i], &result, cache);
+			if (values_dest) value_part.add(result.value);
+			if (uncertainties_dest) uncertainty_part.add(result.uncertainty);
+		}
+	};
+	if (value_parts.size() == 1) {
+		evaluate(0, set_count);
+	} else {
+		if (!pool) pool = &ThreadPool::global();
+		pool->parallelFor(set_count, part_size, evaluate);
+	}
+	for (size_t i = 0; i < value_parts.size(); ++i) {
+		if (values_dest) values_dest->merge(value_parts[i]);
+		if (uncertainties_dest) uncertainties_dest->merge(uncertainty_parts[i]);
+	}
+}
+
+// If want C compatibility.
+// Also works: set CMake value JP_CCOMPAT to true.
+#ifdef JP_CCOMPAT
+
+#include <jp/visx/uasf/elementtype.h>
+
+extern "C" QuantileSketch *jp_visx_uasf_QuantileSketch_new(size_t k);
+extern "C" void jp_visx_uasf_QuantileSketch_add(QuantileSketch *sketch, double value);
+extern "C" void jp_visx_uasf_QuantileSketch_addValues(QuantileSketch *sketch, const double *values, size_t count);
+extern "C" void jp_visx_uasf_QuantileSketch_merge(QuantileSketch *sketch, QuantileSketch *other);
+extern "C" void jp_visx_uasf_QuantileSketch_reset(QuantileSketch *sketch);
+extern "C" u64 jp_visx_uasf_QuantileSketch_count(QuantileSketch *sketch);
+extern "C" double jp_visx_uasf_QuantileSketch_getMin(QuantileSketch *sketch);
+extern "C" double jp_visx_uasf_QuantileSketch_getMax(QuantileSketch *sketch);
+extern "C" double jp_visx_uasf_QuantileSketch_getQuantile(QuantileSketch *sketch, double q);
+extern "C" void jp_visx_uasf_QuantileSketch_getQuantiles(QuantileSketch *sketch, const double *qs, size_t count, double *quantiles_dest);
+extern "C" double jp_visx_uasf_QuantileSketch_getRank(QuantileSketch *sketch, double value);
+extern "C" double jp_visx_uasf_QuantileSketch_getRankError(QuantileSketch *sketch);
+extern "C" void jp_visx_uasf_QuantileSketch_free(QuantileSketch *sketch);
+extern "C" void jp_visx_uasf_sketchRowSets(const jp_visx_uasf_UncertaintyTableElementType *types, const double *values, const double *uncertainties, const size_t *counts, size_t set_count, QuantileSketch *values_dest, QuantileSketch *uncertainties_dest);
+
+QuantileSketch *jp_visx_uasf_QuantileSketch_new(size_t k) {
+	return new QuantileSketch(k ? k : QuantileSketch::default_k);
+}
+
+void jp_visx_uasf_QuantileSketch_add(QuantileSketch *sketch, double value) {
+	sketch->add(value);
+}
+
+void jp_visx_uasf_QuantileSketch_addValues(QuantileSketch *sketch, const double *values, size_t count) {
+	sketch->add(values, count);
+}
+
+void jp_visx_uasf_QuantileSketch_merge(QuantileSketch *sketch, QuantileSketch *other) {
+	sketch->merge(*other);
+}
+
+void jp_visx_uasf_QuantileSketch_reset(QuantileSketch *sketch) {
+	sketch->reset();
+}
+
+u64 jp_visx_uasf_QuantileSketch_count(QuantileSketch *sketch) {
+	return sketch->count();
+}
+
+double jp_visx_uasf_QuantileSketch_getMin(QuantileSketch *sketch) {
+	return sketch->getMin();
+}
+
+double jp_visx_uasf_QuantileSketch_getMax(QuantileSketch *sketch) {
+	return sketch->getMax();
+}
+
+double jp_visx_uasf_QuantileSketch_getQuantile(QuantileSketch *sketch, double q) {
+	return sketch->getQuantile(q);
+}
+
+void jp_visx_uasf_QuantileSketch_getQuantiles(QuantileSketch *sketch, const double *qs, size_t count, double *quantiles_dest) {
+	sketch->getQuantiles(qs, count, quantiles_dest);
+}
+
+double jp_visx_uasf_QuantileSketch_getRank(QuantileSketch *sketch, double value) {
+	return sketch->getRank(value);
+}
+
+double jp_visx_uasf_QuantileSketch_getRankError(QuantileSketch *sketch) {
+	return sketch->getRankError();
+}
+
+void jp_visx_uasf_QuantileSketch_free(QuantileSketch *sketch) {
+	delete sketch;
+}
+
+void jp_visx_uasf_sketchRowSets(const jp_visx_uasf_UncertaintyTableElementType *types, const double *values, const double *uncertainties, const size_t *counts, size_t set_count, QuantileSketch *values_dest, QuantileSketch *uncertainties_dest) {
+	// The types are converted one by one (see getOperation).
+	size_t count = 0;
+	for (size_t i = 0; counts && i < set_count; ++i) count += counts[i];
+	std::vector<UncertaintyTableElementType> operations(types ? count : 0);
+	for (size_t i = 0; i < operations.size(); ++i) operations[i] = getOperation(types[i]);
+	sketchRowSets(types ? operations.data() : nullptr, values, uncertainties, counts, set_count, values_dest, uncertainties_dest, &ResultCache::global());
+}
+
+#endif
@@ -0,0 +1,324 @@
+/* src/lib/uasf/resultcache.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <string.h>
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+namespace {
+	// The seed of the second hash of a key.
+	const u64 check_seed = 0x5649535843414348ULL;
+
+	// The bytes used by an entry, with its place in the index.
+	const size_t entry_size = sizeof(UncertaintyPair) + sizeof(ResultKey) + 8 + 48;
+
+	// The number of sets of rows evaluated by a task of evaluateRowSets.
+	const size_t set_block_size = 64;
+
+	bool sameKey(const ResultKey &a, const ResultKey &b) {
+		return a.hash == b.hash && a.check == b.check && a.count == b.count;
+	}
+
+	// Hash rows given by a function which returns the type, value and uncertainty
+	// of a row.
+	template <typename F>
+	ResultKey hash(size_t count, const F &row) {
+		XxHash64 hash, check(check_seed);
+		// Every row is hashed as three words. The rows are hashed in blocks.
+		u64 block[3 * 64];
+		for (size_t i = 0; i < count; ) {
+			size_t n = 0;
+			for ( ; n < 64 && i < count; ++n, ++i) {
+				UncertaintyTableElementType type;
+				double value, uncertainty;
+				row(i, &type, &value, &uncertainty);
+				// The table keeps the absolute value of the uncertainty.
+				uncertainty = fabs(uncertainty);
+				block[3 * n] = (u64)(i64)type;
+				memcpy(&block[3 * n + 1], &value, 8);
+				memcpy(&block[3 * n + 2], &uncertainty, 8);
+			}
+			hash.update(block, 24 * n);
+			check.update(block, 24 * n);
+		}
+		return ResultKey{hash.digest(), check.digest(), (u64)count};
+	}
+}
+
+ResultCache::ResultCache(size_t budget) : hand_(0), budget_(0), capacity_(0), hits_(0), misses_(0), evictions_(0) {
+	this->setBudget(budget);
+}
+
+void ResultCache::setBudget(size_t bytes) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	budget_ = bytes;
+	capacity_ = bytes / entry_size;
+	this->shrink();
+}
+
+size_t ResultCache::getBudget(void) const {
+	return budget_;
+}
+
+bool ResultCache::isEnabled(void) const {
+	return capacity_.load(std::memory_order_relaxed) != 0;
+}
+
+bool ResultCache::find(const ResultKey &key, UncertaintyPair *result_dest) {
+	if (!this->isEnabled()) return false;
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = index_.find(key.hash);
+	if (it == index_.end() || !sameKey(entries_[it->second].key, key)) {
+		++misses_;
+		return false;
+	}
+	Entry &entry = entries_[it->second];
+	entry.referenced = true;
+	if (result_dest) *result_dest = entry.result;
+	++hits_;
+	return true;
+}
+
+void ResultCache::insert(const ResultKey &key, const UncertaintyPair &result) {
+	if (!this->isEnabled() || isnan(result.value) || isnan(result.uncertainty)) return;
+	std::lock_guard<std::mutex> lock(mutex_);
+	// The capacity may have changed since it was checked.
+	size_t capacity = capacity_;
+	if (!capacity) return;
+	auto it = index_.find(key.hash);
+	if (it != index_.end()) {
+		// Replace the entry with the same hash (which may have a different key).
+		entries_[it->second] = Entry{key, result, true};
+		return;
+	}
+	if (entries_.size() < capacity) {
+		index_[key.hash] = entries_.size();
+		entries_.push_back(Entry{key, result, false});
+		return;
+	}
+	// Move the clock hand to the first entry which was not used since the hand
+	// last passed it, and replace that entry.
+	for (;;) {
+		if (hand_ >= entries_.size()) hand_ = 0;
+		Entry &entry = entries_[hand_];
+		if (!entry.referenced) break;
+		entry.referenced = false;
+		++hand_;
+	}
+	index_.erase(entries_[hand_].key.hash);
+	entries_[hand_] = Entry{key, result, false};
+	index_[key.hash] = hand_++;
+	++evictions_;
+}
+
+void ResultCache::clear(void) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	entries_.clear();
+	index_.clear();
+	hand_ = 0;
+}
+
+size_t ResultCache::count(void) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return entries_.size();
+}
+
+u64 ResultCache::getHits(void) const {
+	return hits_;
+}
+
+u64 ResultCache::getMisses(void) const {
+	return misses_;
+}
+
+u64 ResultCache::getEvictions(void) const {
+	return evictions_;
+}
+
+void ResultCache::resetCounters(void) {
+	hits_ = 0;
+	misses_ = 0;
+	evictions_ = 0;
+}
+
+ResultCache &ResultCache::global(void) {
+	static ResultCache cache;
+	return cache;
+}
+
+ResultKey ResultCache::hashRows(const UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count) {
+	return hash(count, [types, values, uncertainties](size_t i, UncertaintyTableElementType *type, double *value, double *uncertainty) {
+		*type = types[i];
+		*value = values[i];
+		*uncertainty = uncertainties[i];
+	});
+}
+
+ResultKey ResultCache::hashTable(const UncertaintyTable &table) {
+	// The rows are read without getElement, which would compute the cumulatives.
+	return hash(table.count(), [&table](size_t i, UncertaintyTableElementType *type, double *value, double *uncertainty) {
+		*type = table.getType(i);
+		*value = table.getValue(i);
+		*uncertainty = table.getUncertainty(i);
+	});
+}
+
+void ResultCache::shrink(void) {
+	size_t capacity = capacity_;
+	if (entries_.size() <= capacity) return;
+	evictions_ += entries_.size() - capacity;
+	// The entries past the capacity are removed. The order of the entries does
+	// not matter.
+	for (size_t i = capacity; i < entries_.size(); ++i) {
+		index_.erase(entries_[i].key.hash);
+	}
+	entries_.resize(capacity);
+	hand_ = 0;
+}
+
+void jp::visx::uasf::evaluateRows(const UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count, UncertaintyPair *result_dest, ResultCache *cache) {
+	if (!result_dest || (count && (!types || !values || !uncertainties))) return;
+	ResultKey key;
+	if (cache && cache->isEnabled()) {
+		key = ResultCache::hashRows(types, values, uncertainties, count);
+		if (cache->find(key, result_dest)) return;
+	} else {
+		cache = nullptr;
+	}
+	UncertaintyChain chain;
+	for (size_t i = 0; i < count; ++i) {
+		chain.add(types[i], values[i], uncertainties[i]);
+	}
+	chain.getResult(result_dest);
+	if (cache) cache->insert(key, *result_dest);
+}
+
+bool jp::visx::uasf::findRowSetOffsets(const UncertaintyTableElementType *types, const double *values, const double *uncertainties, const size_t *counts, size_t set_count, std::vector<size_t> *offsets_dest) {
+	offsets_dest->resize(set_count);
+	size_t offset = 0;
+	for (size_t i = 0; i < set_count; ++i) {
+		(*offsets_dest)[i] = offset;
+		offset += counts[i];
+	}
+	return !offset || (types && values && uncertainties);
+}
+
+void jp::visx::uasf::evaluateRowSets(const UncertaintyTableElementType *types, const double *values, const double *uncertainties, const size_t *counts, size_t set_count, UncertaintyPair *results_dest, ResultCache *cache, ThreadPool *pool) {
+	if (!set_count || !counts || !results_dest) return;
+	std::vector<size_t> offsets;
+	if (!findRowSetOffsets(types, values, uncertainties, counts, set_count, &offsets)) return;
+	auto evaluate = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			size_t o = offsets[i];
+			evaluateRows(types + o, values + o, uncertainties + o, counts[i], &results_dest[i], cache);
+		}
+	};
+	if (set_count <= set_block_size) {
+		evaluate(0, set_count);
+		return;
+	}
+	if (!pool) pool = &ThreadPool::global();
+	pool->parallelFor(set_count, set_block_size, evaluate);
+}
+
+// If want C compatibility.
+// Also works: set CMake value JP_CCOMPAT to true.
+#ifdef JP_CCOMPAT
+
+#include <jp/visx/uasf/elementtype.h>
+
+namespace {
+	// This function converts count types of the C API (see getOperation). It
+	// returns no types if types is NULL.
+	std::vector<UncertaintyTableElementType> getOperations(const jp_visx_uasf_UncertaintyTableElementType *types, size_t count) {
+		std::vector<UncertaintyTableElementType> operations(types ? count : 0);
+		for (size_t i = 0; i < operations.size(); ++i) operations[i] = getOperation(types[i]);
+		return operations;
+	}
+}
+
+extern "C" void jp_visx_uasf_ResultCache_setBudget(size_t bytes);
+extern "C" size_t jp_visx_uasf_ResultCache_getBudget(void);
+extern "C" size_t jp_visx_uasf_ResultCache_count(void);
+extern "C" u64 jp_visx_uasf_ResultCache_getHits(void);
+extern "C" u64 jp_visx_uasf_ResultCache_getMisses(void);
+extern "C" u64 jp_visx_uasf_ResultCache_getEvictions(void);
+extern "C" void jp_visx_uasf_ResultCache_resetCounters(void);
+extern "C" void jp_visx_uasf_ResultCache_clear(void);
+extern "C" void jp_visx_uasf_evaluateRows(const jp_visx_uasf_UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count, double *value_dest, double *uncertainty_dest);
+extern "C" void jp_visx_uasf_evaluateRowSets(const jp_visx_uasf_UncertaintyTableElementType *types, const double *values, const double *uncertainties, const size_t *counts, size_t set_count, double *values_dest, double *uncertainties_dest);
+
+void jp_visx_uasf_ResultCache_setBudget(size_t bytes) {
+	ResultCache::global().setBudget(bytes);
+}
+
+size_t jp_visx_uasf_ResultCache_getBudget(void) {
+	return ResultCache::global().getBudget();
+}
+
+size_t jp_visx_uasf_ResultCache_count(void) {
+	return ResultCache::global().count();
+}
+
+u64 jp_visx_uasf_ResultCache_getHits(void) {
+	return ResultCache::global().getHits();
+}
+
+u64 jp_visx_uasf_ResultCache_getMisses(void) {
+	return ResultCache::global().getMisses();
+}
+
+u64 jp_visx_uasf_ResultCache_getEvictions(void) {
+	return ResultCache::global().getEvictions();
+}
+
+void jp_visx_uasf_ResultCache_resetCounters(void) {
+	ResultCache::global().resetCounters();
+}
+
+void jp_visx_uasf_ResultCache_clear(void) {
+	ResultCache::global().clear();
+}
+
+void jp_visx_uasf_evaluateRows(const jp_visx_uasf_UncertaintyTableElementType *types, const double *values, const double *uncertainties, size_t count, double *value_dest, double *uncertainty_dest) {
+	UncertaintyPair result{NAN, NAN};
+	std::vector<UncertaintyTableElementType> operations = getOperations(types, count);
+	evaluateRows(types ? operations.data() : nullptr, values, uncertainties, count, &result, &ResultCache::global());
+	if (value_dest) *value_dest = result.value;
+	if (uncertainty_dest) *uncertainty_dest = result.uncertainty;
+}
+
+void jp_visx_uasf_evaluateRowSets(const jp_visx_uasf_UncertaintyTableElementType *types, const double *values, const double *uncertainties, const size_t *counts, size_t set_count, double *values_dest, double *uncertainties_dest) {
+	std::vector<UncertaintyPair> results(set_count, UncertaintyPair{NAN, NAN});
+	size_t count = 0;
+	for (size_t i = 0; counts && i < set_count; ++i) count += counts[i];
+	std::vector<UncertaintyTableElementType> operations = getOperations(types, count);
+	evaluateRowSets(types ? operations.data() : nullptr, values, uncertainties, counts, set_count, results.data(), &ResultCache::global());
+	for (size_t i = 0; i < set_count; ++i) {
+		if (values_dest) values_dest[i] = results[i].value;
+		if (uncertainties_dest) uncertainties_dest[i] = results[i].uncertainty;
+	}
+}
+
+#endif
@@ -0,0 +1,261 @@
+/* src/lib/uasf/statistics.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <jp/visx.hpp>
+#include <math.h>
+#include <vector>
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+namespace {
+	// The number of readings of a block of add, which stays in the cache between
+	// its two passes, and the number of lanes its sums are computed in.
+	const size_t block_size = 256,
+				 lanes = 4;
+
+	// The number of readings added by a task of accumulate.
+	const size_t parallel_block_size = 1 << 16;
+}
+
+MeasurementAccumulator::MeasurementAccumulator(void) {
+	this->reset();
+}
+
+void MeasurementAccumulator::add(double value) {
+	// Welford's update.
+	++count_;
+	double delta = value - mean_;
+	mean_ += delta / count_;
+	m2_ += delta * (value - mean_);
+	min_ = fmin(min_, value);
+	max_ = fmax(max_, value);
+}
+
+void MeasurementAccumulator::add(const double *values, size_t count) {
+	if (!values) return;
+	for (size_t begin = 0; begin < count; begin += block_size) {
+		const double *x = values + begin;
+		size_t n = count - begin < block_size ? count - begin : block_size, i;
+		// The mean of the block.
+		double sum[lanes] = {0.0, 0.0, 0.0, 0.0};
+		for (i = 0; i + lanes <= n; i += lanes) {
+			for (size_t l = 0; l < lanes; ++l) sum[l] += x[i + l];
+		}
+		double total = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+		for ( ; i < n; ++i) total += x[i];
+		double mean = total / n;
+		// The squared deviations from it, and the extremes. The comparisons leave
+		// NaN out, like fmin and fmax, but can be vectorized.
+		double m2[lanes] = {0.0, 0.0, 0.0, 0.0},
+			   low[lanes] = {INFINITY, INFINITY, INFINITY, INFINITY},
+			   high[lanes] = {-INFINITY, -INFINITY, -INFINITY, -INFINITY};
+		for (i = 0; i + lanes <= n; i += lanes) {
+			for (size_t l = 0; l < lanes; ++l) {
+				double d = x[i + l] - mean;
+				m2[l] += d * d;
+				low[l] = x[i + l] < low[l] ? x[i + l] : low[l];
+				high[l] = x[i + l] > high[l] ? x[i + l] : high[l];
+			}
+		}
+		MeasurementAccumulator block;
+		block.count_ = n;
+		block.mean_ = mean;
+		block.m2_ = (m2[0] + m2[1]) + (m2[2] + m2[3]);
+		block.min_ = fmin(fmin(low[0], low[1]), fmin(low[2], low[3]));
+		block.max_ = fmax(fmax(high[0], high[1]), fmax(high[2], high[3]));
+		for ( ; i < n; ++i) {
+			double d = x[i] - mean;
+			block.m2_ += d * d;
+			block.min_ = x[i] < block.min_ ? x[i] : block.min_;
+			block.max_ = x[i] > block.max_ ? x[i] : block.max_;
+		}
+		// If every reading was NaN, there is no extreme.
+		if (block.min_ > block.max_) block.min_ = block.max_ = NAN;
+		this->merge(block);
+	}
+}
+
+void MeasurementAccumulator::merge(const MeasurementAccumulator &other) {
+	if (!other.count_) return;
+	if (!count_) {
+		*this = other;
+		return;
+	}
+	// The formulas of Chan et al. for the union of two sets.
+	u64 count = count_ + other.count_;
+	double delta = other.mean_ - mean_;
+	mean_ += delta * ((double)other.count_ / count);
+	m2_ += other.m2_ + delta * delta * ((double)count_ * other.count_ / count);
+	count_ = count;
+	min_ = fmin(min_, other.min_);
+	max_ = fmax(max_, other.max_);
+}
+
+void MeasurementAccumulator::reset(void) {
+	count_ = 0;
+	mean_ = 0.0;
+	m2_ = 0.0;
+	min_ = NAN;
+	max_ = NAN;
+}
+
+u64 MeasurementAccumulator::count(void) const {
+	return count_;
+}
+
+double MeasurementAccumulator::getMean(void) const {
+	return count_ ? mean_ : NAN;
+}
+
+double MeasurementAccumulator::getVariance(void) const {
+	return count_ > 1 ? m2_ / (count_ - 1) : NAN;
+}
+
+double MeasurementAccumulator::getStandardDeviation(void) const {
+	return sqrt(this->getVariance());
+}
+
+double MeasurementAccumulator::getStandardError(void) const {
+	return sqrt(this->getVariance() / count_);
+}
+
+double MeasurementAccumulator::getMin(void) const {
+	return min_;
+}
+
+double MeasurementAccumulator::getMax(void) const {
+	return max_;
+}
+
+void MeasurementAccumulator::getResult(UncertaintyPair *result_dest) const {
+	if (!result_dest) return;
+	simplifyUncertainty(this->getMean(), this->getStandardError(), &result_dest->value, &result_dest->uncertainty);
+}
+
+UncertaintyTableElement MeasurementAccumulator::getElement(UncertaintyTableElementType type) const {
+	UncertaintyPair result;
+	this->getResult(&result);
+	return UncertaintyTableElement{type, &result};
+}
+
+MeasurementAccumulator MeasurementAccumulator::accumulate(const double *values, size_t count, ThreadPool *pool) {
+	MeasurementAccumulator accumulator;
+	if (count <= parallel_block_size) {
+		accumulator.add(values, count);
+		return accumulator;
+	}
+	if (!values) return accumulator;
+	// Every task fills the accumulator of its block, and they are merged in order.
+	std::vector<MeasurementAccumulator> blocks((count + parallel_block_size - 1) / parallel_block_size);
+	if (!pool) pool = &ThreadPool::global();
+	pool->parallelFor(count, parallel_block_size, [&](size_t begin, size_t end) {
+		blocks[begin / parallel_block_size].add(values + begin, end - begin);
+	});
+	for (const MeasurementAccumulator &block : blocks) {
+		accumulator.merge(block);
+	}
+	return accumulator;
+}
+
+// If want C compatibility.
+// Also works: set CMake value JP_CCOMPAT to true.
+#ifdef JP_CCOMPAT
+
+#include <jp/visx/uasf/elementtype.h>
+
+extern "C" MeasurementAccumulator *jp_visx_uasf_MeasurementAccumulator_new(void);
+extern "C" void jp_visx_uasf_MeasurementAccumulator_add(MeasurementAccumulator *accumulator, double value);
+extern "C" void jp_visx_uasf_MeasurementAccumulator_addValues(MeasurementAccumulator *accumulator, const double *values, size_t count);
+extern "C" void jp_visx_uasf_MeasurementAccumulator_merge(MeasurementAccumulator *accumulator, MeasurementAccumulator *other);
+extern "C" void jp_visx_uasf_MeasurementAccumulator_reset(MeasurementAccumulator *accumulator);
+extern "C" u64 jp_visx_uasf_MeasurementAccumulator_count(MeasurementAccumulator *accumulator);
+extern "C" double jp_visx_uasf_MeasurementAccumulator_getMean(MeasurementAccumulator *accumulator);
+extern "C" double jp_visx_uasf_MeasurementAccumulator_getStandardDeviation(MeasurementAccumulator *accumulator);
+extern "C" double jp_visx_uasf_MeasurementAccumulator_getStandardError(MeasurementAccumulator *accumulator);
+extern "C" double jp_visx_uasf_MeasurementAccumulator_getMin(MeasurementAccumulator *accumulator);
+extern "C" double jp_visx_uasf_MeasurementAccumulator_getMax(MeasurementAccumulator *accumulator);
+extern "C" void jp_visx_uasf_MeasurementAccumulator_getResult(MeasurementAccumulator *accumulator, double *value_dest, double *uncertainty_dest);
+extern "C" void jp_visx_uasf_MeasurementAccumulator_addToTable(MeasurementAccumulator *accumulator, UncertaintyTable *table, jp_visx_uasf_UncertaintyTableElementType type);
+extern "C" void jp_visx_uasf_MeasurementAccumulator_free(MeasurementAccumulator *accumulator);
+
+MeasurementAccumulator *jp_visx_uasf_MeasurementAccumulator_new(void) {
+	return new MeasurementAccumulator();
+}
+
+void jp_visx_uasf_MeasurementAccumulator_add(MeasurementAccumulator *accumulator, double value) {
+	accumulator->add(value);
+}
+
+void jp_visx_uasf_MeasurementAccumulator_addValues(MeasurementAccumulator *accumulator, const double *values, size_t count) {
+	accumulator->add(values, count);
+}
+
+void jp_visx_uasf_MeasurementAccumulator_merge(MeasurementAccumulator *accumulator, MeasurementAccumulator *other) {
+	if (other) accumulator->merge(*other);
+}
+
+void jp_visx_uasf_MeasurementAccumulator_reset(MeasurementAccumulator *accumulator) {
+	accumulator->reset();
+}
+
+u64 jp_visx_uasf_MeasurementAccumulator_count(MeasurementAccumulator *accumulator) {
+	return accumulator->count();
+}
+
+double jp_visx_uasf_MeasurementAccumulator_getMean(MeasurementAccumulator *accumulator) {
+	return accumulator->getMean();
+}
+
+double jp_visx_uasf_MeasurementAccumulator_getStandardDeviation(MeasurementAccumulator *accumulator) {
+	return accumulator->getStandardDeviation();
+}
+
+double jp_visx_uasf_MeasurementAccumulator_getStandardError(MeasurementAccumulator *accumulator) {
+	return accumulator->getStandardError();
+}
+
+double jp_visx_uasf_MeasurementAccumulator_getMin(MeasurementAccumulator *accumulator) {
+	return accumulator->getMin();
+}
+
+double jp_visx_uasf_MeasurementAccumulator_getMax(MeasurementAccumulator *accumulator) {
+	return accumulator->getMax();
+}
+
+void jp_visx_uasf_MeasurementAccumulator_getResult(MeasurementAccumulator *accumulator, double *value_dest, double *uncertainty_dest) {
+	UncertaintyPair result;
+	accumulator->getResult(&result);
+	if (value_dest) *value_dest = result.value;
+	if (uncertainty_dest) *uncertainty_dest = result.uncertainty;
+}
+
+void jp_visx_uasf_MeasurementAccumulator_addToTable(MeasurementAccumulator *accumulator, UncertaintyTable *table, jp_visx_uasf_UncertaintyTableElementType type) {
+	table->add(accumulator->getElement(getOperation(type)));
+}
+
+void jp_visx_uasf_MeasurementAccumulator_free(MeasurementAccumulator *accumulator) {
+	delete accumulator;
+}
+
+#endif
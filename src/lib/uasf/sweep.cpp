@@ -0,0 +1,147 @@
+/* src/lib/uasf/sweep.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <math.h>
+#include <vector>
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+namespace {
+	// The number of points which are computed together.
+	const size_t block_size = 64;
+
+	// The rows of the table from the first varied row to the end.
+	struct Rows {
+		std::vector<UncertaintyTableElementType> types;
+		std::vector<double> values,
+							uncertainties;
+	};
+
+	inline void vary(const SweepAxis &axis, size_t point, double *value, double *uncertainty) {
+		if (axis.target == SWEEP_VALUE) {
+			*value = axis.points[point];
+		} else {
+			*uncertainty = fabs(axis.points[point]);
+		}
+	}
+
+	/* Compute the rows [begin, end) for count points, starting from their
+	 * cumulatives. The rows are the outer loop, so every row is read once per
+	 * block. At the rows of the axes, point_of(axis, p) returns the point of the
+	 * axis taken by the p-th point.
+	 */
+	template <typename F>
+	void computeBlock(const Rows &rows, size_t begin, size_t end, const SweepAxis *const *axes, const size_t *axis_rows, size_t axis_count, UncertaintyPair *cumulatives, size_t count, const F &point_of) {
+		for (size_t row = begin; row < end; ++row) {
+			UncertaintyTableElementType type = rows.types[row];
+			bool varied = false;
+			for (size_t a = 0; a < axis_count; ++a) {
+				varied |= axis_rows[a] == row;
+			}
+			if (!varied) {
+				double value = rows.values[row], uncertainty = rows.uncertainties[row];
+				for (size_t p = 0; p < count; ++p) {
+					UncertaintyChain::step(type, value, uncertainty, &cumulatives[p]);
+				}
+				continue;
+			}
+			for (size_t p = 0; p < count; ++p) {
+				double value = rows.values[row], uncertainty = rows.uncertainties[row];
+				for (size_t a = 0; a < axis_count; ++a) {
+					if (axis_rows[a] == row) vary(*axes[a], point_of(a, p), &value, &uncertainty);
+				}
+				UncertaintyChain::step(type, value, uncertainty, &cumulatives[p]);
+			}
+		}
+	}
+}
+
+bool jp::visx::uasf::sweep(const UncertaintyTable &table, const SweepAxis *axes, size_t axis_count, UncertaintyPair *results_dest, ThreadPool *pool) {
+	if (!axes || !axis_count || axis_count > 2 || !results_dest || table.inBatch()) return false;
+	for (size_t a = 0; a < axis_count; ++a) {
+		if (axes[a].row >= table.count() || (axes[a].count && !axes[a].points)) return false;
+	}
+	if (axis_count == 2 && axes[0].row == axes[1].row && axes[0].target == axes[1].target) return false;
+	if (!pool) pool = &ThreadPool::global();
+	// Sort the axes by their rows. The results are still laid out by the order of
+	// the axes given.
+	bool swapped = axis_count == 2 && axes[1].row < axes[0].row;
+	const SweepAxis *first = &axes[swapped ? 1 : 0], *second = axis_count == 2 ? &axes[swapped ? 0 : 1] : nullptr;
+	size_t base = first->row;
+	Rows rows;
+	for (size_t row = base; row < table.count(); ++row) {
+		rows.types.push_back(table.getType(row));
+		rows.values.push_back(table.getValue(row));
+		rows.uncertainties.push_back(table.getUncertainty(row));
+	}
+	// The cumulative before the first varied row is the same for every point.
+	UncertaintyPair prefix{0.0, 0.0};
+	if (base) {
+		const UncertaintyTableElement &element = table.getElement(base);
+		prefix = UncertaintyPair{element.getCumulative(), element.getCumulativeUncertainty()};
+	}
+	if (!second) {
+		pool->parallelFor(first->count, block_size, [&](size_t begin, size_t end) {
+			UncertaintyPair *cumulatives = results_dest + begin;
+			for (size_t p = 0; p < end - begin; ++p) {
+				cumulatives[p] = prefix;
+			}
+			size_t axis_row = 0;
+			computeBlock(rows, 0, rows.types.size(), &first, &axis_row, 1, cumulatives, end - begin, [begin](size_t, size_t p) {
+				return begin + p;
+			});
+		});
+		return true;
+	}
+	// Compute the rows between the axes once for every point of the first axis.
+	size_t middle_row = second->row - base;
+	std::vector<UncertaintyPair> middle(first->count, prefix);
+	if (middle_row) {
+		pool->parallelFor(first->count, block_size, [&](size_t begin, size_t end) {
+			size_t axis_row = 0;
+			computeBlock(rows, 0, middle_row, &first, &axis_row, 1, middle.data() + begin, end - begin, [begin](size_t, size_t p) {
+				return begin + p;
+			});
+		});
+	}
+	// Compute the rest for every point of the grid. If both axes are on the same
+	// row, the first is also varied there.
+	const SweepAxis *varied[2] = {second, first};
+	size_t varied_rows[2] = {middle_row, middle_row ? SIZE_MAX : 0};
+	size_t count = first->count * second->count, columns = axes[1].count;
+	pool->parallelFor(count, block_size, [&](size_t begin, size_t end) {
+		UncertaintyPair *cumulatives = results_dest + begin;
+		// The point of the result i is (i / columns, i % columns) on the axes as given.
+		auto point_of = [&](size_t a, size_t p) {
+			size_t i = begin + p;
+			bool row_axis = (a == 0) == swapped;
+			return row_axis ? i / columns : i % columns;
+		};
+		for (size_t p = 0; p < end - begin; ++p) {
+			cumulatives[p] = middle[point_of(1, p)];
+		}
+		computeBlock(rows, middle_row, rows.types.size(), varied, varied_rows, 2, cumulatives, end - begin, point_of);
+	});
+	return true;
+}
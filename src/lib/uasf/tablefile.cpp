@@ -0,0 +1,384 @@
+/* src/lib/uasf/tablefile.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <utility>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#ifndef __cplusplus
+#error Not compiled using C++!
+#endif
+
+using namespace jp::visx::uasf;
+
+namespace {
+	const char tablefile_magic[8] = {'V', 'I', 'S', 'X', 'T', 'B', 'L', '\0'};
+	const u32 tablefile_byte_order = 0x01020304;
+	// The number of rows converted at a time when writing a column.
+	const size_t tablefile_block_rows = 8192;
+
+	u64 alignOffset(u64 offset) {
+		return (offset + TABLEFILE_ALIGNMENT - 1) & ~(u64)(TABLEFILE_ALIGNMENT - 1);
+	}
+
+	// Fill in the offsets of the header for the given row count and flags.
+	void layoutHeader(TableFileHeader *header, u64 rows, u32 flags) {
+		u64 offset = alignOffset(sizeof(TableFileHeader));
+		header->types_offset = offset;
+		offset = alignOffset(offset + rows * sizeof(i8));
+		header->values_offset = offset;
+		offset = alignOffset(offset + rows * sizeof(double));
+		header->uncertainties_offset = offset;
+		offset = alignOffset(offset + rows * sizeof(double));
+		if (flags & TABLEFILE_CUMULATIVES) {
+			header->cumulative_values_offset = offset;
+			offset = alignOffset(offset + rows * sizeof(double));
+			header->cumulative_uncertainties_offset = offset;
+			offset = alignOffset(offset + rows * sizeof(double));
+		} else {
+			header->cumulative_values_offset = 0;
+			header->cumulative_uncertainties_offset = 0;
+		}
+		header->file_size = offset;
+	}
+
+	// Check that a column of `size` bytes per row fits in the file and is aligned.
+	bool columnValid(const TableFileHeader *header, u64 offset, u64 size) {
+		if (offset % TABLEFILE_ALIGNMENT || offset < sizeof(TableFileHeader) || offset > header->file_size) return false;
+		if (header->row_count > (header->file_size - offset) / size) return false;
+		return true;
+	}
+
+	// Check that a mapped header describes a valid table file of mapped_size bytes.
+	bool headerValid(const TableFileHeader *header, size_t mapped_size) {
+		if (mapped_size < sizeof(TableFileHeader)) return false;
+		if (memcmp(header->magic, tablefile_magic, sizeof(tablefile_magic))) return false;
+		if (header->version != TABLEFILE_VERSION || header->byte_order != tablefile_byte_order) return false;
+		if (header->header_size != sizeof(TableFileHeader)) return false;
+		// The table always has its starting row.
+		if (!header->row_count || header->file_size > mapped_size) return false;
+		if (!columnValid(header, header->types_offset, sizeof(i8))
+				|| !columnValid(header, header->values_offset, sizeof(double))
+				|| !columnValid(header, header->uncertainties_offset, sizeof(double))) {
+			return false;
+		}
+		if (header->flags & TABLEFILE_CUMULATIVES) {
+			if (!columnValid(header, header->cumulative_values_offset, sizeof(double))
+					|| !columnValid(header, header->cumulative_uncertainties_offset, sizeof(double))) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Write zeroes until the file position reaches offset.
+	bool padTo(FILE *file, u64 *position, u64 offset) {
+		static const char zeroes[TABLEFILE_ALIGNMENT] = {0};
+		size_t n = (size_t)(offset - *position);
+		if (n && fwrite(zeroes, 1, n, file) != n) return false;
+		*position = offset;
+		return true;
+	}
+
+	// Write one column of the table. `get` converts an element to the stored type.
+	template <typename T, typename F>
+	bool writeColumn(FILE *file, u64 *position, u64 offset, const UncertaintyTable &table, F get) {
+		if (!padTo(file, position, offset)) return false;
+		T block[tablefile_block_rows];
+		size_t rows = table.count();
+		for (size_t row = 0; row < rows; ) {
+			size_t n = rows - row < tablefile_block_rows ? rows - row : tablefile_block_rows;
+			for (size_t i = 0; i < n; ++i) {
+				block[i] = get(table.getElement(row + i));
+			}
+			if (fwrite(block, sizeof(T), n, file) != n) return false;
+			row += n;
+		}
+		*position += rows * sizeof(T);
+		return true;
+	}
+}
+
+MappedUncertaintyTable::MappedUncertaintyTable(void) : header_(nullptr) {}
+
+MappedUncertaintyTable::MappedUncertaintyTable(MappedUncertaintyTable &&other) : file_(std::move(other.file_)), header_(other.header_) {
+	other.header_ = nullptr;
+}
+
+MappedUncertaintyTable &MappedUncertaintyTable::operator=(MappedUncertaintyTable &&other) {
+	if (this != &other) {
+		file_ = std::move(other.file_);
+		header_ = other.header_;
+		other.header_ = nullptr;
+	}
+	return *this;
+}
+
+bool MappedUncertaintyTable::open(const char *path) {
+	this->close();
+	if (!file_.open(path)) return false;
+	// If the file is not a valid table file, unmap it.
+	if (!headerValid((const TableFileHeader *)file_.getData(), file_.getSize())) {
+		file_.close();
+		return false;
+	}
+	header_ = (const TableFileHeader *)file_.getData();
+	return true;
+}
+
+void MappedUncertaintyTable::close(void) {
+	file_.close();
+	header_ = nullptr;
+}
+
+bool MappedUncertaintyTable::isOpen(void) const {
+	return header_ != nullptr;
+}
+
+bool MappedUncertaintyTable::hasCumulatives(void) const {
+	return header_ && (header_->flags & TABLEFILE_CUMULATIVES);
+}
+
+u64 MappedUncertaintyTable::getSequence(void) const {
+	return header_ ? header_->sequence : 0;
+}
+
+size_t MappedUncertaintyTable::count(void) const {
+	return header_ ? (size_t)header_->row_count : 0;
+}
+
+const i8 *MappedUncertaintyTable::getTypes(void) const {
+	return header_ ? (const i8 *)((const char *)file_.getData() + header_->types_offset) : nullptr;
+}
+
+const double *MappedUncertaintyTable::getValues(void) const {
+	return header_ ? (const double *)((const char *)file_.getData() + header_->values_offset) : nullptr;
+}
+
+const double *MappedUncertaintyTable::getUncertainties(void) const {
+	return header_ ? (const double *)((const char *)file_.getData() + header_->uncertainties_offset) : nullptr;
+}
+
+const double *MappedUncertaintyTable::getCumulatives(void) const {
+	return this->hasCumulatives() ? (const double *)((const char *)file_.getData() + header_->cumulative_values_offset) : nullptr;
+}
+
+const double *MappedUncertaintyTable::getCumulativeUncertainties(void) const {
+	return this->hasCumulatives() ? (const double *)((const char *)file_.getData() + header_->cumulative_uncertainties_offset) : nullptr;
+}
+
+double MappedUncertaintyTable::getValue(size_t row) const {
+	// If the row is invalid, return NaN.
+	if (row >= this->count()) return NAN;
+	return this->getValues()[row];
+}
+
+void MappedUncertaintyTable::getValue(size_t row, UncertaintyPair *result_dest) const {
+	if (!result_dest) return;
+	result_dest->value = this->getValue(row);
+	result_dest->uncertainty = this->getUncertainty(row);
+}
+
+double MappedUncertaintyTable::getUncertainty(size_t row) const {
+	// If the row is invalid, return NaN.
+	if (row >= this->count()) return NAN;
+	return this->getUncertainties()[row];
+}
+
+UncertaintyTableElementType MappedUncertaintyTable::getType(size_t row) const {
+	// If the row is invalid, return an invalid operation.
+	if (row >= this->count()) return UOPERATION_INVALID;
+	i8 type = this->getTypes()[row];
+	// The file may come from anywhere, so make sure the type is known.
+	if (type < UOPERATION_NUL || type >= UOPERATION_INVALID) return UOPERATION_INVALID;
+	return (UncertaintyTableElementType)type;
+}
+
+double MappedUncertaintyTable::getCumulative(size_t row) const {
+	if (row >= this->count() || !this->hasCumulatives()) return NAN;
+	return this->getCumulatives()[row];
+}
+
+void MappedUncertaintyTable::getCumulative(size_t row, UncertaintyPair *result_dest) const {
+	if (!result_dest) return;
+	result_dest->value = this->getCumulative(row);
+	result_dest->uncertainty = this->getCumulativeUncertainty(row);
+}
+
+double MappedUncertaintyTable::getCumulativeUncertainty(size_t row) const {
+	if (row >= this->count() || !this->hasCumulatives()) return NAN;
+	return this->getCumulativeUncertainties()[row];
+}
+
+double MappedUncertaintyTable::getResult(void) const {
+	return header_ ? header_->result_value : NAN;
+}
+
+void MappedUncertaintyTable::getResult(UncertaintyPair *result_dest) const {
+	if (!result_dest) return;
+	result_dest->value = this->getResult();
+	result_dest->uncertainty = this->getResultingUncertainty();
+}
+
+double MappedUncertaintyTable::getResultingUncertainty(void) const {
+	return header_ ? header_->result_uncertainty : NAN;
+}
+
+bool MappedUncertaintyTable::copyTo(UncertaintyTable *table_dest) const {
+	if (!table_dest || !header_) return false;
+	size_t rows = this->count();
+	const double *values = this->getValues(), *uncertainties = this->getUncertainties();
+	const double *cumulatives = this->getCumulatives(), *cumulative_uncertainties = this->getCumulativeUncertainties();
+	std::vector<UncertaintyTableElement> elements;
+	elements.reserve(rows);
+	for (size_t row = 0; row < rows; ++row) {
+		if (cumulatives) {
+			elements.emplace_back(this->getType(row), values[row], uncertainties[row], cumulatives[row], cumulative_uncertainties[row]);
+		} else {
+			elements.emplace_back(this->getType(row), values[row], uncertainties[row]);
+		}
+	}
+	table_dest->assign(std::move(elements), cumulatives != nullptr);
+	return true;
+}
+
+bool jp::visx::uasf::saveTable(const UncertaintyTable &table, const char *path, u32 flags, u64 sequence) {
+	if (!path) return false;
+	TableFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, tablefile_magic, sizeof(tablefile_magic));
+	header.version = TABLEFILE_VERSION;
+	header.byte_order = tablefile_byte_order;
+	header.flags = flags & TABLEFILE_CUMULATIVES;
+	header.header_size = sizeof(TableFileHeader);
+	header.row_count = table.count();
+	header.sequence = sequence;
+	header.result_value = table.getResult();
+	header.result_uncertainty = table.getResultingUncertainty();
+	layoutHeader(&header, header.row_count, header.flags);
+
+	// The table is written next to the destination, which is only replaced once
+	// the whole file is on the disk, so a failed save leaves the old file.
+	std::string temporary = std::string(path) + ".tmp";
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (!file) return false;
+	u64 position = sizeof(header);
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+		&& writeColumn<i8>(file, &position, header.types_offset, table, [](const UncertaintyTableElement &e) { return (i8)e.getType(); })
+		&& writeColumn<double>(file, &position, header.values_offset, table, [](const UncertaintyTableElement &e) { return e.getValue(); })
+		&& writeColumn<double>(file, &position, header.uncertainties_offset, table, [](const UncertaintyTableElement &e) { return e.getUncertainty(); });
+	if (ok && (header.flags & TABLEFILE_CUMULATIVES)) {
+		ok = writeColumn<double>(file, &position, header.cumulative_values_offset, table, [](const UncertaintyTableElement &e) { return e.getCumulative(); })
+			&& writeColumn<double>(file, &position, header.cumulative_uncertainties_offset, table, [](const UncertaintyTableElement &e) { return e.getCumulativeUncertainty(); });
+	}
+	// Pad the last column so that the file size matches the header.
+	ok = ok && padTo(file, &position, header.file_size);
+	if (fclose(file)) ok = false;
+	if (!ok || !jp::visx::syncFile(temporary.c_str()) || !jp::visx::replaceFile(temporary.c_str(), path)) {
+		::remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool jp::visx::uasf::loadTable(const char *path, UncertaintyTable *table_dest) {
+	if (!table_dest) return false;
+	MappedUncertaintyTable mapped;
+	if (!mapped.open(path)) return false;
+	return mapped.copyTo(table_dest);
+}
+
+// If want C compatibility.
+// Also works: set CMake value JP_CCOMPAT to true.
+#ifdef JP_CCOMPAT
+
+#include <jp/visx/uasf/elementtype.h>
+
+typedef UncertaintyTable jp_visx_uasf_UncertaintyTable;
+typedef MappedUncertaintyTable jp_visx_uasf_MappedUncertaintyTable;
+
+extern "C" bool jp_visx_uasf_saveTable(jp_visx_uasf_UncertaintyTable *table, const char *path, u32 flags, u64 sequence);
+extern "C" bool jp_visx_uasf_loadTable(const char *path, jp_visx_uasf_UncertaintyTable *table);
+extern "C" jp_visx_uasf_MappedUncertaintyTable *jp_visx_uasf_MappedUncertaintyTable_open(const char *path);
+extern "C" size_t jp_visx_uasf_MappedUncertaintyTable_count(jp_visx_uasf_MappedUncertaintyTable *table);
+extern "C" double jp_visx_uasf_MappedUncertaintyTable_getValue(jp_visx_uasf_MappedUncertaintyTable *table, size_t row);
+extern "C" double jp_visx_uasf_MappedUncertaintyTable_getUncertainty(jp_visx_uasf_MappedUncertaintyTable *table, size_t row);
+extern "C" jp_visx_uasf_UncertaintyTableElementType jp_visx_uasf_MappedUncertaintyTable_getType(jp_visx_uasf_MappedUncertaintyTable *table, size_t row);
+extern "C" double jp_visx_uasf_MappedUncertaintyTable_getCumulative(jp_visx_uasf_MappedUncertaintyTable *table, size_t row);
+extern "C" double jp_visx_uasf_MappedUncertaintyTable_getCumulativeUncertainty(jp_visx_uasf_MappedUncertaintyTable *table, size_t row);
+extern "C" double jp_visx_uasf_MappedUncertaintyTable_getResult(jp_visx_uasf_MappedUncertaintyTable *table);
+extern "C" double jp_visx_uasf_MappedUncertaintyTable_getResultingUncertainty(jp_visx_uasf_MappedUncertaintyTable *table);
+extern "C" void jp_visx_uasf_MappedUncertaintyTable_close(jp_visx_uasf_MappedUncertaintyTable *table);
+
+bool jp_visx_uasf_saveTable(UncertaintyTable *table, const char *path, u32 flags, u64 sequence) {
+	return table && saveTable(*table, path, flags, sequence);
+}
+
+bool jp_visx_uasf_loadTable(const char *path, UncertaintyTable *table) {
+	return loadTable(path, table);
+}
+
+MappedUncertaintyTable *jp_visx_uasf_MappedUncertaintyTable_open(const char *path) {
+	MappedUncertaintyTable *table = new MappedUncertaintyTable();
+	if (!table->open(path)) {
+		delete table;
+		return nullptr;
+	}
+	return table;
+}
+
+size_t jp_visx_uasf_MappedUncertaintyTable_count(MappedUncertaintyTable *table) {
+	return table->count();
+}
+
+double jp_visx_uasf_MappedUncertaintyTable_getValue(MappedUncertaintyTable *table, size_t row) {
+	return table->getValue(row);
+}
+
+double jp_visx_uasf_MappedUncertaintyTable_getUncertainty(MappedUncertaintyTable *table, size_t row) {
+	return table->getUncertainty(row);
+}
+
+jp_visx_uasf_UncertaintyTableElementType jp_visx_uasf_MappedUncertaintyTable_getType(MappedUncertaintyTable *table, size_t row) {
+	return (jp_visx_uasf_UncertaintyTableElementType)table->getType(row);
+}
+
+double jp_visx_uasf_MappedUncertaintyTable_getCumulative(MappedUncertaintyTable *table, size_t row) {
+	return table->getCumulative(row);
+}
+
+double jp_visx_uasf_MappedUncertaintyTable_getCumulativeUncertainty(MappedUncertaintyTable *table, size_t row) {
+	return table->getCumulativeUncertainty(row);
+}
+
+double jp_visx_uasf_MappedUncertaintyTable_getResult(MappedUncertaintyTable *table) {
+	return table->getResult();
+}
+
+double jp_visx_uasf_MappedUncertaintyTable_getResultingUncertainty(MappedUncertaintyTable *table) {
+	return table->getResultingUncertainty();
+}
+
+void jp_visx_uasf_MappedUncertaintyTable_close(MappedUncertaintyTable *table) {
+	delete table;
+}
+
+#endif
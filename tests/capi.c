@@ -0,0 +1,217 @@
+/* tests/capi.c
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx/uasf.h>
+#include <jp/visx/uasf/quantiles.h>
+#include <jp/visx/uasf/resultcache.h>
+#include <jp/visx/uasf/statistics.h>
+#include <jp/visx/uasf/tablefile.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "check.h"
+
+/* This test uses the library through its C API, from C, and checks that the
+ * operations it gives are the operations the library computes: every type is
+ * read back as it was given, and rows with the operations whose C value was
+ * once different from the C++ one give the results of those operations.
+ */
+
+typedef jp_visx_uasf_UncertaintyTableElementType Type;
+
+// ADD 4 +/- 0.5, MULCO 3 +/- 0.25, DIVCO 24 +/- 3, DIVC 0.5 and MULC 2 give
+// 12 +/- 1, 2 +/- 0.3, 4 +/- 0.6 and 8 +/- 1 (the uncertainties are rounded to
+// one significant figure).
+static const Type chain_types[] = {JP_VISX_UASF_UOPERATION_ADD, JP_VISX_UASF_UOPERATION_MULCO, JP_VISX_UASF_UOPERATION_DIVCO, JP_VISX_UASF_UOPERATION_DIVC, JP_VISX_UASF_UOPERATION_MULC};
+static const double chain_values[] = {4.0, 3.0, 24.0, 0.5, 2.0},
+	chain_uncertainties[] = {0.5, 0.25, 3.0, 0.0, 0.0};
+static const size_t chain_count = sizeof(chain_types) / sizeof(chain_types[0]);
+
+static void checkTypes(void) {
+	Type types[JP_VISX_UASF_UOPERATION_INVALID + 3], read[JP_VISX_UASF_UOPERATION_INVALID + 3];
+	double values[JP_VISX_UASF_UOPERATION_INVALID + 3], uncertainties[JP_VISX_UASF_UOPERATION_INVALID + 3];
+	size_t count = 0;
+	for (int type = JP_VISX_UASF_UOPERATION_NUL; type <= JP_VISX_UASF_UOPERATION_INVALID; ++type) {
+		types[count] = (Type)type;
+		values[count] = 1.0;
+		uncertainties[count++] = 0.0;
+	}
+	// A value which is not an operation is read back as INVALID.
+	types[count] = (Type)99;
+	values[count] = 1.0;
+	uncertainties[count++] = 0.0;
+	jp_visx_uasf_UncertaintyTable *table = jp_visx_uasf_UncertaintyTable_new1();
+	jp_visx_uasf_UncertaintyTable_assignRows(table, types, values, uncertainties, count);
+	CHECK(jp_visx_uasf_UncertaintyTable_getRows(table, 0, count, read, NULL, NULL) == count);
+	for (size_t row = 0; row + 1 < count; ++row) {
+		CHECK(read[row] == types[row]);
+		CHECK(jp_visx_uasf_UncertaintyTable_getType(table, row) == types[row]);
+	}
+	CHECK(read[count - 1] == JP_VISX_UASF_UOPERATION_INVALID);
+	jp_visx_uasf_UncertaintyTable_clear(table);
+	jp_visx_uasf_UncertaintyTable_add(table, JP_VISX_UASF_UOPERATION_DIVCO, 1.0, 0.0);
+	jp_visx_uasf_UncertaintyTable_addAt(table, 1, JP_VISX_UASF_UOPERATION_MULCO, 1.0, 0.0);
+	CHECK(jp_visx_uasf_UncertaintyTable_getType(table, 1) == JP_VISX_UASF_UOPERATION_MULCO);
+	CHECK(jp_visx_uasf_UncertaintyTable_getType(table, 2) == JP_VISX_UASF_UOPERATION_DIVCO);
+	jp_visx_uasf_UncertaintyTable_free(table);
+}
+
+static void checkResults(void) {
+	jp_visx_uasf_UncertaintyTable *table = jp_visx_uasf_UncertaintyTable_new1();
+	jp_visx_uasf_UncertaintyTable_assignRows(table, chain_types, chain_values, chain_uncertainties, chain_count);
+	CHECK(jp_visx_uasf_UncertaintyTable_getResult(table) == 8.0);
+	CHECK(jp_visx_uasf_UncertaintyTable_getResultingUncertainty(table) == 1.0);
+	jp_visx_uasf_UncertaintyTable_free(table);
+
+	// The same rows, the first added alone and the others at once.
+	table = jp_visx_uasf_UncertaintyTable_new1();
+	jp_visx_uasf_UncertaintyTable_add(table, chain_types[0], chain_values[0], chain_uncertainties[0]);
+	jp_visx_uasf_UncertaintyTable_addRows(table, chain_types + 1, chain_values + 1, chain_uncertainties + 1, chain_count - 1);
+	CHECK(jp_visx_uasf_UncertaintyTable_count(table) == chain_count + 1);
+	CHECK(jp_visx_uasf_UncertaintyTable_getType(table, 3) == JP_VISX_UASF_UOPERATION_DIVCO);
+	CHECK(jp_visx_uasf_UncertaintyTable_getResult(table) == 8.0);
+	CHECK(jp_visx_uasf_UncertaintyTable_getResultingUncertainty(table) == 1.0);
+	jp_visx_uasf_UncertaintyTable_free(table);
+
+	double value = 0.0, uncertainty = 0.0;
+	jp_visx_uasf_evaluateRows(chain_types, chain_values, chain_uncertainties, chain_count, &value, &uncertainty);
+	CHECK(value == 8.0 && uncertainty == 1.0);
+
+	// The first two rows, then the whole chain.
+	Type types[2 * sizeof(chain_types) / sizeof(chain_types[0])];
+	double values[2 * sizeof(chain_types) / sizeof(chain_types[0])], uncertainties[2 * sizeof(chain_types) / sizeof(chain_types[0])];
+	for (size_t i = 0; i < 2 + chain_count; ++i) {
+		size_t j = i < 2 ? i : i - 2;
+		types[i] = chain_types[j];
+		values[i] = chain_values[j];
+		uncertainties[i] = chain_uncertainties[j];
+	}
+	size_t counts[2] = {2, chain_count};
+	double values_dest[2], uncertainties_dest[2];
+	jp_visx_uasf_evaluateRowSets(types, values, uncertainties, counts, 2, values_dest, uncertainties_dest);
+	CHECK(values_dest[0] == 12.0 && uncertainties_dest[0] == 1.0);
+	CHECK(values_dest[1] == 8.0 && uncertainties_dest[1] == 1.0);
+}
+
+static u64 countTimes(Type type) {
+	u64 buckets[JP_VISX_UASF_INSTRUMENTATION_BUCKETS], count = 0;
+	jp_visx_uasf_getInstrumentationTimeHistogram(type, buckets);
+	for (size_t i = 0; i < JP_VISX_UASF_INSTRUMENTATION_BUCKETS; ++i) count += buckets[i];
+	return count;
+}
+
+// The rows are timed in the histogram of their type, and the rows of a type
+// which is not an operation in the histogram of INVALID. Without
+// instrumentation, every histogram is empty.
+static void checkInstrumentation(void) {
+	const Type types[] = {JP_VISX_UASF_UOPERATION_ADD, JP_VISX_UASF_UOPERATION_DIVCO, JP_VISX_UASF_UOPERATION_DIVCO, (Type)99};
+	const double values[] = {1.0, 2.0, 2.0, 1.0}, uncertainties[] = {0.0, 0.0, 0.0, 0.0};
+	bool instrumented = jp_visx_uasf_isInstrumented();
+	jp_visx_uasf_resetInstrumentationStats();
+	jp_visx_uasf_evaluateRows(types, values, uncertainties, 4, NULL, NULL);
+	CHECK(countTimes(JP_VISX_UASF_UOPERATION_ADD) == (instrumented ? 1 : 0));
+	CHECK(countTimes(JP_VISX_UASF_UOPERATION_DIVCO) == (instrumented ? 2 : 0));
+	CHECK(countTimes(JP_VISX_UASF_UOPERATION_INVALID) == (instrumented ? 1 : 0));
+	CHECK(countTimes((Type)99) == (instrumented ? 1 : 0));
+	CHECK(countTimes(JP_VISX_UASF_UOPERATION_MULCO) == 0);
+	CHECK(countTimes(JP_VISX_UASF_UOPERATION_DIVC) == 0);
+	jp_visx_uasf_resetInstrumentationStats();
+}
+
+// The whole chain, its first two rows and its first row give 8 +/- 1,
+// 12 +/- 1 and 4 +/- 0.5, which the sketches keep exactly.
+static void checkSketches(void) {
+	Type types[2 * sizeof(chain_types) / sizeof(chain_types[0])];
+	double values[2 * sizeof(chain_types) / sizeof(chain_types[0])], uncertainties[2 * sizeof(chain_types) / sizeof(chain_types[0])];
+	size_t count = 0;
+	for (size_t set = 0; set < 3; ++set) {
+		for (size_t i = 0; i < (set ? 3 - set : chain_count); ++i) {
+			types[count] = chain_types[i];
+			values[count] = chain_values[i];
+			uncertainties[count++] = chain_uncertainties[i];
+		}
+	}
+	size_t counts[3] = {chain_count, 2, 1};
+	jp_visx_uasf_QuantileSketch *value_sketch = jp_visx_uasf_QuantileSketch_new(0),
+		*uncertainty_sketch = jp_visx_uasf_QuantileSketch_new(0);
+	jp_visx_uasf_sketchRowSets(types, values, uncertainties, counts, 3, value_sketch, uncertainty_sketch);
+	CHECK(jp_visx_uasf_QuantileSketch_count(value_sketch) == 3);
+	CHECK(jp_visx_uasf_QuantileSketch_getMin(value_sketch) == 4.0);
+	CHECK(jp_visx_uasf_QuantileSketch_getMax(value_sketch) == 12.0);
+	CHECK(jp_visx_uasf_QuantileSketch_getQuantile(value_sketch, 0.5) == 8.0);
+	CHECK(jp_visx_uasf_QuantileSketch_getMin(uncertainty_sketch) == 0.5);
+	CHECK(jp_visx_uasf_QuantileSketch_getMax(uncertainty_sketch) == 1.0);
+	jp_visx_uasf_QuantileSketch_free(value_sketch);
+	jp_visx_uasf_QuantileSketch_free(uncertainty_sketch);
+}
+
+// The rows added by an accumulator have the type they are given.
+static void checkStatistics(void) {
+	const double measurements[] = {2.9, 3.0, 3.1};
+	jp_visx_uasf_MeasurementAccumulator *accumulator = jp_visx_uasf_MeasurementAccumulator_new();
+	jp_visx_uasf_MeasurementAccumulator_addValues(accumulator, measurements, 3);
+	double value = 0.0, uncertainty = 0.0;
+	jp_visx_uasf_MeasurementAccumulator_getResult(accumulator, &value, &uncertainty);
+	jp_visx_uasf_UncertaintyTable *table = jp_visx_uasf_UncertaintyTable_new1();
+	jp_visx_uasf_UncertaintyTable_add(table, JP_VISX_UASF_UOPERATION_ADD, 4.0, 0.5);
+	jp_visx_uasf_MeasurementAccumulator_addToTable(accumulator, table, JP_VISX_UASF_UOPERATION_MULCO);
+	jp_visx_uasf_MeasurementAccumulator_addToTable(accumulator, table, JP_VISX_UASF_UOPERATION_DIVC);
+	jp_visx_uasf_MeasurementAccumulator_addToTable(accumulator, table, (Type)99);
+	CHECK(jp_visx_uasf_UncertaintyTable_count(table) == 5);
+	CHECK(jp_visx_uasf_UncertaintyTable_getType(table, 2) == JP_VISX_UASF_UOPERATION_MULCO);
+	CHECK(jp_visx_uasf_UncertaintyTable_getType(table, 3) == JP_VISX_UASF_UOPERATION_DIVC);
+	CHECK(jp_visx_uasf_UncertaintyTable_getType(table, 4) == JP_VISX_UASF_UOPERATION_INVALID);
+	double row_value = 0.0, row_uncertainty = 0.0;
+	CHECK(jp_visx_uasf_UncertaintyTable_getRows(table, 2, 1, NULL, &row_value, &row_uncertainty) == 1);
+	CHECK(row_value == value && row_uncertainty == uncertainty);
+	jp_visx_uasf_UncertaintyTable_free(table);
+	jp_visx_uasf_MeasurementAccumulator_free(accumulator);
+}
+
+// A table saved and mapped through the C API has the same rows.
+static void checkTableFile(void) {
+	char path[] = "/tmp/visx_test_capi_XXXXXX";
+	int fd = mkstemp(path);
+	CHECK(fd >= 0);
+	if (fd < 0) return;
+	close(fd);
+	jp_visx_uasf_UncertaintyTable *table = jp_visx_uasf_UncertaintyTable_new1();
+	jp_visx_uasf_UncertaintyTable_assignRows(table, chain_types, chain_values, chain_uncertainties, chain_count);
+	CHECK(jp_visx_uasf_saveTable(table, path, JP_VISX_UASF_TABLEFILE_CUMULATIVES, 1));
+	jp_visx_uasf_MappedUncertaintyTable *mapped = jp_visx_uasf_MappedUncertaintyTable_open(path);
+	CHECK(mapped != NULL);
+	if (mapped) {
+		CHECK(jp_visx_uasf_MappedUncertaintyTable_count(mapped) == chain_count);
+		for (size_t row = 1; row < chain_count; ++row) {
+			CHECK(jp_visx_uasf_MappedUncertaintyTable_getType(mapped, row) == chain_types[row]);
+		}
+		CHECK(jp_visx_uasf_MappedUncertaintyTable_getResult(mapped) == 8.0);
+		jp_visx_uasf_MappedUncertaintyTable_close(mapped);
+	}
+	jp_visx_uasf_UncertaintyTable_free(table);
+	unlink(path);
+}
+
+int main(void) {
+	checkTypes();
+	checkResults();
+	checkInstrumentation();
+	checkSketches();
+	checkStatistics();
+	checkTableFile();
+	return checkStatus();
+}
@@ -0,0 +1,39 @@
+/* tests/check.h
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_TESTS_CHECK_H
+#define JP_VISX_TESTS_CHECK_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// The checks of check.hpp, for the tests of the C API, which are written in C.
+static size_t check_failures = 0;
+
+#define CHECK(condition) do { \
+	if (!(condition)) { \
+		if (check_failures++ < 20) fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+	} \
+} while (0)
+
+static int checkStatus(void) {
+	if (check_failures) fprintf(stderr, "%zu checks failed\n", check_failures);
+	return check_failures ? 1 : 0;
+}
+
+#endif
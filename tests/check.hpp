@@ -0,0 +1,60 @@
+/* tests/check.hpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JP_VISX_TESTS_CHECK_HPP
+#define JP_VISX_TESTS_CHECK_HPP
+
+// Make sure this file is compiled with C++
+#ifndef __cplusplus
+#error HPP File not compiled with C++.
+#endif
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/* The tests count the checks which failed, and print the first ones (with the
+ * file, the line and the condition). A test returns checkStatus() from main,
+ * which is non-zero if a check failed.
+ */
+static size_t check_failures = 0;
+
+#define CHECK(condition) do { \
+	if (!(condition)) { \
+		if (check_failures++ < 20) fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+	} \
+} while (0)
+
+// The doubles are the same bits (so NaN is the same as NaN, but 0.0 is not the
+// same as -0.0).
+inline bool sameBits(double a, double b) {
+	return !memcmp(&a, &b, sizeof(double));
+}
+
+// The doubles are equal, or both NaN.
+inline bool sameValue(double a, double b) {
+	return a == b || (isnan(a) && isnan(b));
+}
+
+inline int checkStatus(void) {
+	if (check_failures) fprintf(stderr, "%zu checks failed\n", check_failures);
+	return check_failures ? 1 : 0;
+}
+
+#endif
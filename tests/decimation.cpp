@@ -0,0 +1,138 @@
+/* tests/decimation.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <random>
+#include <vector>
+#include "check.hpp"
+
+using namespace jp::visx::uasf;
+
+/* This test checks the extents of a ResultDecimation against the extents found
+ * by reading every row, for random ranges of rows of a table which is edited
+ * (and the tree updated) between the reads, and checks that the buckets of
+ * decimate cover the same rows as the extent of their range.
+ */
+
+namespace {
+	// This function reads the results of the rows one by one.
+	ResultExtent bruteForceExtent(const UncertaintyTable &table, size_t first_row, size_t row_count) {
+		ResultExtent extent{NAN, NAN, NAN, NAN};
+		for (size_t row = first_row; row < first_row + row_count && row < table.count(); ++row) {
+			UncertaintyPair result;
+			if (row + 1 < table.count()) {
+				table.getElement(row + 1).getCumulative(&result);
+			} else {
+				table.getResult(&result);
+			}
+			// fmin and fmax leave out NaN.
+			extent.low = fmin(extent.low, result.value);
+			extent.high = fmax(extent.high, result.value);
+			extent.band_low = fmin(extent.band_low, result.value - result.uncertainty);
+			extent.band_high = fmax(extent.band_high, result.value + result.uncertainty);
+		}
+		return extent;
+	}
+
+	bool sameExtent(const ResultExtent &a, const ResultExtent &b) {
+		return sameValue(a.low, b.low) && sameValue(a.high, b.high) && sameValue(a.band_low, b.band_low) && sameValue(a.band_high, b.band_high);
+	}
+
+	ResultExtent mergedExtent(const std::vector<ResultExtent> &extents) {
+		ResultExtent extent{NAN, NAN, NAN, NAN};
+		for (const ResultExtent &bucket : extents) {
+			extent.low = fmin(extent.low, bucket.low);
+			extent.high = fmax(extent.high, bucket.high);
+			extent.band_low = fmin(extent.band_low, bucket.band_low);
+			extent.band_high = fmax(extent.band_high, bucket.band_high);
+		}
+		return extent;
+	}
+}
+
+int main(void) {
+	std::mt19937 random(3);
+	UncertaintyTable table(0, 1.0, 0.1);
+	for (size_t i = 0; i < 5000; ++i) {
+		table.add(random() % 3 ? UOPERATION_ADD : UOPERATION_SUB, (random() % 1000) / 100.0, (random() % 10) / 100.0);
+	}
+	ResultDecimation decimation(&table);
+	CHECK(decimation.count() == table.count());
+	for (size_t i = 0; i < 300; ++i) {
+		if (i % 3 == 0) {
+			size_t row = 1 + random() % (table.count() - 1);
+			table.set(row, (random() % 1000) / 10.0);
+			// The result of the row before changes too.
+			decimation.update(row - 1);
+		}
+		if (i % 7 == 0) {
+			table.addAt(1 + random() % table.count(), UOPERATION_ADD, 5.0, 0.5);
+			decimation.update(0);
+		}
+		if (i % 11 == 0) {
+			table.remove(table.count() - 1);
+			decimation.update(table.count() - 1);
+		}
+		// A NaN row makes the rows after it NaN, which are left out.
+		if (i % 50 == 25) {
+			table.set(table.count() - 10, UncertaintyTableElement(UOPERATION_DIVC, 0.0, 0.0));
+			decimation.update(table.count() - 11);
+		}
+		CHECK(decimation.count() == table.count());
+		// The ranges may go past the end of the table.
+		size_t first_row = random() % table.count(),
+			   row_count = random() % (table.count() - first_row + 5);
+		ResultExtent extent;
+		decimation.getExtent(first_row, row_count, &extent);
+		CHECK(sameExtent(extent, bruteForceExtent(table, first_row, row_count)));
+	}
+
+	// With few rows per bucket, the buckets split the rows evenly.
+	std::vector<ResultExtent> buckets(37);
+	decimation.decimate(100, 3000, buckets.size(), buckets.data());
+	for (size_t i = 0; i < buckets.size(); ++i) {
+		size_t begin = 100 + 3000 * i / buckets.size(),
+			   end = 100 + 3000 * (i + 1) / buckets.size();
+		CHECK(sameExtent(buckets[i], bruteForceExtent(table, begin, end - begin)));
+	}
+	// With many rows per bucket, the boundaries move to the leaves, but the
+	// buckets still cover every row.
+	UncertaintyTable large;
+	large.beginBatch();
+	for (size_t i = 0; i < 200000; ++i) {
+		large.add(UOPERATION_ADD, (random() % 100) / 100.0 - 0.5, (random() % 10) / 1000.0);
+	}
+	large.endBatch();
+	ResultDecimation large_decimation(&large);
+	buckets.resize(20);
+	large_decimation.decimate(123, 150000, buckets.size(), buckets.data());
+	CHECK(sameExtent(mergedExtent(buckets), bruteForceExtent(large, 123, 150000)));
+	for (const ResultExtent &bucket : buckets) {
+		CHECK(!isnan(bucket.low) && bucket.low <= bucket.high && bucket.band_low <= bucket.low && bucket.high <= bucket.band_high);
+	}
+	// More buckets than rows leave some buckets empty.
+	buckets.resize(10);
+	decimation.decimate(0, 4, buckets.size(), buckets.data());
+	CHECK(sameExtent(mergedExtent(buckets), bruteForceExtent(table, 0, 4)));
+	size_t empty_buckets = 0;
+	for (const ResultExtent &bucket : buckets) {
+		if (isnan(bucket.low)) ++empty_buckets;
+	}
+	CHECK(empty_buckets == 6);
+	return checkStatus();
+}
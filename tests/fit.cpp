@@ -0,0 +1,169 @@
+/* tests/fit.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <random>
+#include <vector>
+#include "check.hpp"
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+/* This test fits lines to noisy points far from the origin, with and without
+ * uncertainties, and checks the parameters, their uncertainties and chi^2
+ * against a fit computed directly in long double from the centred points.
+ * With 1000 points of noise 0.5, chi^2 is about 1000 when the points are
+ * weighted and about 250 when they are not, wherever the line is. It also
+ * checks exact polynomials, points with an uncertainty of x, and the cases in
+ * which the fit fails.
+ */
+
+namespace {
+	// A weighted line fit (every weight is one if weighted is false).
+	struct ReferenceFit {
+		long double intercept,
+					slope,
+					intercept_uncertainty,
+					slope_uncertainty,
+					chi_squared;
+		size_t points;
+	};
+
+	ReferenceFit referenceFit(const std::vector<UncertaintyPair> &x, const std::vector<UncertaintyPair> &y, bool weighted) {
+		long double sum_w = 0.0L,
+					sum_x = 0.0L,
+					sum_y = 0.0L;
+		std::vector<long double> weights(x.size());
+		ReferenceFit fit{};
+		for (size_t i = 0; i < x.size(); ++i) {
+			weights[i] = weighted ? (y[i].uncertainty > 0.0 ? 1.0L / ((long double)y[i].uncertainty * y[i].uncertainty) : 0.0L) : 1.0L;
+			if (weights[i] == 0.0L) continue;
+			++fit.points;
+			sum_w += weights[i];
+			sum_x += weights[i] * x[i].value;
+			sum_y += weights[i] * y[i].value;
+		}
+		long double mean_x = sum_x / sum_w,
+					mean_y = sum_y / sum_w,
+					sxx = 0.0L,
+					sxy = 0.0L;
+		for (size_t i = 0; i < x.size(); ++i) {
+			sxx += weights[i] * (x[i].value - mean_x) * (x[i].value - mean_x);
+			sxy += weights[i] * (x[i].value - mean_x) * (y[i].value - mean_y);
+		}
+		fit.slope = sxy / sxx;
+		fit.intercept = mean_y - fit.slope * mean_x;
+		for (size_t i = 0; i < x.size(); ++i) {
+			long double residual = y[i].value - fit.intercept - fit.slope * x[i].value;
+			fit.chi_squared += weights[i] * residual * residual;
+		}
+		// Without weights, the variance of the points comes from their scatter.
+		long double variance = weighted ? 1.0L : fit.chi_squared / (fit.points - 2);
+		fit.slope_uncertainty = sqrtl(variance / sxx);
+		fit.intercept_uncertainty = sqrtl(variance * (1.0L / sum_w + mean_x * mean_x / sxx));
+		return fit;
+	}
+
+	bool near(double value, long double expected, double tolerance) {
+		return fabsl(value - expected) <= tolerance * fmaxl(1.0L, fabsl(expected));
+	}
+
+	void testLine(double offset, bool weighted, ThreadPool *pool) {
+		const size_t count = 1000;
+		std::mt19937 random(1);
+		std::normal_distribution<double> noise(0.0, 0.5);
+		std::vector<UncertaintyPair> x(count),
+									 y(count);
+		for (size_t i = 0; i < count; ++i) {
+			x[i] = UncertaintyPair{(double)i, 0.0};
+			y[i] = UncertaintyPair{offset + 2.0 * i + noise(random), weighted ? 0.5 : 0.0};
+		}
+		// A point without an uncertainty cannot be weighted among points which
+		// have one.
+		if (weighted) y[7].uncertainty = 0.0;
+		UncertaintyPair parameters[2];
+		FitStatistics statistics;
+		CHECK(fitPolynomial(x.data(), y.data(), count, 1, parameters, nullptr, &statistics, pool));
+		ReferenceFit reference = referenceFit(x, y, weighted);
+		CHECK(statistics.points == reference.points);
+		CHECK(statistics.rejected == (weighted ? 1 : 0));
+		CHECK(statistics.degrees_of_freedom == reference.points - 2);
+		CHECK(near(parameters[0].value, reference.intercept, 1e-12));
+		CHECK(near(parameters[1].value, reference.slope, 1e-9));
+		CHECK(near(parameters[0].uncertainty, reference.intercept_uncertainty, 1e-6));
+		CHECK(near(parameters[1].uncertainty, reference.slope_uncertainty, 1e-6));
+		CHECK(near(statistics.chi_squared, reference.chi_squared, 1e-6));
+		// chi^2 per degree of freedom is about 1 with weights, and about the
+		// variance of the noise without.
+		double expected = weighted ? 1.0 : 0.25;
+		CHECK(fabs(statistics.chi_squared / statistics.degrees_of_freedom - expected) < 0.15 * expected);
+		// The line with the same points on another pool is the same.
+		UncertaintyPair line[2];
+		ThreadPool serial(1);
+		CHECK(fitLine(x.data(), y.data(), count, &line[0], &line[1], nullptr, &serial));
+		for (size_t i = 0; i < 2; ++i) {
+			CHECK(sameBits(line[i].value, parameters[i].value) && sameBits(line[i].uncertainty, parameters[i].uncertainty));
+		}
+	}
+}
+
+int main(void) {
+	ThreadPool pool(3);
+	for (double offset : {0.0, 1e9}) {
+		testLine(offset, false, &pool);
+		testLine(offset, true, &pool);
+	}
+
+	// An exact polynomial is found exactly, with no residuals.
+	const double coefficients[] = {1.0, -3.0, 0.5, 0.25};
+	std::vector<UncertaintyPair> x(50),
+								 y(50);
+	for (size_t i = 0; i < x.size(); ++i) {
+		double t = (double)i / 7.0 - 3.0;
+		x[i] = UncertaintyPair{t, 0.0};
+		y[i] = UncertaintyPair{coefficients[0] + t * (coefficients[1] + t * (coefficients[2] + t * coefficients[3])), 0.1};
+	}
+	UncertaintyPair parameters[4];
+	FitStatistics statistics;
+	CHECK(fitPolynomial(x.data(), y.data(), x.size(), 3, parameters, nullptr, &statistics, &pool));
+	for (size_t i = 0; i < 4; ++i) {
+		CHECK(near(parameters[i].value, coefficients[i], 1e-9));
+	}
+	CHECK(statistics.chi_squared < 1e-12);
+
+	// The uncertainty of x counts through the slope: with a slope of 3, the
+	// points have an effective uncertainty of 0.3.
+	for (size_t i = 0; i < x.size(); ++i) {
+		x[i] = UncertaintyPair{(double)i, 0.1};
+		y[i] = UncertaintyPair{1.0 + 3.0 * i, 0.0};
+	}
+	CHECK(fitPolynomial(x.data(), y.data(), x.size(), 1, parameters, nullptr, &statistics, &pool));
+	CHECK(near(parameters[0].value, 1.0, 1e-9) && near(parameters[1].value, 3.0, 1e-9));
+	CHECK(statistics.rejected == 0 && statistics.points == x.size());
+	ReferenceFit reference = referenceFit(x, std::vector<UncertaintyPair>(x.size(), UncertaintyPair{0.0, 0.3}), true);
+	CHECK(near(parameters[1].uncertainty, reference.slope_uncertainty, 1e-3));
+
+	// The fits which fail.
+	CHECK(!fitPolynomial(x.data(), y.data(), x.size(), max_fit_degree + 1, parameters, nullptr, nullptr, &pool));
+	CHECK(!fitPolynomial(x.data(), y.data(), 2, 1, parameters, nullptr, nullptr, &pool));
+	for (UncertaintyPair &point : x) {
+		point = UncertaintyPair{4.0, 0.0};
+	}
+	CHECK(!fitPolynomial(x.data(), y.data(), x.size(), 1, parameters, nullptr, nullptr, &pool));
+	return checkStatus();
+}
@@ -0,0 +1,101 @@
+/* tests/optimizer.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <random>
+#include "check.hpp"
+
+using namespace jp::visx::uasf;
+
+/* This test applies the same random edits to an optimizing table and a table
+ * computed row by row, and checks that the cumulatives read from the rows are
+ * the same (see UncertaintyTable::setOptimizing). The result of the optimizing
+ * table, which is the one of its plan, is checked against the plan of a table
+ * built from its rows at once, so a plan which is built again from the changed
+ * rows matches a new one.
+ */
+
+namespace {
+	bool sameResult(const UncertaintyTable &optimizing) {
+		UncertaintyTable fresh;
+		fresh.setOptimizing(true);
+		fresh.beginBatch();
+		for (size_t row = 1; row < optimizing.count(); ++row) {
+			const UncertaintyTableElement &element = optimizing.getElement(row);
+			fresh.add(element.getType(), element.getValue(), element.getUncertainty());
+		}
+		fresh.endBatch();
+		UncertaintyPair x, y;
+		optimizing.getResult(&x);
+		fresh.getResult(&y);
+		return sameValue(x.value, y.value) && sameValue(x.uncertainty, y.uncertainty);
+	}
+}
+
+int main(void) {
+	std::mt19937 random(3);
+	const UncertaintyTableElementType types[] = {UOPERATION_ADD, UOPERATION_SUB, UOPERATION_MULC, UOPERATION_DIVC, UOPERATION_MUL, UOPERATION_POW};
+	UncertaintyTable optimizing,
+					 rows;
+	optimizing.setOptimizing(true);
+	for (size_t i = 0; i < 4000; ++i) {
+		UncertaintyTableElementType type = types[random() % 6];
+		double value = (random() % 100) / 10.0 + 0.5,
+			   uncertainty = (random() % 10) / 100.0;
+		// Powers are of one, so that the results stay finite.
+		if (type == UOPERATION_POW) value = 1.0;
+		size_t count = optimizing.count(),
+			   row = count > 1 ? 1 + random() % (count - 1) : 1;
+		switch (count < 3 ? 0 : random() % 6) {
+		case 3:
+			optimizing.set(row, value, uncertainty);
+			rows.set(row, value, uncertainty);
+			break;
+		case 4:
+			optimizing.remove(row);
+			rows.remove(row);
+			break;
+		case 5:
+			optimizing.addAt(row, type, value, uncertainty);
+			rows.addAt(row, type, value, uncertainty);
+			break;
+		default:
+			optimizing.add(type, value, uncertainty);
+			rows.add(type, value, uncertainty);
+			break;
+		}
+		if (optimizing.count() > 200) {
+			optimizing.remove(1);
+			rows.remove(1);
+		}
+		// The cumulatives are only computed when they are read, so they are read
+		// after some of the edits only.
+		if (random() % 5 == 0) {
+			size_t read_row = random() % optimizing.count();
+			CHECK(sameValue(optimizing.getElement(read_row).getCumulative(), rows.getElement(read_row).getCumulative()));
+		}
+		if (random() % 50 == 0) CHECK(sameResult(optimizing));
+	}
+	CHECK(optimizing.count() == rows.count());
+	for (size_t row = 0; row < rows.count(); ++row) {
+		CHECK(sameValue(optimizing.getElement(row).getCumulative(), rows.getElement(row).getCumulative()));
+		CHECK(sameValue(optimizing.getElement(row).getCumulativeUncertainty(), rows.getElement(row).getCumulativeUncertainty()));
+	}
+	CHECK(sameResult(optimizing));
+	return checkStatus();
+}
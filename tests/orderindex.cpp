@@ -0,0 +1,101 @@
+/* tests/orderindex.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <random>
+#include <utility>
+#include <vector>
+#include "check.hpp"
+
+using namespace jp::visx;
+
+/* An OrderIndex is compared with a plain vector of the handles in order,
+ * through random insertions, removals, swaps and resets: the index must find
+ * every handle at its position in the vector, and none of the removed ones.
+ */
+
+namespace {
+	bool sameHandles(const OrderIndex &index, const std::vector<u64> &model, const std::vector<u64> &removed) {
+		if (index.count() != model.size()) return false;
+		for (size_t position = 0; position < model.size(); ++position) {
+			if (index.getHandle(position) != model[position] || index.find(model[position]) != position) return false;
+		}
+		for (u64 handle : removed) {
+			if (index.find(handle) != SIZE_MAX) return false;
+		}
+		return index.getHandle(model.size()) == OrderIndex::invalid_handle && index.find(OrderIndex::invalid_handle) == SIZE_MAX;
+	}
+}
+
+int main(void) {
+	std::mt19937 random(1);
+	OrderIndex index;
+	std::vector<u64> model,
+					 removed;
+	for (size_t i = 0; i < 100000; ++i) {
+		size_t count = model.size();
+		switch (random() % 6) {
+		case 0:
+		case 1: {
+			// Positions past the end insert at the end.
+			size_t position = random() % (count + 3);
+			u64 handle = index.insert(position);
+			CHECK(handle != OrderIndex::invalid_handle);
+			model.insert(model.begin() + (position < count ? position : count), handle);
+			break;
+		}
+		case 2:
+		case 3:
+			if (count) {
+				size_t position = random() % count;
+				removed.push_back(model[position]);
+				index.erase(position);
+				model.erase(model.begin() + position);
+			}
+			break;
+		case 4:
+			if (count) {
+				size_t position1 = random() % count,
+					   position2 = random() % count;
+				index.swap(position1, position2);
+				std::swap(model[position1], model[position2]);
+			}
+			break;
+		default:
+			if (random() % 1000 == 0) {
+				removed.insert(removed.end(), model.begin(), model.end());
+				size_t reset_count = random() % 100;
+				index.reset(reset_count);
+				model.clear();
+				for (size_t position = 0; position < reset_count; ++position) {
+					model.push_back(index.getHandle(position));
+				}
+			}
+			break;
+		}
+		if (i % 101 == 0) {
+			CHECK(sameHandles(index, model, removed));
+			if (removed.size() > 1000) removed.erase(removed.begin(), removed.begin() + 500);
+		}
+	}
+	CHECK(sameHandles(index, model, removed));
+	// A copy keeps the handles.
+	OrderIndex copy(index);
+	CHECK(sameHandles(copy, model, removed));
+	return checkStatus();
+}
@@ -0,0 +1,95 @@
+/* tests/parallel.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <random>
+#include "check.hpp"
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+/* This test computes the same tables with and without a compute pool, and checks
+ * that the cumulatives of every row and the results are the same bits, after
+ * building the tables and after edits which reach the chunks computed in
+ * parallel (see UncertaintyTable::setComputePool).
+ */
+
+namespace {
+	bool sameTables(const UncertaintyTable &a, const UncertaintyTable &b) {
+		if (a.count() != b.count()) return false;
+		for (size_t row = 0; row < a.count(); ++row) {
+			UncertaintyPair x, y;
+			a.getElement(row).getCumulative(&x);
+			b.getElement(row).getCumulative(&y);
+			if (!sameBits(x.value, y.value) || !sameBits(x.uncertainty, y.uncertainty)) {
+				fprintf(stderr, "row %zu: %g +/- %g, %g +/- %g\n", row, x.value, x.uncertainty, y.value, y.uncertainty);
+				return false;
+			}
+		}
+		UncertaintyPair x, y;
+		a.getResult(&x);
+		b.getResult(&y);
+		return sameBits(x.value, y.value) && sameBits(x.uncertainty, y.uncertainty);
+	}
+}
+
+int main(void) {
+	ThreadPool pool(4);
+	std::mt19937 random(5);
+	std::uniform_real_distribution<double> factor(1.01, 1.3);
+	const UncertaintyTableElementType types[] = {UOPERATION_ADD, UOPERATION_SUB, UOPERATION_MULC, UOPERATION_DIVC};
+	UncertaintyTable parallel(0, 1.5, 1e-3),
+					 serial(0, 1.5, 1e-3);
+	parallel.setComputePool(&pool);
+	parallel.beginBatch();
+	serial.beginBatch();
+	for (size_t i = 0; i < 100000; ++i) {
+		UncertaintyTableElementType type = types[random() % 4];
+		double value = factor(random);
+		parallel.add(type, value, value * 1e-3);
+		serial.add(type, value, value * 1e-3);
+	}
+	parallel.endBatch();
+	serial.endBatch();
+	CHECK(sameTables(parallel, serial));
+
+	// Every edit changes the cumulatives from its row to the end.
+	parallel.set(5, 2.0);
+	serial.set(5, 2.0);
+	CHECK(sameTables(parallel, serial));
+	parallel.addAt(1000, UOPERATION_MULC, 3.0, 0.0);
+	serial.addAt(1000, UOPERATION_MULC, 3.0, 0.0);
+	CHECK(sameTables(parallel, serial));
+	parallel.remove(7);
+	serial.remove(7);
+	CHECK(sameTables(parallel, serial));
+	parallel.swap(10, 20000);
+	serial.swap(10, 20000);
+	CHECK(sameTables(parallel, serial));
+	// A NaN row in the middle makes every later row NaN, until it is replaced.
+	parallel.set(50000, UncertaintyTableElement(UOPERATION_DIVC, 0.0, 0.0));
+	serial.set(50000, UncertaintyTableElement(UOPERATION_DIVC, 0.0, 0.0));
+	CHECK(sameTables(parallel, serial));
+	parallel.set(50000, UncertaintyTableElement(UOPERATION_DIVC, 1.1, 0.0));
+	serial.set(50000, UncertaintyTableElement(UOPERATION_DIVC, 1.1, 0.0));
+	CHECK(sameTables(parallel, serial));
+	parallel.recompute();
+	serial.recompute();
+	CHECK(sameTables(parallel, serial));
+	return checkStatus();
+}
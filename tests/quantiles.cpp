@@ -0,0 +1,110 @@
+/* tests/quantiles.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "check.hpp"
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+/* This test estimates the quantiles of streams of values with a QuantileSketch,
+ * added one by one, at once on a pool, and in parts which are merged, and
+ * checks that the true rank of every quantile (found from the sorted values) is
+ * within getRankError of the quantile. The generators are seeded, so the
+ * sketches are the same on every run.
+ */
+
+namespace {
+	// The fraction of the sorted values which are not greater than value.
+	double trueRank(const std::vector<double> &sorted, double value) {
+		return (double)(std::upper_bound(sorted.begin(), sorted.end(), value) - sorted.begin()) / sorted.size();
+	}
+
+	void checkQuantiles(const QuantileSketch &sketch, const std::vector<double> &sorted) {
+		CHECK(sketch.count() == sorted.size());
+		CHECK(sketch.getMin() == sorted.front() && sketch.getMax() == sorted.back());
+		CHECK(sketch.getQuantile(0.0) == sorted.front() && sketch.getQuantile(1.0) == sorted.back());
+		CHECK(sketch.getRetained() < 4 * sketch.getK());
+		double error = sketch.getRankError();
+		const double qs[] = {0.001, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 0.999};
+		double quantiles[9];
+		sketch.getQuantiles(qs, 9, quantiles);
+		for (size_t i = 0; i < 9; ++i) {
+			CHECK(quantiles[i] == sketch.getQuantile(qs[i]));
+			CHECK(fabs(trueRank(sorted, quantiles[i]) - qs[i]) <= error);
+			CHECK(fabs(sketch.getRank(quantiles[i]) - trueRank(sorted, quantiles[i])) <= error);
+		}
+	}
+}
+
+int main(void) {
+	ThreadPool pool(3);
+	std::mt19937_64 random(3);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	std::lognormal_distribution<double> lognormal(0.0, 2.0);
+	for (size_t distribution = 0; distribution < 2; ++distribution) {
+		std::vector<double> values(500000);
+		for (double &value : values) {
+			value = distribution ? lognormal(random) : uniform(random);
+		}
+		// The same values, in increasing order, are the worst case of some
+		// sketches.
+		std::vector<double> sorted(values);
+		std::sort(sorted.begin(), sorted.end());
+		QuantileSketch one_by_one,
+					   in_order;
+		for (size_t i = 0; i < values.size(); ++i) {
+			one_by_one.add(values[i]);
+			in_order.add(sorted[i]);
+		}
+		checkQuantiles(one_by_one, sorted);
+		checkQuantiles(in_order, sorted);
+		// The sketch made on a pool does not depend on the number of threads.
+		QuantileSketch parallel = QuantileSketch::sketch(values.data(), values.size(), QuantileSketch::default_k, &pool);
+		ThreadPool serial_pool(1);
+		QuantileSketch serial = QuantileSketch::sketch(values.data(), values.size(), QuantileSketch::default_k, &serial_pool);
+		checkQuantiles(parallel, sorted);
+		CHECK(parallel.getQuantile(0.5) == serial.getQuantile(0.5) && parallel.getRetained() == serial.getRetained());
+		// Parts of the stream which are merged.
+		QuantileSketch merged,
+					   part(QuantileSketch::default_k, 1);
+		for (size_t i = 0; i < values.size(); ++i) {
+			part.add(values[i]);
+			if (i % 70000 == 69999 || i + 1 == values.size()) {
+				merged.merge(part);
+				part.reset();
+			}
+		}
+		checkQuantiles(merged, sorted);
+	}
+
+	// NaN values are counted, but left out of the quantiles.
+	QuantileSketch sketch;
+	CHECK(isnan(sketch.getQuantile(0.5)) && isnan(sketch.getRank(1.0)));
+	for (size_t i = 0; i < 1000; ++i) {
+		sketch.add((double)i);
+		if (i % 10 == 0) sketch.add(NAN);
+	}
+	CHECK(sketch.count() == 1000 && sketch.countNaN() == 100);
+	CHECK(fabs(sketch.getQuantile(0.5) - 500.0) <= 1000.0 * sketch.getRankError());
+	CHECK(isnan(sketch.getQuantile(-0.1)) && isnan(sketch.getQuantile(1.1)));
+	return checkStatus();
+}
@@ -0,0 +1,140 @@
+/* tests/smallvector.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "check.hpp"
+
+using namespace jp::visx;
+
+/* A SmallVector and a std::vector go through the same random insertions,
+ * removals, copies and moves, and must hold the same elements. Every element
+ * counts the live ones, so one destroyed twice (or never) shows in the count.
+ */
+
+namespace {
+	long live_elements = 0;
+
+	class Element {
+	public:
+		Element(const std::string &text) : text_(text) {
+			++live_elements;
+		}
+		Element(const Element &other) : text_(other.text_) {
+			++live_elements;
+		}
+		Element(Element &&other) : text_(std::move(other.text_)) {
+			++live_elements;
+		}
+		~Element(void) {
+			--live_elements;
+		}
+		Element &operator=(const Element &other) = default;
+		Element &operator=(Element &&other) = default;
+		bool operator==(const Element &other) const {
+			return text_ == other.text_;
+		}
+	private:
+		std::string text_;
+	}; // class Element
+
+	template <size_t N>
+	bool sameElements(const SmallVector<Element, N> &vector, const std::vector<Element> &model) {
+		if (vector.size() != model.size() || vector.empty() != model.empty()) return false;
+		if (vector.end() - vector.begin() != (ptrdiff_t)model.size()) return false;
+		for (size_t i = 0; i < model.size(); ++i) {
+			if (!(vector[i] == model[i])) return false;
+		}
+		return true;
+	}
+
+	template <size_t N>
+	void testRandomEdits(std::mt19937 &random) {
+		SmallVector<Element, N> vector;
+		std::vector<Element> model;
+		for (size_t i = 0; i < 60; ++i) {
+			// Most strings are too long to be kept inside the string.
+			Element element(std::to_string(random() % 1000) + std::string(random() % 30, 'x'));
+			size_t size = model.size();
+			switch (random() % 6) {
+			case 0:
+			case 1:
+				vector.push_back(element);
+				model.push_back(element);
+				break;
+			case 2: {
+				size_t position = random() % (size + 1);
+				vector.insert(vector.begin() + position, element);
+				model.insert(model.begin() + position, element);
+				break;
+			}
+			case 3:
+				if (size) {
+					size_t position = random() % size;
+					vector.erase(vector.begin() + position);
+					model.erase(model.begin() + position);
+				}
+				break;
+			case 4:
+				// The element inserted is in the vector itself.
+				if (size) {
+					vector.push_back(vector.front());
+					model.push_back(model.front());
+					vector.insert(vector.begin(), vector.back());
+					model.insert(model.begin(), model.back());
+				}
+				break;
+			default:
+				vector.emplace_back(element);
+				model.emplace_back(element);
+				break;
+			}
+			CHECK(sameElements(vector, model));
+		}
+		SmallVector<Element, N> copy(vector),
+								moved(std::move(copy)),
+								assigned;
+		// A copy of a short vector keeps its elements inside.
+		CHECK(moved.size() > N || moved.isInline());
+		CHECK(sameElements(moved, model));
+		CHECK(copy.empty());
+		assigned = moved;
+		CHECK(sameElements(assigned, model));
+		assigned = std::move(moved);
+		CHECK(sameElements(assigned, model));
+		assigned.clear();
+		CHECK(assigned.empty());
+		vector.reserve(model.size() + 100);
+		CHECK(vector.capacity() >= model.size() + 100);
+		CHECK(sameElements(vector, model));
+	}
+}
+
+int main(void) {
+	std::mt19937 random(1);
+	for (size_t i = 0; i < 500; ++i) {
+		testRandomEdits<1>(random);
+		testRandomEdits<4>(random);
+		testRandomEdits<16>(random);
+	}
+	CHECK(live_elements == 0);
+	return checkStatus();
+}
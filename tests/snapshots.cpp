@@ -0,0 +1,117 @@
+/* tests/snapshots.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include "check.hpp"
+
+using namespace jp::visx;
+using namespace jp::visx::uasf;
+
+/* This test checks what goes with a table when it is copied, moved and
+ * assigned: the rows go, while the observers, the snapshots and whether they
+ * are published stay with the table. A thread reads the snapshots of a table
+ * while it is assigned, and checks that every snapshot is whole and that their
+ * versions never go back.
+ */
+
+namespace {
+	// A table of rows ADD 1, whose result is its number of rows after the first.
+	UncertaintyTable makeTable(size_t rows) {
+		UncertaintyTable table;
+		table.beginBatch();
+		for (size_t i = 0; i < rows; ++i) table.add(UOPERATION_ADD, 1.0, 0.0);
+		table.endBatch();
+		return table;
+	}
+
+	bool wholeSnapshot(const UncertaintyTableSnapshot &snapshot) {
+		return snapshot.getResult() == (double)(snapshot.count() - 1) && snapshot.getValue(snapshot.count() - 1) == 1.0;
+	}
+}
+
+int main(void) {
+	const size_t small_rows = 40, large_rows = 3000;
+	UncertaintyTable small = makeTable(small_rows), large = makeTable(large_rows);
+
+	// A copy does not take the observers and the snapshots of the table.
+	size_t calls = 0;
+	large.setPublishing(true);
+	large.subscribe([&](const UncertaintyTable &, const UncertaintyTableChange &) { ++calls; });
+	large.publish();
+	UncertaintyTable copy(large);
+	CHECK(copy.count() == large.count() && copy.getResult() == large.getResult());
+	CHECK(!copy.isPublishing() && !copy.getSnapshot());
+	copy.add(UOPERATION_ADD, 1.0, 0.0);
+	CHECK(calls == 0);
+
+	// A table which is assigned keeps its own.
+	UncertaintyTable target = makeTable(1);
+	size_t target_calls = 0, first_row = SIZE_MAX;
+	target.setPublishing(true);
+	target.subscribe([&](const UncertaintyTable &, const UncertaintyTableChange &change) {
+		++target_calls;
+		first_row = change.first_row;
+	});
+	target.publish();
+	u64 version = target.getSnapshot()->getVersion();
+	target = large;
+	CHECK(target.isPublishing() && target_calls == 1 && first_row == 0);
+	CHECK(target.getSnapshot()->getVersion() > version && target.getSnapshot()->count() == large.count());
+	CHECK(calls == 0 && large.getSnapshot()->getVersion() == 1);
+	target = std::move(copy);
+	CHECK(target.count() == large_rows + 2 && target.getSnapshot()->count() == large_rows + 2);
+	CHECK(target_calls == 2 && copy.count() == 1 && !copy.getSnapshot());
+
+	// A moved table keeps everything.
+	std::shared_ptr<const UncertaintyTableSnapshot> snapshot = large.getSnapshot();
+	UncertaintyTable moved(std::move(large));
+	CHECK(moved.isPublishing() && moved.getSnapshot() == snapshot && moved.count() == large_rows + 1);
+	CHECK(!large.isPublishing() && !large.getSnapshot() && large.count() == 1);
+	moved.add(UOPERATION_ADD, 1.0, 0.0);
+	CHECK(calls == 1 && moved.getSnapshot()->count() == large_rows + 2);
+
+	// The snapshots are read while the table is assigned.
+	std::atomic<bool> done(false);
+	size_t bad_snapshots = 0;
+	std::thread reader([&] {
+		u64 last = 0;
+		while (!done.load()) {
+			std::this_thread::yield();
+			std::shared_ptr<const UncertaintyTableSnapshot> snapshot = target.getSnapshot();
+			if (!snapshot || snapshot->getVersion() < last || !wholeSnapshot(*snapshot)) ++bad_snapshots;
+			if (snapshot) last = snapshot->getVersion();
+		}
+	});
+	for (size_t i = 0; i < 200; ++i) {
+		if (i % 2) {
+			target = small;
+		} else {
+			UncertaintyTable other = makeTable(large_rows);
+			target = std::move(other);
+		}
+	}
+	done.store(true);
+	reader.join();
+	CHECK(bad_snapshots == 0);
+	CHECK(target.getSnapshot()->getVersion() == version + 2 + 200);
+	CHECK(target.getSnapshot()->count() == small_rows + 1);
+	return checkStatus();
+}
@@ -0,0 +1,90 @@
+/* tests/spscqueue.cpp
+ * 
+ * This file is part of the VisX project (https://github.com/ljtpetersen/visx).
+ * Copyright (c) 2021 James Petersen
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <jp/visx.hpp>
+#include <chrono>
+#include <thread>
+#include <time.h>
+#include "check.hpp"
+
+using namespace jp::visx;
+
+/* This test passes numbers through an SpscQueue while one side is slower than
+ * the other, checks that they arrive in order and that pop fails once the
+ * closed queue is drained, and checks that a consumer waiting on an idle queue
+ * sleeps instead of using the processor.
+ */
+
+namespace {
+	void passValues(size_t capacity, bool slow_producer) {
+		const u64 count = 20000;
+		SpscQueue<u64> queue(capacity);
+		std::thread producer([&queue, slow_producer](void) {
+			for (u64 i = 0; i < count; ++i) {
+				// Every pause is long enough for the other side to go to sleep.
+				if (slow_producer && i % 2000 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				queue.push(u64(i));
+			}
+			queue.close();
+		});
+		u64 value,
+			expected = 0;
+		while (queue.pop(&value)) {
+			CHECK(value == expected);
+			++expected;
+			if (!slow_producer && expected % 2000 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		producer.join();
+		CHECK(expected == count);
+		// A drained queue stays drained.
+		CHECK(!queue.pop(&value));
+		CHECK(!queue.tryPop(&value));
+	}
+}
+
+int main(void) {
+	passValues(2, true);
+	passValues(2, false);
+	passValues(1024, true);
+	passValues(1024, false);
+
+	// The consumer waits on an empty queue for 300 ms. It spins for much less than
+	// that before it sleeps, so the process uses little processor time.
+	SpscQueue<int> queue(16);
+	int value = 0;
+	bool popped = false;
+	clock_t start = clock();
+	std::thread consumer([&queue, &value, &popped](void) {
+		popped = queue.pop(&value);
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+	queue.push(42);
+	consumer.join();
+	CHECK(popped && value == 42);
+	CHECK(seconds < 0.1);
+	// Closing an empty queue wakes the consumer.
+	std::thread closed_consumer([&queue, &value, &popped](void) {
+		popped = queue.pop(&value);
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	queue.close();
+	closed_consumer.join();
+	CHECK(!popped);
+	return checkStatus();
+}